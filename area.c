@@ -0,0 +1,279 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "area.h"
+
+
+/*  Parse the --area argument.  It's either the south latitude, west longitude, north latitude, and east longitude of an
+    MBR separated by commas or the name of an area file with one latitude, longitude pair (in decimal degrees, separated by
+    a comma or white space) per line that defines a polygon.  Blank lines and lines starting with # are ignored.  Returns
+    NVFalse if the MBR is empty or the file couldn't be read (or we ran out of memory) or has fewer than three points.  */
+
+uint8_t area_parse (AREA *area, char *string)
+{
+  FILE               *fp;
+  char               line[1024], extra, *comma;
+  double             lat, lon, *polygon_x, *polygon_y;
+  int32_t            i;
+
+
+  memset (area, 0, sizeof (AREA));
+  area->handle = -1;
+
+
+  /*  An MBR.  */
+
+  if (sscanf (string, "%lf,%lf,%lf,%lf%c", &area->mbr.slat, &area->mbr.wlon, &area->mbr.nlat, &area->mbr.elon, &extra) == 4)
+    {
+      /*  Crossing the dateline.  */
+
+      if (area->mbr.elon < area->mbr.wlon) area->mbr.elon += 360.0;
+
+      return (area->mbr.nlat > area->mbr.slat && area->mbr.elon > area->mbr.wlon);
+    }
+
+
+  /*  A polygon.  */
+
+  if ((fp = fopen (string, "r")) == NULL) return (NVFalse);
+
+  while (fgets (line, sizeof (line), fp) != NULL)
+    {
+      for (comma = strchr (line, ',') ; comma != NULL ; comma = strchr (comma, ',')) *comma = ' ';
+
+      if (line[0] == '#' || sscanf (line, "%lf %lf", &lat, &lon) != 2) continue;
+
+      polygon_x = (double *) realloc (area->polygon_x, (area->polygon_count + 1) * sizeof (double));
+      if (polygon_x != NULL) area->polygon_x = polygon_x;
+
+      polygon_y = (double *) realloc (area->polygon_y, (area->polygon_count + 1) * sizeof (double));
+      if (polygon_y != NULL) area->polygon_y = polygon_y;
+
+      if (polygon_x == NULL || polygon_y == NULL)
+        {
+          fclose (fp);
+          return (NVFalse);
+        }
+
+      area->polygon_x[area->polygon_count] = lon;
+      area->polygon_y[area->polygon_count] = lat;
+      area->polygon_count++;
+    }
+
+  fclose (fp);
+
+  if (area->polygon_count < 3) return (NVFalse);
+
+
+  area->mbr.wlon = area->mbr.slat = 999.0;
+  area->mbr.elon = area->mbr.nlat = -999.0;
+
+  for (i = 0 ; i < area->polygon_count ; i++)
+    {
+      area->mbr.wlon = MIN (area->mbr.wlon, area->polygon_x[i]);
+      area->mbr.elon = MAX (area->mbr.elon, area->polygon_x[i]);
+    }
+
+
+  /*  A polygon that is more than 180 degrees wide is really one that crosses the dateline.  */
+
+  if (area->mbr.elon - area->mbr.wlon > 180.0)
+    {
+      for (i = 0 ; i < area->polygon_count ; i++) if (area->polygon_x[i] < 0.0) area->polygon_x[i] += 360.0;
+    }
+
+  area->mbr.wlon = 999.0;
+  area->mbr.elon = -999.0;
+
+  for (i = 0 ; i < area->polygon_count ; i++)
+    {
+      area->mbr.wlon = MIN (area->mbr.wlon, area->polygon_x[i]);
+      area->mbr.elon = MAX (area->mbr.elon, area->polygon_x[i]);
+      area->mbr.slat = MIN (area->mbr.slat, area->polygon_y[i]);
+      area->mbr.nlat = MAX (area->mbr.nlat, area->polygon_y[i]);
+    }
+
+  return (area->mbr.nlat > area->mbr.slat && area->mbr.elon > area->mbr.wlon);
+}
+
+
+
+/*  Make the header of the output file.  grid_header is the output grid that we would merge without --area and the MBR of
+    the output file is the part of the area that is in that grid pushed out to the nearest nodes of the grid, so every
+    cell of the output file is the same cell that a merge of the whole MBR would have.  dateline is set if the input files
+    cross the dateline (so their longitudes go past 180).  Returns NVFalse if none of the area is in the grid.  */
+
+uint8_t area_header (AREA *area, CHRTR2_HEADER *grid_header, uint8_t dateline)
+{
+  int32_t            i, start_x, end_x, start_y, end_y;
+
+
+  if (dateline && area->mbr.wlon < 0.0)
+    {
+      area->mbr.wlon += 360.0;
+      area->mbr.elon += 360.0;
+
+      for (i = 0 ; i < area->polygon_count ; i++) area->polygon_x[i] += 360.0;
+    }
+
+  start_x = (int32_t) floor ((area->mbr.wlon - grid_header->mbr.wlon) / grid_header->lon_grid_size_degrees + 0.001);
+  end_x = (int32_t) ceil ((area->mbr.elon - grid_header->mbr.wlon) / grid_header->lon_grid_size_degrees - 0.001);
+  start_y = (int32_t) floor ((area->mbr.slat - grid_header->mbr.slat) / grid_header->lat_grid_size_degrees + 0.001);
+  end_y = (int32_t) ceil ((area->mbr.nlat - grid_header->mbr.slat) / grid_header->lat_grid_size_degrees - 0.001);
+
+
+  /*  There's no data outside of the grid.  */
+
+  start_x = MAX (start_x, 0);
+  end_x = MIN (end_x, grid_header->width - 1);
+  start_y = MAX (start_y, 0);
+  end_y = MIN (end_y, grid_header->height - 1);
+
+  if (start_x > end_x || start_y > end_y) return (NVFalse);
+
+  area->header = *grid_header;
+  area->header.mbr.wlon = grid_header->mbr.wlon + start_x * grid_header->lon_grid_size_degrees;
+  area->header.mbr.elon = grid_header->mbr.wlon + end_x * grid_header->lon_grid_size_degrees;
+  area->header.mbr.slat = grid_header->mbr.slat + start_y * grid_header->lat_grid_size_degrees;
+  area->header.mbr.nlat = grid_header->mbr.slat + end_y * grid_header->lat_grid_size_degrees;
+  area->header.width = end_x - start_x + 1;
+  area->header.height = end_y - start_y + 1;
+
+  return (NVTrue);
+}
+
+
+
+/*  Make the header of the merge grid in header.  It's the output file grown by halo_x columns and halo_y rows on every
+    side.  */
+
+void area_grid (AREA *area, int32_t halo_x, int32_t halo_y, CHRTR2_HEADER *header)
+{
+  *header = area->header;
+
+  header->mbr.wlon -= halo_x * header->lon_grid_size_degrees;
+  header->mbr.elon += halo_x * header->lon_grid_size_degrees;
+  header->mbr.slat -= halo_y * header->lat_grid_size_degrees;
+  header->mbr.nlat += halo_y * header->lat_grid_size_degrees;
+  header->width += 2 * halo_x;
+  header->height += 2 * halo_y;
+
+  area->x = halo_x;
+  area->y = halo_y;
+}
+
+
+
+/*  For a polygon, find the spans of each output row (from the open output file) whose cells are inside the polygon.  A
+    cell is inside if an odd number of polygon edges cross its row to the east of it, the same test that inside_polygon2
+    uses, so we only have to intersect each row with the edges once instead of testing every cell.  Returns NVFalse if we
+    couldn't allocate the spans.  */
+
+uint8_t area_spans (AREA *area)
+{
+  int32_t            i, j, k, row, start, end, span_count = 0, *span;
+  double             lat, lon, *cross, temp;
+  NV_I32_COORD2      coord;
+
+
+  if (!area->polygon_count) return (NVTrue);
+
+  area->row_span = (int32_t *) malloc ((area->header.height + 1) * sizeof (int32_t));
+  cross = (double *) malloc (area->polygon_count * sizeof (double));
+  if (area->row_span == NULL || cross == NULL)
+    {
+      free (cross);
+      return (NVFalse);
+    }
+
+  coord.x = 0;
+
+  for (row = 0 ; row < area->header.height ; row++)
+    {
+      area->row_span[row] = span_count;
+
+      coord.y = row;
+      chrtr2_get_lat_lon (area->handle, &lat, &lon, coord);
+
+
+      /*  Longitudes where the polygon edges cross this row, sorted west to east.  */
+
+      for (i = 0, j = area->polygon_count - 1, k = 0 ; i < area->polygon_count ; j = i++)
+        {
+          if ((area->polygon_y[i] > lat) != (area->polygon_y[j] > lat))
+            {
+              cross[k++] = (area->polygon_x[j] - area->polygon_x[i]) * (lat - area->polygon_y[i]) /
+                (area->polygon_y[j] - area->polygon_y[i]) + area->polygon_x[i];
+            }
+        }
+
+      for (i = 1 ; i < k ; i++)
+        {
+          temp = cross[i];
+          for (j = i ; j > 0 && cross[j - 1] > temp ; j--) cross[j] = cross[j - 1];
+          cross[j] = temp;
+        }
+
+
+      /*  The cells from each odd crossing up to (but not including) the next one are inside.  */
+
+      for (i = 0 ; i + 1 < k ; i += 2)
+        {
+          start = MAX ((int32_t) ceil ((cross[i] - lon) / area->header.lon_grid_size_degrees), 0);
+          end = MIN ((int32_t) ceil ((cross[i + 1] - lon) / area->header.lon_grid_size_degrees), area->header.width);
+
+          if (start >= end) continue;
+
+          if ((span = (int32_t *) realloc (area->span, (span_count + 1) * 2 * sizeof (int32_t))) == NULL)
+            {
+              free (cross);
+              return (NVFalse);
+            }
+
+          area->span = span;
+
+          area->span[2 * span_count] = start;
+          area->span[2 * span_count + 1] = end;
+          span_count++;
+        }
+    }
+
+  area->row_span[area->header.height] = span_count;
+
+  free (cross);
+
+  return (NVTrue);
+}
+
+
+
+void area_free (AREA *area)
+{
+  if (area->polygon_x != NULL) free (area->polygon_x);
+  if (area->polygon_y != NULL) free (area->polygon_y);
+  if (area->row_span != NULL) free (area->row_span);
+  if (area->span != NULL) free (area->span);
+  area->polygon_x = area->polygon_y = NULL;
+  area->row_span = area->span = NULL;
+  area->polygon_count = 0;
+}
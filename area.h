@@ -0,0 +1,57 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _AREA_H_
+#define _AREA_H_
+
+#include "chrtr2_merge.h"
+
+
+/*  The part of the output that was asked for with --area, either an MBR or a polygon.  The output file only covers the area
+    (snapped to the grid that the whole MBR would be merged on) but the merge grid is bigger by the exclude buffers and the regrid halo on
+    every side so that the cells along the edges of the area see the same data that they would in a merge of the whole
+    MBR.  Only the cells of the merge grid that are in the area are written to the output file.  */
+
+typedef struct
+{
+  NV_F64_MBR         mbr;             /*  Requested area (for a polygon, the MBR of the polygon)  */
+  int32_t            polygon_count;   /*  Number of polygon points (0 for an MBR)  */
+  double             *polygon_x;      /*  Polygon longitudes  */
+  double             *polygon_y;      /*  Polygon latitudes  */
+  CHRTR2_HEADER      header;          /*  Header of the output file  */
+  int32_t            handle;          /*  CHRTR2 handle of the output file  */
+  int32_t            x;               /*  Merge grid column of the first output file column  */
+  int32_t            y;               /*  Merge grid row of the first output file row  */
+  int32_t            *row_span;       /*  First span of each output row (height + 1 entries, polygons only)  */
+  int32_t            *span;           /*  Start and end column of each span of output cells inside the polygon  */
+} AREA;
+
+
+uint8_t area_parse (AREA *area, char *string);
+uint8_t area_header (AREA *area, CHRTR2_HEADER *grid_header, uint8_t dateline);
+void area_grid (AREA *area, int32_t halo_x, int32_t halo_y, CHRTR2_HEADER *header);
+uint8_t area_spans (AREA *area);
+void area_free (AREA *area);
+
+
+#endif
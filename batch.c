@@ -0,0 +1,370 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <limits.h>
+
+#include "batch.h"
+
+
+/*  Add word to the end of job's argv.  Returns NVFalse if we ran out of memory.  */
+
+static uint8_t add_word (BATCH_JOB *job, char *word)
+{
+  char               **argv;
+
+
+  if ((argv = (char **) realloc (job->argv, (job->argc + 2) * sizeof (char *))) == NULL) return (NVFalse);
+  job->argv = argv;
+
+  if ((job->argv[job->argc] = strdup (word)) == NULL) return (NVFalse);
+
+  job->argv[++job->argc] = NULL;
+
+  return (NVTrue);
+}
+
+
+
+/*  Split line into words (double quotes group words with spaces in them) and add them to job's argv.  Returns NVFalse if
+    we ran out of memory.  */
+
+static uint8_t split_line (BATCH_JOB *job, char *line)
+{
+  char               *ptr, *word;
+
+
+  ptr = line;
+
+  while (NVTrue)
+    {
+      while (*ptr == ' ' || *ptr == '\t' || *ptr == '\n' || *ptr == '\r') ptr++;
+      if (!*ptr) break;
+
+      if (*ptr == '"')
+        {
+          word = ++ptr;
+          while (*ptr && *ptr != '"') ptr++;
+        }
+      else
+        {
+          word = ptr;
+          while (*ptr && *ptr != ' ' && *ptr != '\t' && *ptr != '\n' && *ptr != '\r') ptr++;
+        }
+
+      if (*ptr) *ptr++ = 0;
+
+      if (!add_word (job, word)) return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Free the jobs' arguments and file names.  */
+
+static void free_jobs (BATCH *batch)
+{
+  int32_t            i, j;
+
+
+  for (i = 0 ; i < batch->job_count ; i++)
+    {
+      for (j = 0 ; j < batch->job[i].argc ; j++) free (batch->job[i].argv[j]);
+      if (batch->job[i].argv != NULL) free (batch->job[i].argv);
+
+      if (batch->job[i].output != NULL) free (batch->job[i].output);
+      for (j = 0 ; j < batch->job[i].input_count ; j++) free (batch->job[i].input[j]);
+      if (batch->job[i].input != NULL) free (batch->job[i].input);
+    }
+
+  if (batch->job != NULL) free (batch->job);
+
+  batch->job = NULL;
+  batch->job_count = 0;
+}
+
+
+
+/*  Read the job file.  Each line that isn't blank or a comment (starting with #) is one merge, written the same as the
+    chrtr2_merge command line without the program name.  Returns NVFalse (check errno) if we couldn't read the file or ran
+    out of memory.  */
+
+uint8_t batch_read (BATCH *batch, char *job_file, char *program)
+{
+  FILE               *fp;
+  char               string[65536], *ptr;
+  int32_t            line = 0;
+  BATCH_JOB          *job, *jobs;
+
+
+  memset (batch, 0, sizeof (BATCH));
+
+  if ((fp = fopen (job_file, "r")) == NULL) return (NVFalse);
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      line++;
+
+      for (ptr = string ; *ptr == ' ' || *ptr == '\t' ; ptr++);
+      if (!*ptr || *ptr == '\n' || *ptr == '\r' || *ptr == '#') continue;
+
+
+      if ((jobs = (BATCH_JOB *) realloc (batch->job, (batch->job_count + 1) * sizeof (BATCH_JOB))) != NULL)
+        {
+          batch->job = jobs;
+
+          job = &batch->job[batch->job_count++];
+          memset (job, 0, sizeof (BATCH_JOB));
+          job->line = line;
+        }
+
+      if (jobs == NULL || !add_word (job, program) || !split_line (job, ptr))
+        {
+          fclose (fp);
+          free_jobs (batch);
+          return (NVFalse);
+        }
+    }
+
+  fclose (fp);
+
+  return (NVTrue);
+}
+
+
+
+/*  Returns an allocated copy of path with its directory made absolute (the file itself doesn't have to exist yet) so that
+    two names for the same file in different jobs compare equal.  Returns NULL if we ran out of memory.  */
+
+static char *full_path (char *path)
+{
+  char               dir[PATH_MAX], real[PATH_MAX], *name, *full;
+  int32_t            length;
+
+
+  if ((name = strrchr (path, '/')) == NULL)
+    {
+      strcpy (dir, ".");
+      name = path;
+    }
+  else
+    {
+      length = MAX (1, name - path);
+
+      dir[0] = 0;
+      if (length < PATH_MAX)
+        {
+          strncpy (dir, path, length);
+          dir[length] = 0;
+        }
+
+      name++;
+    }
+
+  if (dir[0] && realpath (dir, real) != NULL)
+    {
+      if ((full = (char *) malloc (strlen (real) + strlen (name) + 2)) != NULL) sprintf (full, "%s/%s", real, name);
+    }
+  else
+    {
+      full = strdup (path);
+    }
+
+  return (full);
+}
+
+
+
+/*  Set the files that job writes and reads so that jobs that depend on each other aren't run at the same time.  Returns
+    NVFalse if we ran out of memory (batch_free cleans up).  */
+
+uint8_t batch_files (BATCH *batch, int32_t job, char *output, int32_t input_count, char **input)
+{
+  BATCH_JOB          *batch_job = &batch->job[job];
+
+
+  if ((batch_job->output = full_path (output)) == NULL) return (NVFalse);
+
+  if ((batch_job->input = (char **) malloc (MAX (input_count, 1) * sizeof (char *))) == NULL) return (NVFalse);
+
+  for (batch_job->input_count = 0 ; batch_job->input_count < input_count ; batch_job->input_count++)
+    {
+      if ((batch_job->input[batch_job->input_count] = full_path (input[batch_job->input_count])) == NULL) return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Returns NVTrue if job has to wait for an earlier job that hasn't finished, one that writes one of job's inputs or that
+    reads or writes job's output.  Has to be called with the mutex locked.  */
+
+static uint8_t waits_for_job (BATCH *batch, int32_t job)
+{
+  int32_t            i, j;
+  BATCH_JOB          *this_job, *earlier;
+
+
+  this_job = &batch->job[job];
+
+  if (this_job->output == NULL) return (NVFalse);
+
+  for (i = 0 ; i < job ; i++)
+    {
+      earlier = &batch->job[i];
+
+      if (earlier->done || earlier->output == NULL) continue;
+
+      if (!strcmp (earlier->output, this_job->output)) return (NVTrue);
+
+      for (j = 0 ; j < this_job->input_count ; j++) if (!strcmp (earlier->output, this_job->input[j])) return (NVTrue);
+
+      for (j = 0 ; j < earlier->input_count ; j++) if (!strcmp (earlier->input[j], this_job->output)) return (NVTrue);
+    }
+
+  return (NVFalse);
+}
+
+
+
+/*  Take the jobs in order and run them when there are enough threads and memory left and no earlier job that they depend
+    on is still running.  */
+
+static void *worker_thread (void *arg)
+{
+  BATCH_WORKER       *worker = (BATCH_WORKER *) arg;
+  BATCH              *batch = worker->batch;
+  BATCH_JOB          *job;
+  int32_t            i;
+
+
+  pthread_mutex_lock (&batch->mutex);
+
+  while (batch->next_job < batch->job_count)
+    {
+      i = batch->next_job++;
+      job = &batch->job[i];
+
+      while (waits_for_job (batch, i) ||
+             (batch->running && (batch->used_threads + job->threads > batch->max_threads ||
+                                 (batch->max_memory && batch->used_memory + job->mem_limit > batch->max_memory))))
+        pthread_cond_wait (&batch->cond, &batch->mutex);
+
+      batch->running++;
+      batch->used_threads += job->threads;
+      batch->used_memory += job->mem_limit;
+
+      pthread_mutex_unlock (&batch->mutex);
+
+
+      (*batch->run) (batch, i, worker);
+
+
+      pthread_mutex_lock (&batch->mutex);
+
+      batch->running--;
+      job->done = NVTrue;
+      batch->used_threads -= job->threads;
+      batch->used_memory -= job->mem_limit;
+
+      pthread_cond_broadcast (&batch->cond);
+    }
+
+  pthread_mutex_unlock (&batch->mutex);
+
+  return (NULL);
+}
+
+
+
+/*  Run all of the jobs with worker_count worker threads.  run is called for each job.  max_open and cache_bytes are the
+    limits for the input cache.  If we can't start all of the workers the jobs are run by the ones that did start.  Returns
+    NVFalse (check errno) if we couldn't start any.  */
+
+uint8_t batch_run (BATCH *batch, int32_t worker_count, int32_t max_threads, int64_t max_memory, int32_t max_open, int64_t cache_bytes,
+                BATCH_RUN run, void *data)
+{
+  int32_t            i;
+  BATCH_WORKER       *worker;
+
+
+  batch->worker_count = MAX (1, MIN (worker_count, batch->job_count));
+  batch->max_threads = max_threads;
+  batch->max_memory = max_memory;
+  batch->run = run;
+  batch->data = data;
+
+  pthread_mutex_init (&batch->mutex, NULL);
+  pthread_cond_init (&batch->cond, NULL);
+
+  input_cache_init (&batch->cache, max_open, cache_bytes);
+
+  worker = (BATCH_WORKER *) calloc (batch->worker_count, sizeof (BATCH_WORKER));
+  if (worker == NULL) return (NVFalse);
+
+  for (i = 0 ; i < batch->worker_count ; i++)
+    {
+      worker[i].number = i;
+      worker[i].batch = batch;
+
+      if ((errno = pthread_create (&worker[i].thread, NULL, worker_thread, &worker[i])))
+        {
+          batch->worker_count = i;
+          break;
+        }
+    }
+
+  if (!batch->worker_count)
+    {
+      free (worker);
+      return (NVFalse);
+    }
+
+  for (i = 0 ; i < batch->worker_count ; i++)
+    {
+      pthread_join (worker[i].thread, NULL);
+
+      merge_grid_free (&worker[i].grid[0]);
+      merge_grid_free (&worker[i].grid[1]);
+    }
+
+  free (worker);
+
+  input_cache_report (&batch->cache);
+
+  return (NVTrue);
+}
+
+
+
+void batch_free (BATCH *batch)
+{
+  free_jobs (batch);
+
+  input_cache_free (&batch->cache);
+
+  pthread_mutex_destroy (&batch->mutex);
+  pthread_cond_destroy (&batch->cond);
+}
@@ -0,0 +1,101 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "input_cache.h"
+#include "merge_grid.h"
+
+
+/*  Default size of the batch input cache.  */
+
+#define         BATCH_CACHE_BYTES 268435456
+
+
+/*  One merge from the job file.  argv[0] is the program name so the job's options can go through getopt the same as a
+    command line.  */
+
+typedef struct
+{
+  int32_t            argc;
+  char               **argv;
+  int32_t            line;            /*  Line of the job file  */
+  int32_t            threads;         /*  Threads (or regrid processes, whichever is more) that the job uses  */
+  int64_t            mem_limit;       /*  Memory that the job uses (0 if it isn't limited)  */
+  char               *output;         /*  Full path of the output file (see batch_files)  */
+  char               **input;         /*  Full paths of the input files  */
+  int32_t            input_count;
+  uint8_t            done;
+} BATCH_JOB;
+
+
+/*  A thread that runs jobs one after the other.  The grids are reused from job to job.  */
+
+typedef struct
+{
+  int32_t            number;
+  pthread_t          thread;
+  MERGE_GRID         grid[2];
+  struct BATCH       *batch;
+} BATCH_WORKER;
+
+
+typedef void (*BATCH_RUN) (struct BATCH *batch, int32_t job, BATCH_WORKER *worker);
+
+
+/*  A batch of merges (--batch).  Up to worker_count jobs run at the same time, in job file order, as long as the total of
+    their threads and memory fits in max_threads and max_memory (a job that doesn't fit on its own runs by itself).  A job
+    that reads an earlier job's output, or writes a file that an earlier job reads or writes, waits for that job to finish.
+    All of the jobs share the input cache.  */
+
+typedef struct BATCH
+{
+  int32_t            job_count;
+  BATCH_JOB          *job;
+  int32_t            worker_count;
+  int32_t            max_threads;
+  int64_t            max_memory;      /*  0 for no limit  */
+  int32_t            next_job;
+  int32_t            running;
+  int32_t            used_threads;
+  int64_t            used_memory;
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cond;
+  INPUT_CACHE        cache;
+  BATCH_RUN          run;
+  void               *data;           /*  For run  */
+} BATCH;
+
+
+uint8_t batch_read (BATCH *batch, char *job_file, char *program);
+uint8_t batch_files (BATCH *batch, int32_t job, char *output, int32_t input_count, char **input);
+uint8_t batch_run (BATCH *batch, int32_t worker_count, int32_t max_threads, int64_t max_memory, int32_t max_open, int64_t cache_bytes,
+                   BATCH_RUN run, void *data);
+void batch_free (BATCH *batch);
+
+
+#endif
@@ -0,0 +1,194 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+
+#include "nvutility.h"
+
+#include "chrtr2.h"
+
+#include "version.h"
+
+
+
+/*
+
+    Programmer : PFM Software
+    Date : 10/16/26
+
+    Measures how far the interpolated Z values of one chrtr2_merge output are from another of the same area, for example
+    a --regrid-workers or --mem-limit run against a single pass.  See usage (below).
+
+*/
+
+
+#define         HARD_DATA (CHRTR2_REAL | CHRTR2_DIGITIZED_CONTOUR | CHRTR2_LAND_MASK)
+
+
+void usage ()
+{
+  fprintf (stderr, "\n\nUsage: chrtr2_diff [-t TOLERANCE] REFERENCE_FILE TEST_FILE\n\n");
+  fprintf (stderr, "This program compares two CHRTR2 grids of the same area, normally a single pass\n");
+  fprintf (stderr, "chrtr2_merge output (REFERENCE_FILE) and one made with --regrid-workers,\n");
+  fprintf (stderr, "--mem-limit, --pipeline, or --holes-only (TEST_FILE).  For the cells that are\n");
+  fprintf (stderr, "interpolated in both files it prints the largest and RMS Z difference and the\n");
+  fprintf (stderr, "number of cells that differ by more than TOLERANCE.  It also counts the cells\n");
+  fprintf (stderr, "whose status differs and the real, digitized, or land masked cells whose Z\n");
+  fprintf (stderr, "differs (there shouldn't be any of those).\n\n");
+  fprintf (stderr, "-t = tolerance (default 0.05, the MISP convergence delta that chrtr2_merge uses)\n\n");
+  fprintf (stderr, "Example:\n\n");
+  fprintf (stderr, "chrtr2_merge a.ch2 b.ch2 -o single.ch2\n");
+  fprintf (stderr, "chrtr2_merge --regrid-workers 8 a.ch2 b.ch2 -o banded.ch2\n");
+  fprintf (stderr, "chrtr2_diff single.ch2 banded.ch2\n\n");
+  fflush (stderr);
+  exit (-1);
+}
+
+
+
+int32_t main (int32_t argc, char *argv[])
+{
+  char               c;
+  extern char        *optarg;
+  extern int         optind;
+  int32_t            i, j, handle[2], max_row = -1, max_col = -1;
+  int64_t            interpolated = 0, over = 0, status_diffs = 0, hard_diffs = 0;
+  double             diff, sum = 0.0, max_diff = 0.0;
+  float              tolerance = 0.05;
+  CHRTR2_HEADER      header[2];
+  CHRTR2_RECORD      *row[2];
+
+
+  printf ("\n\n %s \n\n\n", VERSION);
+
+
+  while ((c = (char) getopt (argc, argv, "t:")) != -1)
+    {
+      switch (c)
+        {
+        case 't':
+          sscanf (optarg, "%f", &tolerance);
+          break;
+
+        default:
+          usage ();
+          break;
+        }
+    }
+
+
+  if (optind + 2 != argc || tolerance < 0.0) usage ();
+
+
+  for (i = 0 ; i < 2 ; i++)
+    {
+      if ((handle[i] = chrtr2_open_file (argv[optind + i], &header[i], CHRTR2_READONLY)) < 0)
+        {
+          fprintf (stderr, "\n\nError opening %s : %s\n\n", argv[optind + i], chrtr2_strerror ());
+          exit (-1);
+        }
+    }
+
+  if (header[0].width != header[1].width || header[0].height != header[1].height)
+    {
+      fprintf (stderr, "\n\n%s is %d x %d and %s is %d x %d so they can't be compared\n\n", argv[optind], header[0].width,
+               header[0].height, argv[optind + 1], header[1].width, header[1].height);
+      exit (-1);
+    }
+
+
+  for (i = 0 ; i < 2 ; i++)
+    {
+      if ((row[i] = (CHRTR2_RECORD *) malloc (header[0].width * sizeof (CHRTR2_RECORD))) == NULL)
+        {
+          perror ("Allocating rows in chrtr2_diff.c");
+          exit (-1);
+        }
+    }
+
+
+  for (i = 0 ; i < header[0].height ; i++)
+    {
+      for (j = 0 ; j < 2 ; j++)
+        {
+          if (chrtr2_read_record_row (handle[j], i, 0, header[0].width, row[j]))
+            {
+              fprintf (stderr, "\n\nError reading row %d of %s : %s\n\n", i, argv[optind + j], chrtr2_strerror ());
+              exit (-1);
+            }
+        }
+
+      for (j = 0 ; j < header[0].width ; j++)
+        {
+          if (row[0][j].status != row[1][j].status)
+            {
+              status_diffs++;
+              continue;
+            }
+
+          if (row[0][j].status & HARD_DATA)
+            {
+              if (row[0][j].z != row[1][j].z) hard_diffs++;
+              continue;
+            }
+
+          if (!(row[0][j].status & CHRTR2_INTERPOLATED)) continue;
+
+          diff = fabs ((double) row[1][j].z - (double) row[0][j].z);
+
+          interpolated++;
+          sum += diff * diff;
+          if (diff > tolerance) over++;
+
+          if (diff > max_diff)
+            {
+              max_diff = diff;
+              max_row = i;
+              max_col = j;
+            }
+        }
+    }
+
+
+  free (row[0]);
+  free (row[1]);
+
+  chrtr2_close_file (handle[0]);
+  chrtr2_close_file (handle[1]);
+
+
+  printf ("Interpolated cells compared   : %lld\n", (long long) interpolated);
+  printf ("Largest Z difference          : %.4f", max_diff);
+  if (max_row >= 0) printf (" (row %d, column %d)", max_row, max_col);
+  printf ("\n");
+  printf ("RMS Z difference              : %.4f\n", interpolated ? sqrt (sum / (double) interpolated) : 0.0);
+  printf ("Cells over the tolerance      : %lld\n", (long long) over);
+  printf ("Cells with a different status : %lld\n", (long long) status_diffs);
+  printf ("Hard data cells that changed  : %lld\n\n", (long long) hard_diffs);
+
+
+  return (0);
+}
@@ -0,0 +1,54 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+
+/*********************************************************************************************
+
+    This program is public domain software that was developed by 
+    the U.S. Naval Oceanographic Office.
+
+    This is a work of the US Government. In accordance with 17 USC 105,
+    copyright protection is not available for any work of the US Government.
+
+    This software is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+*********************************************************************************************/
+
+#ifndef VERSION
+
+#define     VERSION     "PFM Software - chrtr2_diff V1.00 - 10/16/26"
+
+#endif
+
+/*
+
+    Version 1.00
+    PFM Software
+    10/16/26
+
+    First version.  Measures the Z differences between two chrtr2_merge outputs of the same area (for example
+    a --regrid-workers run against a single pass).
+
+*/
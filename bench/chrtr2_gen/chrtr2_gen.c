@@ -0,0 +1,336 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <getopt.h>
+
+#include "nvutility.h"
+
+#include "chrtr2.h"
+
+#include "version.h"
+
+
+
+/*
+
+    Programmer : PFM Software
+    Date : 10/16/26
+
+    Generates synthetic CHRTR2 files so that chrtr2_merge can be benchmarked without real survey data.  See usage (below).
+
+*/
+
+
+#define         HOLES_NONE 0
+#define         HOLES_BLOCKS 1
+#define         HOLES_STRIPES 2
+#define         HOLES_RAGGED 3
+
+
+/*  Size (in cells) of the block hole pattern and the spacing of the blocks.  */
+
+#define         BLOCK_SIZE 24
+#define         BLOCK_SPACING 96
+
+
+/*  Height (in rows) of the stripe hole pattern and the spacing of the stripes.  */
+
+#define         STRIPE_SIZE 6
+#define         STRIPE_SPACING 40
+
+
+void usage ()
+{
+  fprintf (stderr, "\n\nUsage: chrtr2_gen [-w WIDTH] [-t HEIGHT] [-g GRID_SIZE] [-x WEST_LON] [-y SOUTH_LAT] [-D]\n");
+  fprintf (stderr, "                  [-d DENSITY] [-p HOLE_PATTERN] [-m REAL,DIGITIZED,LAND,INTERPOLATED]\n");
+  fprintf (stderr, "                  [-z DEPTH] [-s SEED] OUTPUT_FILE\n\n");
+  fprintf (stderr, "This program generates a synthetic CHRTR2 grid for benchmarking chrtr2_merge.\n");
+  fprintf (stderr, "The Z values are a smooth surface of position plus a little noise so that\n");
+  fprintf (stderr, "overlapping files generated with different seeds still agree with each other.\n\n");
+  fprintf (stderr, "-w = width in grid cells (default 1000)\n");
+  fprintf (stderr, "-t = height in grid cells (default 1000)\n");
+  fprintf (stderr, "-g = grid size in arc minutes (default 0.05)\n");
+  fprintf (stderr, "-x = west longitude of the grid (default -80.0)\n");
+  fprintf (stderr, "-y = south latitude of the grid (default 28.0)\n");
+  fprintf (stderr, "-D = center the grid on the dateline (overrides -x).  The east longitude is\n");
+  fprintf (stderr, "     stored past 180 the same as any other area that crosses the dateline.\n");
+  fprintf (stderr, "-d = fraction of the cells that have data, 0.0 to 1.0 (default 1.0)\n");
+  fprintf (stderr, "-p = hole pattern, one of none, blocks, stripes, or ragged (default none).\n");
+  fprintf (stderr, "     blocks are %dx%d cell holes every %d cells, stripes are %d row gaps every\n", BLOCK_SIZE, BLOCK_SIZE,
+           BLOCK_SPACING, STRIPE_SIZE);
+  fprintf (stderr, "     %d rows (missed survey lines), and ragged leaves a ragged edge of empty\n", STRIPE_SPACING);
+  fprintf (stderr, "     cells on the east and west sides.\n");
+  fprintf (stderr, "-m = relative weights of the real, digitized contour, land masked, and\n");
+  fprintf (stderr, "     interpolated status of the cells that have data (default 60,10,10,20)\n");
+  fprintf (stderr, "-z = mean depth of the surface (default 100.0)\n");
+  fprintf (stderr, "-s = random number seed (default 1)\n\n");
+  fprintf (stderr, "Example:\n\n");
+  fprintf (stderr, "chrtr2_gen -w 4000 -t 3000 -d 0.8 -p stripes -s 7 survey_07.ch2\n\n");
+  fflush (stderr);
+  exit (-1);
+}
+
+
+
+/*  Uniform random number from 0.0 up to (but not including) 1.0.  */
+
+static double uniform ()
+{
+  return ((double) rand () / ((double) RAND_MAX + 1.0));
+}
+
+
+
+/*  The synthetic surface.  Waves of a few different lengths so that MISP has some real work to do.  */
+
+static float surface (double lat, double lon, float depth)
+{
+  return (depth + 0.3 * depth * sin (lat * 7.0) * cos (lon * 5.0) + 0.1 * depth * sin (lat * 31.0 + lon * 23.0));
+}
+
+
+
+/*  Returns NVTrue if the cell at x, y is in a hole.  */
+
+static uint8_t in_hole (int32_t pattern, int32_t x, int32_t y, int32_t width, int32_t *ragged)
+{
+  switch (pattern)
+    {
+    case HOLES_BLOCKS:
+      return ((x % BLOCK_SPACING) >= BLOCK_SPACING - BLOCK_SIZE && (y % BLOCK_SPACING) >= BLOCK_SPACING - BLOCK_SIZE);
+
+    case HOLES_STRIPES:
+      return ((y % STRIPE_SPACING) >= STRIPE_SPACING - STRIPE_SIZE);
+
+    case HOLES_RAGGED:
+      return (x < ragged[0] || x >= width - ragged[1]);
+    }
+
+  return (NVFalse);
+}
+
+
+
+int32_t main (int32_t argc, char *argv[])
+{
+  char               c, output_file[512];
+  extern char        *optarg;
+  extern int         optind;
+  int32_t            i, j, handle, width = 1000, height = 1000, pattern = HOLES_NONE, ragged[2] = {0, 0}, seed = 1;
+  uint8_t            dateline = NVFalse;
+  double             grid_minutes = 0.05, wlon = -80.0, slat = 28.0, density = 1.0, weight[4] = {60.0, 10.0, 10.0, 20.0}, total, u;
+  double             lat, lon;
+  float              depth = 100.0;
+  CHRTR2_HEADER      header;
+  CHRTR2_RECORD      *row;
+
+
+  printf ("\n\n %s \n\n\n", VERSION);
+
+
+  while ((c = (char) getopt (argc, argv, "w:t:g:x:y:Dd:p:m:z:s:")) != -1)
+    {
+      switch (c)
+        {
+        case 'w':
+          sscanf (optarg, "%d", &width);
+          break;
+
+        case 't':
+          sscanf (optarg, "%d", &height);
+          break;
+
+        case 'g':
+          sscanf (optarg, "%lf", &grid_minutes);
+          break;
+
+        case 'x':
+          sscanf (optarg, "%lf", &wlon);
+          break;
+
+        case 'y':
+          sscanf (optarg, "%lf", &slat);
+          break;
+
+        case 'D':
+          dateline = NVTrue;
+          break;
+
+        case 'd':
+          sscanf (optarg, "%lf", &density);
+          break;
+
+        case 'p':
+          if (!strcmp (optarg, "none"))
+            {
+              pattern = HOLES_NONE;
+            }
+          else if (!strcmp (optarg, "blocks"))
+            {
+              pattern = HOLES_BLOCKS;
+            }
+          else if (!strcmp (optarg, "stripes"))
+            {
+              pattern = HOLES_STRIPES;
+            }
+          else if (!strcmp (optarg, "ragged"))
+            {
+              pattern = HOLES_RAGGED;
+            }
+          else
+            {
+              usage ();
+            }
+          break;
+
+        case 'm':
+          if (sscanf (optarg, "%lf,%lf,%lf,%lf", &weight[0], &weight[1], &weight[2], &weight[3]) != 4) usage ();
+          break;
+
+        case 'z':
+          sscanf (optarg, "%f", &depth);
+          break;
+
+        case 's':
+          sscanf (optarg, "%d", &seed);
+          break;
+
+        default:
+          usage ();
+          break;
+        }
+    }
+
+
+  if (optind >= argc || width < 2 || height < 2 || grid_minutes <= 0.0 || density < 0.0 || density > 1.0) usage ();
+
+  total = weight[0] + weight[1] + weight[2] + weight[3];
+  if (total <= 0.0) usage ();
+
+  strcpy (output_file, argv[optind]);
+
+  srand (seed);
+
+
+  memset (&header, 0, sizeof (CHRTR2_HEADER));
+
+  strcpy (header.creation_software, VERSION);
+  sprintf (header.comments, "Synthetic grid, seed %d, density %.3f", seed, density);
+
+  header.width = width;
+  header.height = height;
+  header.lat_grid_size_degrees = header.lon_grid_size_degrees = grid_minutes / 60.0;
+
+  if (dateline) wlon = 180.0 - (double) (width / 2) * header.lon_grid_size_degrees;
+
+  header.mbr.wlon = wlon;
+  header.mbr.slat = slat;
+  header.mbr.elon = wlon + (double) (width - 1) * header.lon_grid_size_degrees;
+  header.mbr.nlat = slat + (double) (height - 1) * header.lat_grid_size_degrees;
+
+  header.min_z = -depth;
+  header.max_z = depth * 3.0;
+  header.z_scale = 100.0;
+
+
+  if ((handle = chrtr2_create_file (output_file, &header)) < 0)
+    {
+      chrtr2_perror ();
+      exit (-1);
+    }
+
+  if ((row = (CHRTR2_RECORD *) malloc (width * sizeof (CHRTR2_RECORD))) == NULL)
+    {
+      perror ("Allocating row in chrtr2_gen.c");
+      exit (-1);
+    }
+
+
+  for (i = 0 ; i < height ; i++)
+    {
+      lat = slat + (double) i * header.lat_grid_size_degrees;
+
+
+      /*  The ragged edges wander in and out by up to 5% of the width.  */
+
+      if (pattern == HOLES_RAGGED)
+        {
+          for (j = 0 ; j < 2 ; j++) ragged[j] = MAX (0, MIN (width / 20, ragged[j] + (rand () % 5) - 2));
+        }
+
+      for (j = 0 ; j < width ; j++)
+        {
+          memset (&row[j], 0, sizeof (CHRTR2_RECORD));
+
+          if (uniform () >= density || in_hole (pattern, j, i, width, ragged)) continue;
+
+          lon = wlon + (double) j * header.lon_grid_size_degrees;
+
+          row[j].z = surface (lat, lon, depth) + (uniform () - 0.5) * 0.01 * depth;
+          row[j].number_of_points = 1 + rand () % 20;
+          row[j].uncertainty = 0.1 + uniform ();
+
+          u = uniform () * total;
+
+          if (u < weight[0])
+            {
+              row[j].status = CHRTR2_REAL;
+            }
+          else if (u < weight[0] + weight[1])
+            {
+              row[j].status = CHRTR2_DIGITIZED_CONTOUR;
+            }
+          else if (u < weight[0] + weight[1] + weight[2])
+            {
+              row[j].status = CHRTR2_LAND_MASK;
+            }
+          else
+            {
+              row[j].status = CHRTR2_INTERPOLATED;
+            }
+        }
+
+      if (chrtr2_write_record_row (handle, i, 0, width, row))
+        {
+          fprintf (stderr, "\n\nError writing row %d of %s : %s\n\n", i, output_file, chrtr2_strerror ());
+          exit (-1);
+        }
+    }
+
+
+  free (row);
+
+  chrtr2_close_file (handle);
+
+
+  fprintf (stderr, "%s : %d x %d, %.4f to %.4f, %.4f to %.4f\n\n", output_file, width, height, header.mbr.wlon, header.mbr.elon,
+           header.mbr.slat, header.mbr.nlat);
+
+
+  return (0);
+}
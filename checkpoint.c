@@ -0,0 +1,202 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "manifest.h"
+
+
+/*  Set up the checkpoint for the merge into output_file in tiles of tile_rows rows.  Nothing has been done yet.  Returns
+    NVFalse (with the error in merge and nothing left allocated) if we ran out of memory.  */
+
+uint8_t checkpoint_init (CHECKPOINT *checkpoint, MERGE *merge, char *output_file, int32_t tile_rows)
+{
+  int32_t            i;
+  struct stat        file_stat;
+
+
+  memset (checkpoint, 0, sizeof (CHECKPOINT));
+
+  sprintf (checkpoint->path, "%s.checkpoint", output_file);
+
+
+  /*  The tile size changes the regridded values so it has to match too (the regrid processes are in the options).  */
+
+  manifest_options (merge, checkpoint->options);
+  sprintf (&checkpoint->options[strlen (checkpoint->options)], " tile_rows=%d", tile_rows);
+
+  checkpoint->width = merge->output_header.width;
+  checkpoint->height = merge->output_header.height;
+  checkpoint->file_count = merge->file_count;
+  checkpoint->input_path = merge->inputs.path;
+
+  checkpoint->size = (int64_t *) malloc (checkpoint->file_count * sizeof (int64_t));
+  checkpoint->mtime = (int64_t *) malloc (checkpoint->file_count * sizeof (int64_t));
+
+  if (checkpoint->size == NULL || checkpoint->mtime == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating checkpoint in checkpoint.c: %s", strerror (errno));
+      checkpoint_free (checkpoint);
+      return (NVFalse);
+    }
+
+  for (i = 0 ; i < checkpoint->file_count ; i++)
+    {
+      checkpoint->size[i] = -1;
+      checkpoint->mtime[i] = -1;
+
+      if (!stat (checkpoint->input_path[i], &file_stat))
+        {
+          checkpoint->size[i] = (int64_t) file_stat.st_size;
+          checkpoint->mtime[i] = (int64_t) file_stat.st_mtim.tv_sec * 1000000000 + (int64_t) file_stat.st_mtim.tv_nsec;
+        }
+    }
+
+  checkpoint->done_row = 0;
+  checkpoint->min_z = 9999999999.0;
+  checkpoint->max_z = -9999999999.0;
+
+  return (NVTrue);
+}
+
+
+
+/*  Check an open checkpoint file against the checkpoint and, if it matches, get the progress from it.  */
+
+static uint8_t parse_checkpoint (FILE *fp, CHECKPOINT *checkpoint)
+{
+  char               string[2048];
+  int32_t            i, k, width, height, file_count, done_row;
+  long long          size, mtime;
+  float              min_z, max_z;
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, "CHRTR2_MERGE CHECKPOINT 1", 25)) return (NVFalse);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, "OPTIONS ", 8)) return (NVFalse);
+  string[strcspn (string, "\n")] = 0;
+  if (strcmp (&string[8], checkpoint->options)) return (NVFalse);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "SIZE %d %d", &width, &height) != 2 ||
+      width != checkpoint->width || height != checkpoint->height) return (NVFalse);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "FILES %d", &file_count) != 1 ||
+      file_count != checkpoint->file_count) return (NVFalse);
+
+  for (i = 0 ; i < checkpoint->file_count ; i++)
+    {
+      /*  FILE size mtime path (the path is the rest of the line so it can have spaces in it).  */
+
+      if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "FILE %lld %lld %n", &size, &mtime, &k) != 2) return (NVFalse);
+      string[strcspn (string, "\n")] = 0;
+
+      if (strcmp (&string[k], checkpoint->input_path[i]) || size != checkpoint->size[i] || mtime != checkpoint->mtime[i] ||
+          checkpoint->size[i] < 0) return (NVFalse);
+    }
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "DONE %d %f %f", &done_row, &min_z, &max_z) != 3 ||
+      done_row < 0 || done_row > checkpoint->height) return (NVFalse);
+
+  checkpoint->done_row = done_row;
+  checkpoint->min_z = min_z;
+  checkpoint->max_z = max_z;
+
+  return (NVTrue);
+}
+
+
+
+/*  Read the checkpoint file from an earlier run of the same merge.  Returns NVFalse if there isn't one or it was made by a
+    different merge (in which case we have to start over).  */
+
+uint8_t checkpoint_read (CHECKPOINT *checkpoint)
+{
+  FILE               *fp;
+  uint8_t            match;
+
+
+  if ((fp = fopen (checkpoint->path, "r")) == NULL) return (NVFalse);
+
+  match = parse_checkpoint (fp, checkpoint);
+
+  fclose (fp);
+
+  return (match);
+}
+
+
+
+/*  Write the checkpoint file.  It's written to a temporary file that is synced to the disk and then renamed so that a
+    crash leaves either the old checkpoint or the new one.  The output rows that it claims have to be on the disk first.  */
+
+uint8_t checkpoint_write (CHECKPOINT *checkpoint)
+{
+  FILE               *fp;
+  char               temp[1100];
+  int32_t            i;
+
+
+  sprintf (temp, "%s.tmp", checkpoint->path);
+
+  if ((fp = fopen (temp, "w")) == NULL) return (NVFalse);
+
+  fprintf (fp, "CHRTR2_MERGE CHECKPOINT 1\n");
+  fprintf (fp, "OPTIONS %s\n", checkpoint->options);
+  fprintf (fp, "SIZE %d %d\n", checkpoint->width, checkpoint->height);
+  fprintf (fp, "FILES %d\n", checkpoint->file_count);
+
+  for (i = 0 ; i < checkpoint->file_count ; i++)
+    fprintf (fp, "FILE %lld %lld %s\n", (long long) checkpoint->size[i], (long long) checkpoint->mtime[i], checkpoint->input_path[i]);
+
+  fprintf (fp, "DONE %d %.9g %.9g\n", checkpoint->done_row, checkpoint->min_z, checkpoint->max_z);
+
+  if (fflush (fp) || fsync (fileno (fp)))
+    {
+      fclose (fp);
+      remove (temp);
+      return (NVFalse);
+    }
+
+  if (fclose (fp) || rename (temp, checkpoint->path))
+    {
+      remove (temp);
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+void checkpoint_free (CHECKPOINT *checkpoint)
+{
+  if (checkpoint->size != NULL) free (checkpoint->size);
+  if (checkpoint->mtime != NULL) free (checkpoint->mtime);
+  checkpoint->size = checkpoint->mtime = NULL;
+}
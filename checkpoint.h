@@ -0,0 +1,61 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+
+#include "merge.h"
+
+
+/*  Most output rows that are merged between checkpoints.  */
+
+#define         CHECKPOINT_BAND_ROWS 1024
+
+
+/*  Progress file (OUTPUT_FILE.checkpoint) for --checkpoint.  It's rewritten each time a tile of output rows has been
+    written and synced to the disk and says how far the merge got, so --resume can pick up from there if the merge dies.
+    It only matches a merge with the same options, tile size, and input files (by name, size, and modification time).  */
+
+typedef struct
+{
+  char               path[1024];
+  char               options[1100];   /*  Manifest options plus the tiling  */
+  int32_t            width;
+  int32_t            height;
+  int32_t            file_count;
+  char               **input_path;    /*  Input file names (not copies)  */
+  int64_t            *size;           /*  Input file sizes  */
+  int64_t            *mtime;          /*  Input file modification times (nanoseconds)  */
+  int32_t            done_row;        /*  All of the output rows before this one are on the disk  */
+  float              min_z;           /*  Range of the data in those rows  */
+  float              max_z;
+} CHECKPOINT;
+
+
+uint8_t checkpoint_init (CHECKPOINT *checkpoint, MERGE *merge, char *output_file, int32_t tile_rows);
+uint8_t checkpoint_read (CHECKPOINT *checkpoint);
+uint8_t checkpoint_write (CHECKPOINT *checkpoint);
+void checkpoint_free (CHECKPOINT *checkpoint);
+
+
+#endif
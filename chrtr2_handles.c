@@ -0,0 +1,72 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <pthread.h>
+
+#include "chrtr2_handles.h"
+
+
+static pthread_mutex_t handle_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*  chrtr2_open_file under the handle mutex.  */
+
+int32_t chrtr2_handles_open (char *path, CHRTR2_HEADER *header, int32_t mode)
+{
+  int32_t            handle;
+
+
+  pthread_mutex_lock (&handle_mutex);
+  handle = chrtr2_open_file (path, header, mode);
+  pthread_mutex_unlock (&handle_mutex);
+
+  return (handle);
+}
+
+
+
+/*  chrtr2_create_file under the handle mutex.  */
+
+int32_t chrtr2_handles_create (char *path, CHRTR2_HEADER *header)
+{
+  int32_t            handle;
+
+
+  pthread_mutex_lock (&handle_mutex);
+  handle = chrtr2_create_file (path, header);
+  pthread_mutex_unlock (&handle_mutex);
+
+  return (handle);
+}
+
+
+
+/*  chrtr2_close_file under the handle mutex.  */
+
+void chrtr2_handles_close (int32_t handle)
+{
+  pthread_mutex_lock (&handle_mutex);
+  chrtr2_close_file (handle);
+  pthread_mutex_unlock (&handle_mutex);
+}
@@ -0,0 +1,40 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _CHRTR2_HANDLES_H_
+#define _CHRTR2_HANDLES_H_
+
+#include "chrtr2_merge.h"
+
+
+/*  libchrtr2's handle table isn't protected so two threads that open, create, or close CHRTR2 files at the same time can
+    be given the same table slot.  Every open, create, and close in the process (input and output files, in every merge,
+    thread, and batch job) goes through these so that they're done one at a time.  Reads and writes on a handle that we
+    already have don't touch the table.  */
+
+int32_t chrtr2_handles_open (char *path, CHRTR2_HEADER *header, int32_t mode);
+int32_t chrtr2_handles_create (char *path, CHRTR2_HEADER *header);
+void chrtr2_handles_close (int32_t handle);
+
+
+#endif
@@ -0,0 +1,50 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _CHRTR2_MERGE_H_
+#define _CHRTR2_MERGE_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <time.h>
+
+#include "nvutility.h"
+
+#include "misp.h"
+#include "chrtr2.h"
+
+
+#define         FILTER 9
+#define         EPS 1e-10
+
+
+/*  Status flags that we consider "hard" data (i.e. real, hand-drawn/digitized, or land masked).  These are never replaced by
+    interpolated values and they are what the exclude buffer checks against.  */
+
+#define         HARD_DATA (CHRTR2_REAL | CHRTR2_DIGITIZED_CONTOUR | CHRTR2_LAND_MASK)
+
+
+#endif
@@ -1,5 +1,5 @@
 INCLUDEPATH += /c/PFM_ABEv7.0.0_Win64/include
-LIBS += -L /c/PFM_ABEv7.0.0_Win64/lib -lchrtr2 -lmisp -lnvutility -lgdal -lxml2 -lpoppler -lm -liconv
+LIBS += -L /c/PFM_ABEv7.0.0_Win64/lib -lchrtr2 -lmisp -lnvutility -lgdal -lxml2 -lpoppler -lpthread -lm -liconv
 DEFINES += NVWIN3X
 CONFIG += console
 CONFIG -= qt
@@ -14,5 +14,5 @@ DEPENDPATH += .
 INCLUDEPATH += .
 
 # Input
-HEADERS += version.h
-SOURCES += main.c
+HEADERS += area.h batch.h checkpoint.h chrtr2_handles.h chrtr2_merge.h coverage_map.h exclude_map.h input_cache.h input_decoder.h input_files.h input_map.h input_reader.h manifest.h merge.h merge_context.h merge_grid.h merge_policy.h output_summary.h output_writer.h pipeline.h pyramid.h raster_output.h regrid.h stats.h verify.h version.h
+SOURCES += area.c batch.c checkpoint.c chrtr2_handles.c coverage_map.c exclude_map.c input_cache.c input_decoder.c input_files.c input_map.c input_reader.c main.c manifest.c merge.c merge_context.c merge_grid.c merge_policy.c output_summary.c output_writer.c pipeline.c pyramid.c raster_output.c regrid.c stats.c verify.c
@@ -0,0 +1,117 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "coverage_map.h"
+
+
+/*  Set up an empty coverage map for a grid that is width by rows.  A cell is covered if any of the mask bits are set in its
+    status.  */
+
+uint8_t coverage_map_alloc (COVERAGE_MAP *map, int32_t width, int32_t rows, uint16_t mask)
+{
+  map->width = width;
+  map->rows = rows;
+  map->chunks = (width + COVERAGE_CHUNK - 1) / COVERAGE_CHUNK;
+  map->mask = mask;
+
+  map->count = (uint8_t *) calloc ((size_t) rows * (size_t) map->chunks, sizeof (uint8_t));
+  if (map->count == NULL) return (NVFalse);
+
+  pthread_mutex_init (&map->mutex, NULL);
+
+  return (NVTrue);
+}
+
+
+
+/*  Recount the covered cells in the chunks of grid row row (not output row) that columns start_x through end_x - 1 touch
+    after an input file has been inserted into them.  */
+
+void coverage_map_update (COVERAGE_MAP *map, MERGE_GRID *grid, int32_t row, int32_t start_x, int32_t end_x)
+{
+  int32_t            i, j, end;
+  uint8_t            count;
+  uint16_t           *status;
+  GRID_TILE          *tile;
+
+
+  if (start_x >= end_x) return;
+
+  for (i = start_x / COVERAGE_CHUNK ; i <= (end_x - 1) / COVERAGE_CHUNK ; i++)
+    {
+      end = MIN ((i + 1) * COVERAGE_CHUNK, map->width);
+
+
+      /*  A chunk is one row of a grid tile so there's nothing to count if the tile has never had any data.  */
+
+      count = 0;
+      tile = merge_grid_tile (grid, row, i * COVERAGE_CHUNK);
+
+      if (tile != &merge_grid_null_tile)
+        {
+          status = &tile->status[merge_grid_offset (row, 0)];
+          for (j = 0 ; j < end - i * COVERAGE_CHUNK ; j++) if (status[j] & map->mask) count++;
+        }
+
+      pthread_mutex_lock (&map->mutex);
+      map->count[(size_t) row * map->chunks + i] = count;
+      pthread_mutex_unlock (&map->mutex);
+    }
+}
+
+
+
+/*  Returns NVTrue if every chunk that columns start_x through end_x - 1 of grid row row touch is full.  Since we only look
+    at whole chunks this can say a span isn't full when it really is, but never the other way around.  */
+
+uint8_t coverage_map_full (COVERAGE_MAP *map, int32_t row, int32_t start_x, int32_t end_x)
+{
+  int32_t            i, cells;
+  uint8_t            full = NVTrue;
+
+
+  if (start_x >= end_x) return (NVTrue);
+
+  pthread_mutex_lock (&map->mutex);
+
+  for (i = start_x / COVERAGE_CHUNK ; i <= (end_x - 1) / COVERAGE_CHUNK && full ; i++)
+    {
+      cells = MIN ((i + 1) * COVERAGE_CHUNK, map->width) - i * COVERAGE_CHUNK;
+
+      if (map->count[(size_t) row * map->chunks + i] != cells) full = NVFalse;
+    }
+
+  pthread_mutex_unlock (&map->mutex);
+
+  return (full);
+}
+
+
+
+void coverage_map_free (COVERAGE_MAP *map)
+{
+  if (map->count != NULL) free (map->count);
+  map->count = NULL;
+
+  pthread_mutex_destroy (&map->mutex);
+}
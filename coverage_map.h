@@ -0,0 +1,61 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _COVERAGE_MAP_H_
+#define _COVERAGE_MAP_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "merge_grid.h"
+
+
+/*  Number of columns in each coverage chunk.  This has to fit in the uint8_t counts.  A chunk is one row of a grid tile.  */
+
+#define         COVERAGE_CHUNK GRID_TILE_SIZE
+
+
+/*  Coverage of the grid by the input files that have been inserted so far.  For each chunk of COVERAGE_CHUNK columns of each
+    grid row we keep the number of cells that a lower precedence file can't change (any data at all in the default mode,
+    hard data in exclude mode, see merge_policy_coverage).  Once a cell is covered it stays covered so a chunk that's full can never change again and
+    any input row that only lands on full chunks doesn't have to be read.  The reader threads check the coverage while the
+    main thread is updating it so the counts are only touched under the mutex.  */
+
+typedef struct
+{
+  int32_t            width;
+  int32_t            rows;
+  int32_t            chunks;          /*  Chunks per row  */
+  uint16_t           mask;            /*  Status bits that make a cell covered  */
+  uint8_t            *count;          /*  Covered cells in each chunk (rows * chunks)  */
+  pthread_mutex_t    mutex;
+} COVERAGE_MAP;
+
+
+uint8_t coverage_map_alloc (COVERAGE_MAP *map, int32_t width, int32_t rows, uint16_t mask);
+void coverage_map_update (COVERAGE_MAP *map, MERGE_GRID *grid, int32_t row, int32_t start_x, int32_t end_x);
+uint8_t coverage_map_full (COVERAGE_MAP *map, int32_t row, int32_t start_x, int32_t end_x);
+void coverage_map_free (COVERAGE_MAP *map);
+
+
+#endif
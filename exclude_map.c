@@ -0,0 +1,141 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "exclude_map.h"
+
+
+/*  Convert an exclude buffer size to a number of grid cells in X and Y for the grid defined by header.  If the size is in
+    meters we use the cell size at the center of the grid.  Only cells that are entirely within the buffer distance are
+    counted so a buffer that is smaller than a grid cell only excludes the cell itself.  */
+
+void exclude_buffer_cells (CHRTR2_HEADER *header, float size, uint8_t meters, int32_t *buffer_x, int32_t *buffer_y)
+{
+  double             center_lat, center_lon, x_size, y_size, az;
+
+
+  if (!meters)
+    {
+      *buffer_x = *buffer_y = NINT (size);
+      return;
+    }
+
+
+  center_lat = header->mbr.slat + (header->mbr.nlat - header->mbr.slat) / 2.0;
+  center_lon = header->mbr.wlon + (header->mbr.elon - header->mbr.wlon) / 2.0;
+
+  invgp (NV_A0, NV_B0, center_lat, center_lon, center_lat, center_lon + header->lon_grid_size_degrees, &x_size, &az);
+  invgp (NV_A0, NV_B0, center_lat, center_lon, center_lat + header->lat_grid_size_degrees, center_lon, &y_size, &az);
+
+  *buffer_x = (int32_t) (size / x_size);
+  *buffer_y = (int32_t) (size / y_size);
+}
+
+
+
+/*  Allocate the summed-area table for (any window of) a width by height grid.  */
+
+uint8_t exclude_map_alloc (EXCLUDE_MAP *map, int32_t width, int32_t height)
+{
+  memset (map, 0, sizeof (EXCLUDE_MAP));
+
+  map->width = width;
+  map->height = height;
+
+  map->sum = (uint32_t *) calloc (((size_t) width + 1) * ((size_t) height + 1), sizeof (uint32_t));
+  if (map->sum == NULL) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+/*  Rebuild the summed-area table for grid columns start_x through end_x - 1 and rows start_y through end_y - 1 from the
+    hard data currently in the grid.  The merge calls this once before each input file (after the first) is inserted with
+    the part of the grid that the file's exclude buffer boxes can reach, so the cost of each build goes with the size of
+    the file and not the grid.  Since cells that the current file inserts get that file's rank they never count against
+    it in the exclude test, so the mask of "hard data from higher precedence files" can't change while the file is being
+    inserted and one build per file gives exactly the same answer as checking the whole buffer box for every cell.  */
+
+void exclude_map_build (EXCLUDE_MAP *map, MERGE_GRID *grid, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y)
+{
+  int32_t            i, j, k, cols;
+  size_t             stride;
+  uint32_t           row_sum, *prev, *curr;
+  uint16_t           *status;
+  GRID_TILE          *tile;
+
+
+  map->x = start_x;
+  map->y = start_y;
+  map->cols = end_x - start_x;
+  map->rows = end_y - start_y;
+
+  stride = (size_t) map->cols + 1;
+
+
+  /*  The top row and left column of the table are always zero.  */
+
+  memset (map->sum, 0, stride * sizeof (uint32_t));
+
+  for (i = start_y ; i < end_y ; i++)
+    {
+      prev = map->sum + (size_t) (i - start_y) * stride;
+      curr = prev + stride;
+
+      curr[0] = 0;
+
+      row_sum = 0;
+      for (j = start_x ; j < end_x ; j += cols)
+        {
+          cols = MIN (GRID_TILE_SIZE - (j & GRID_TILE_MASK), end_x - j);
+          tile = merge_grid_tile (grid, i, j);
+
+
+          /*  Tiles that have never had any data don't add anything to the row sum.  */
+
+          if (tile == &merge_grid_null_tile)
+            {
+              for (k = j - start_x ; k < j - start_x + cols ; k++) curr[k + 1] = prev[k + 1] + row_sum;
+            }
+          else
+            {
+              status = &tile->status[merge_grid_offset (i, j)];
+
+              for (k = 0 ; k < cols ; k++)
+                {
+                  if (status[k] & HARD_DATA) row_sum++;
+
+                  curr[j - start_x + k + 1] = prev[j - start_x + k + 1] + row_sum;
+                }
+            }
+        }
+    }
+}
+
+
+
+void exclude_map_free (EXCLUDE_MAP *map)
+{
+  if (map->sum != NULL) free (map->sum);
+  map->sum = NULL;
+}
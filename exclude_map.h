@@ -0,0 +1,103 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _EXCLUDE_MAP_H_
+#define _EXCLUDE_MAP_H_
+
+#include "chrtr2_merge.h"
+#include "merge_grid.h"
+
+
+/*  Summed-area table of the "hard data" mask of a window of the output grid (columns x through x + cols - 1 and rows y
+    through y + rows - 1).  Entry [j][i] of the table (which is (cols + 1) by (rows + 1) in size) is the number of hard data
+    cells in the grid rectangle [y, y + j) x [x, x + i).  This lets us count the hard data cells in any exclude buffer box
+    in the window with four lookups regardless of the size of the box.  The merge only builds the window that the next
+    input file's exclude buffer boxes can reach.  The counts are unsigned so that, even if the table overflows on a
+    gigantic grid, the modular arithmetic of the box difference is still correct (a single box can never hold more than
+    2^32 cells).  */
+
+typedef struct
+{
+  int32_t            width;           /*  Size of the grid (the boxes are clipped to it)  */
+  int32_t            height;
+  int32_t            x;               /*  Grid column and row of the first cell of the window  */
+  int32_t            y;
+  int32_t            cols;            /*  Size of the window  */
+  int32_t            rows;
+  uint32_t           *sum;
+} EXCLUDE_MAP;
+
+
+void exclude_buffer_cells (CHRTR2_HEADER *header, float size, uint8_t meters, int32_t *buffer_x, int32_t *buffer_y);
+uint8_t exclude_map_alloc (EXCLUDE_MAP *map, int32_t width, int32_t height);
+void exclude_map_build (EXCLUDE_MAP *map, MERGE_GRID *grid, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y);
+void exclude_map_free (EXCLUDE_MAP *map);
+
+
+/*  Returns the number of hard data cells in grid columns start_x through end_x - 1 and rows start_y through end_y - 1.
+    The box has to be inside the window of the map.  */
+
+static inline uint32_t exclude_map_count (EXCLUDE_MAP *map, int32_t start_x, int32_t start_y, int32_t end_x, int32_t end_y)
+{
+  size_t             stride;
+  uint32_t           *top, *bottom;
+
+
+  stride = (size_t) map->cols + 1;
+  top = map->sum + (size_t) (start_y - map->y) * stride;
+  bottom = map->sum + (size_t) (end_y - map->y) * stride;
+  start_x -= map->x;
+  end_x -= map->x;
+
+  return (bottom[end_x] - bottom[start_x] - top[end_x] + top[start_x]);
+}
+
+
+/*  Returns NVTrue if there is any hard data in the map within buffer_x columns and buffer_y rows of x, y.  The box is
+    clipped to the grid the same way the old cell by cell search was.  */
+
+static inline uint8_t exclude_map_hit (EXCLUDE_MAP *map, int32_t x, int32_t y, int32_t buffer_x, int32_t buffer_y)
+{
+  return (exclude_map_count (map, MAX (x - buffer_x, 0), MAX (y - buffer_y, 0), MIN (x + buffer_x, map->width - 1) + 1,
+                             MIN (y + buffer_y, map->height - 1) + 1) != 0);
+}
+
+
+/*  Returns NVTrue if there is anything other than hard data (a hole) in the map within buffer_x columns and buffer_y rows of
+    x, y.  This is the inverse of exclude_map_hit and is what the hole only regrid uses to pick its control points.  */
+
+static inline uint8_t exclude_map_hole (EXCLUDE_MAP *map, int32_t x, int32_t y, int32_t buffer_x, int32_t buffer_y)
+{
+  int32_t            start_x, end_x, start_y, end_y;
+
+
+  start_x = MAX (x - buffer_x, 0);
+  end_x = MIN (x + buffer_x, map->width - 1) + 1;
+  start_y = MAX (y - buffer_y, 0);
+  end_y = MIN (y + buffer_y, map->height - 1) + 1;
+
+  return (exclude_map_count (map, start_x, start_y, end_x, end_y) != (uint32_t) ((end_x - start_x) * (end_y - start_y)));
+}
+
+
+#endif
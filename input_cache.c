@@ -0,0 +1,375 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <sys/stat.h>
+
+#include "input_cache.h"
+#include "chrtr2_handles.h"
+
+
+/*  Set up an empty cache that keeps up to max_open input files open and up to max_bytes of decoded input rows.  */
+
+void input_cache_init (INPUT_CACHE *cache, int32_t max_open, int64_t max_bytes)
+{
+  memset (cache, 0, sizeof (INPUT_CACHE));
+
+  cache->max_open = max_open;
+  cache->max_bytes = max_bytes;
+
+  pthread_mutex_init (&cache->mutex, NULL);
+}
+
+
+
+/*  Returns the cache file number for path, adding it to the cache if it isn't already there.  A file is only the same cache
+    file if its size and modification time haven't changed since it was added, so a file that an earlier job in the batch
+    wrote over gets a new cache file number and nothing that was read from the old one (handles, header, or blocks of rows)
+    is used for it.  The old file's idle handles and blocks are thrown out as the cache needs room.  Returns -1 if we ran out
+    of memory.  */
+
+int32_t input_cache_file (INPUT_CACHE *cache, char *path)
+{
+  int32_t            i;
+  int64_t            size = -1, mtime = -1, *sizes, *mtimes;
+  char               **paths;
+  CHRTR2_HEADER      *headers;
+  struct stat        file_stat;
+
+
+  if (!stat (path, &file_stat))
+    {
+      size = (int64_t) file_stat.st_size;
+      mtime = (int64_t) file_stat.st_mtim.tv_sec * 1000000000 + (int64_t) file_stat.st_mtim.tv_nsec;
+    }
+
+
+  pthread_mutex_lock (&cache->mutex);
+
+  for (i = 0 ; i < cache->file_count ; i++)
+    {
+      if (!strcmp (cache->path[i], path) && cache->size[i] == size && cache->mtime[i] == mtime) break;
+    }
+
+  if (i == cache->file_count)
+    {
+      /*  The arrays that did grow stay grown so the cache is still good if one of them couldn't.  */
+
+      if ((paths = (char **) realloc (cache->path, (cache->file_count + 1) * sizeof (char *))) != NULL) cache->path = paths;
+      if ((sizes = (int64_t *) realloc (cache->size, (cache->file_count + 1) * sizeof (int64_t))) != NULL) cache->size = sizes;
+      if ((mtimes = (int64_t *) realloc (cache->mtime, (cache->file_count + 1) * sizeof (int64_t))) != NULL) cache->mtime = mtimes;
+      if ((headers = (CHRTR2_HEADER *) realloc (cache->header, (cache->file_count + 1) * sizeof (CHRTR2_HEADER))) != NULL)
+        cache->header = headers;
+
+      if (paths == NULL || sizes == NULL || mtimes == NULL || headers == NULL || (cache->path[i] = strdup (path)) == NULL)
+        {
+          pthread_mutex_unlock (&cache->mutex);
+          return (-1);
+        }
+
+      cache->size[i] = size;
+      cache->mtime[i] = mtime;
+
+      cache->file_count++;
+    }
+
+  pthread_mutex_unlock (&cache->mutex);
+
+  return (i);
+}
+
+
+
+/*  Close idle handle number i and take it out of the list.  Has to be called with the mutex locked.  */
+
+static void close_handle (INPUT_CACHE *cache, int32_t i)
+{
+  chrtr2_handles_close (cache->handle[i].handle);
+
+  cache->handle[i] = cache->handle[--cache->handle_count];
+}
+
+
+
+/*  Close the least recently used idle handle (if there are any).  Has to be called with the mutex locked.  */
+
+static void close_oldest (INPUT_CACHE *cache)
+{
+  int32_t            i, oldest = -1;
+
+
+  for (i = 0 ; i < cache->handle_count ; i++)
+    {
+      if (!cache->handle[i].in_use && (oldest < 0 || cache->handle[i].last_used < cache->handle[oldest].last_used)) oldest = i;
+    }
+
+  if (oldest >= 0) close_handle (cache, oldest);
+}
+
+
+
+/*  Get a handle for cache file file that nobody else is using, either an idle one from an earlier merge or a newly opened
+    one.  The file's header is put in header.  Returns -1 if the file couldn't be opened (check chrtr2_strerror).  */
+
+int32_t input_cache_open (INPUT_CACHE *cache, int32_t file, CHRTR2_HEADER *header)
+{
+  int32_t            i, handle;
+  CACHE_HANDLE       *handles;
+
+
+  pthread_mutex_lock (&cache->mutex);
+
+  for (i = 0 ; i < cache->handle_count ; i++)
+    {
+      if (cache->handle[i].file == file && !cache->handle[i].in_use)
+        {
+          cache->handle[i].in_use = NVTrue;
+          cache->handle_hits++;
+
+          *header = cache->header[file];
+          handle = cache->handle[i].handle;
+
+          pthread_mutex_unlock (&cache->mutex);
+
+          return (handle);
+        }
+    }
+
+
+  if (cache->handle_count >= cache->max_open) close_oldest (cache);
+
+  handle = chrtr2_handles_open (cache->path[file], header, CHRTR2_READONLY);
+
+  if (handle >= 0)
+    {
+      cache->header[file] = *header;
+      cache->handle_opens++;
+
+
+      /*  If we can't keep track of the handle it's still good, it just gets closed instead of kept (see input_cache_close).  */
+
+      if ((handles = (CACHE_HANDLE *) realloc (cache->handle, (cache->handle_count + 1) * sizeof (CACHE_HANDLE))) == NULL)
+        {
+          pthread_mutex_unlock (&cache->mutex);
+          return (handle);
+        }
+
+      cache->handle = handles;
+
+      cache->handle[cache->handle_count].file = file;
+      cache->handle[cache->handle_count].handle = handle;
+      cache->handle[cache->handle_count].in_use = NVTrue;
+      cache->handle_count++;
+    }
+
+  pthread_mutex_unlock (&cache->mutex);
+
+  return (handle);
+}
+
+
+
+/*  We're done with handle.  It stays open (unless there are too many open handles, or the cache couldn't keep track of it)
+    for the next merge that needs the file.  */
+
+void input_cache_close (INPUT_CACHE *cache, int32_t handle)
+{
+  int32_t            i;
+
+
+  pthread_mutex_lock (&cache->mutex);
+
+  for (i = 0 ; i < cache->handle_count ; i++)
+    {
+      if (cache->handle[i].handle == handle && cache->handle[i].in_use)
+        {
+          cache->handle[i].in_use = NVFalse;
+          cache->handle[i].last_used = ++cache->clock;
+          break;
+        }
+    }
+
+  if (i == cache->handle_count) chrtr2_handles_close (handle);
+
+  if (cache->handle_count > cache->max_open) close_oldest (cache);
+
+  pthread_mutex_unlock (&cache->mutex);
+}
+
+
+
+/*  Returns the number of the block that matches or -1.  Has to be called with the mutex locked.  */
+
+static int32_t find_block (INPUT_CACHE *cache, int32_t file, int32_t start_row, int32_t rows, int32_t start_col, int32_t cols)
+{
+  int32_t            i;
+  CACHE_BLOCK        *block;
+
+
+  for (i = 0 ; i < cache->block_count ; i++)
+    {
+      block = &cache->block[i];
+
+      if (block->file == file && block->start_row == start_row && block->rows == rows && block->start_col == start_col &&
+          block->cols == cols) return (i);
+    }
+
+  return (-1);
+}
+
+
+
+/*  Get rows rows of columns start_col through start_col + cols - 1, starting at input row start_row, of cache file file
+    into records.  If the block is in the cache we copy it from there, otherwise we read it with handle (which has to be
+    ours from input_cache_open) and add it to the cache.  Returns NVFalse if the library couldn't read a row (check
+    chrtr2_strerror).  */
+
+uint8_t input_cache_read (INPUT_CACHE *cache, int32_t file, int32_t handle, int32_t start_row, int32_t rows, int32_t start_col,
+                          int32_t cols, CHRTR2_RECORD *records)
+{
+  int32_t            i, oldest;
+  size_t             size;
+  CHRTR2_RECORD      *copy;
+  CACHE_BLOCK        *block, *blocks;
+
+
+  size = (size_t) rows * (size_t) cols * sizeof (CHRTR2_RECORD);
+
+
+  /*  The block is pinned while we copy it so it can't be thrown out from under us.  */
+
+  pthread_mutex_lock (&cache->mutex);
+
+  if ((i = find_block (cache, file, start_row, rows, start_col, cols)) >= 0)
+    {
+      block = &cache->block[i];
+      block->pins++;
+      block->last_used = ++cache->clock;
+      copy = block->records;
+      cache->block_hits++;
+
+      pthread_mutex_unlock (&cache->mutex);
+
+      memcpy (records, copy, size);
+
+      pthread_mutex_lock (&cache->mutex);
+      cache->block[find_block (cache, file, start_row, rows, start_col, cols)].pins--;
+      pthread_mutex_unlock (&cache->mutex);
+
+      return (NVTrue);
+    }
+
+  cache->block_misses++;
+
+  pthread_mutex_unlock (&cache->mutex);
+
+
+  for (i = 0 ; i < rows ; i++)
+    {
+      if (chrtr2_read_record_row (handle, start_row + i, start_col, cols, &records[(size_t) i * (size_t) cols])) return (NVFalse);
+    }
+
+
+  /*  Keep a copy if it fits.  Another merge may have read the same block while we were reading it.  */
+
+  if ((int64_t) size > cache->max_bytes || (copy = (CHRTR2_RECORD *) malloc (size)) == NULL) return (NVTrue);
+
+  memcpy (copy, records, size);
+
+  pthread_mutex_lock (&cache->mutex);
+
+  if (find_block (cache, file, start_row, rows, start_col, cols) < 0)
+    {
+      while (cache->bytes + (int64_t) size > cache->max_bytes)
+        {
+          oldest = -1;
+          for (i = 0 ; i < cache->block_count ; i++)
+            {
+              if (!cache->block[i].pins && (oldest < 0 || cache->block[i].last_used < cache->block[oldest].last_used)) oldest = i;
+            }
+
+          if (oldest < 0) break;
+
+          cache->bytes -= (int64_t) cache->block[oldest].rows * (int64_t) cache->block[oldest].cols * sizeof (CHRTR2_RECORD);
+          free (cache->block[oldest].records);
+          cache->block[oldest] = cache->block[--cache->block_count];
+        }
+
+      /*  If we can't grow the block list we just don't keep the copy.  */
+
+      if (cache->bytes + (int64_t) size <= cache->max_bytes &&
+          (blocks = (CACHE_BLOCK *) realloc (cache->block, (cache->block_count + 1) * sizeof (CACHE_BLOCK))) != NULL)
+        {
+          cache->block = blocks;
+
+          block = &cache->block[cache->block_count++];
+          block->file = file;
+          block->start_row = start_row;
+          block->rows = rows;
+          block->start_col = start_col;
+          block->cols = cols;
+          block->pins = 0;
+          block->last_used = ++cache->clock;
+          block->records = copy;
+
+          cache->bytes += (int64_t) size;
+          copy = NULL;
+        }
+    }
+
+  pthread_mutex_unlock (&cache->mutex);
+
+  if (copy != NULL) free (copy);
+
+  return (NVTrue);
+}
+
+
+
+void input_cache_report (INPUT_CACHE *cache)
+{
+  fprintf (stderr, "Input cache : %lld of %lld input file opens used an open handle, %lld of %lld blocks of rows were already decoded\n\n",
+           (long long) cache->handle_hits, (long long) (cache->handle_hits + cache->handle_opens), (long long) cache->block_hits,
+           (long long) (cache->block_hits + cache->block_misses));
+  fflush (stderr);
+}
+
+
+
+void input_cache_free (INPUT_CACHE *cache)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < cache->handle_count ; i++) chrtr2_handles_close (cache->handle[i].handle);
+  for (i = 0 ; i < cache->block_count ; i++) free (cache->block[i].records);
+  for (i = 0 ; i < cache->file_count ; i++) free (cache->path[i]);
+
+  if (cache->handle != NULL) free (cache->handle);
+  if (cache->block != NULL) free (cache->block);
+  if (cache->path != NULL) free (cache->path);
+  if (cache->size != NULL) free (cache->size);
+  if (cache->mtime != NULL) free (cache->mtime);
+  if (cache->header != NULL) free (cache->header);
+
+  pthread_mutex_destroy (&cache->mutex);
+}
@@ -0,0 +1,98 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _INPUT_CACHE_H_
+#define _INPUT_CACHE_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+
+
+/*  An open CHRTR2 handle for one of the cache's files.  A handle is only ever used by one merge at a time.  */
+
+typedef struct
+{
+  int32_t            file;            /*  Cache file number  */
+  int32_t            handle;
+  uint8_t            in_use;
+  int64_t            last_used;
+} CACHE_HANDLE;
+
+
+/*  A block of decoded input rows.  rows rows of columns start_col through start_col + cols - 1 starting at input row
+    start_row of file.  */
+
+typedef struct
+{
+  int32_t            file;
+  int32_t            start_row;
+  int32_t            rows;
+  int32_t            start_col;
+  int32_t            cols;
+  int32_t            pins;            /*  Number of readers copying the block  */
+  int64_t            last_used;
+  CHRTR2_RECORD      *records;
+} CACHE_BLOCK;
+
+
+/*  Open handles and decoded blocks of input rows that are shared by all of the merges in a batch (--batch).  Handles that a
+    merge is done with go back in the cache instead of being closed so the next merge that uses the same file doesn't have
+    to open it again.  Blocks of rows that were read are kept (least recently used blocks are thrown out once there are
+    max_bytes of them) so merges with overlapping inputs don't have to read and decode them again.  Least recently used
+    idle handles are closed to keep no more than max_open input files open.  */
+
+typedef struct
+{
+  pthread_mutex_t    mutex;
+  int32_t            file_count;
+  char               **path;          /*  Path of each cache file  */
+  int64_t            *size;           /*  Size of each cache file when it was added  */
+  int64_t            *mtime;          /*  Modification time (nanoseconds) of each cache file when it was added  */
+  CHRTR2_HEADER      *header;         /*  Header of each cache file (once it has been opened)  */
+  int32_t            handle_count;
+  CACHE_HANDLE       *handle;
+  int32_t            max_open;        /*  Idle handles are closed to keep the total under this  */
+  int32_t            block_count;
+  CACHE_BLOCK        *block;
+  int64_t            bytes;           /*  Bytes of records in the blocks  */
+  int64_t            max_bytes;
+  int64_t            clock;
+  int64_t            handle_hits;     /*  Opens that were satisfied by an idle handle  */
+  int64_t            handle_opens;
+  int64_t            block_hits;
+  int64_t            block_misses;
+} INPUT_CACHE;
+
+
+void input_cache_init (INPUT_CACHE *cache, int32_t max_open, int64_t max_bytes);
+int32_t input_cache_file (INPUT_CACHE *cache, char *path);
+int32_t input_cache_open (INPUT_CACHE *cache, int32_t file, CHRTR2_HEADER *header);
+void input_cache_close (INPUT_CACHE *cache, int32_t handle);
+uint8_t input_cache_read (INPUT_CACHE *cache, int32_t file, int32_t handle, int32_t start_row, int32_t rows, int32_t start_col,
+                          int32_t cols, CHRTR2_RECORD *records);
+void input_cache_report (INPUT_CACHE *cache);
+void input_cache_free (INPUT_CACHE *cache);
+
+
+#endif
@@ -0,0 +1,285 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "input_decoder.h"
+
+
+/*  Returns NVTrue if input row j lands on output that is already fully covered.  */
+
+static inline uint8_t row_covered (INPUT_DECODER *decoder, INPUT_MAP *map, int32_t j)
+{
+  return (map->out_y[j] < 0 ||
+          coverage_map_full (decoder->coverage, map->out_y[j] - decoder->start_row, map->out_start_x, map->out_end_x));
+}
+
+
+
+/*  Read the rows of one input file that land in the output rows being merged.  libchrtr2 keeps all of its I/O state per
+    handle so workers reading different files don't step on each other.  The file isn't even opened if all of its rows land
+    on covered output, and the read blocks stop at covered rows so they're never read.  Returns DECODE_DONE or
+    DECODE_FAILED.  */
+
+static uint8_t decode_file (INPUT_DECODER *decoder, DECODED_INPUT *input)
+{
+  int32_t            j, handle, run_end, rows = 0;
+  INPUT_READER       reader;
+  CHRTR2_RECORD      *row;
+  STATS_TIMER        timer;
+
+
+  input_map_rows (input->map, decoder->start_row, decoder->end_row, &input->first_row, &input->end_row);
+
+  input->cols = input->map->end_col - input->map->start_col;
+  input->records = NULL;
+  input->rows_skipped = 0;
+
+  if (input->cols <= 0 || input->first_row == input->end_row) return (DECODE_DONE);
+
+  for (j = input->first_row ; j < input->end_row && row_covered (decoder, input->map, j) ; j++)
+    if (input->map->out_y[j] >= 0) input->rows_skipped++;
+
+  if (j == input->end_row) return (DECODE_DONE);
+
+  input->rows_skipped = 0;
+
+
+  if ((handle = input_files_open (decoder->files, input->file)) < 0)
+    {
+      input->failed_row = -2;
+      return (DECODE_FAILED);
+    }
+
+  stats_start (decoder->stats, &timer);
+
+  input->records = (CHRTR2_RECORD *) malloc ((size_t) (input->end_row - input->first_row) * (size_t) input->cols * sizeof (CHRTR2_RECORD));
+
+  if (input->records == NULL || !input_reader_open (&reader, handle, input->map->height, input->map->start_col, input->cols,
+                                                   decoder->files->cache, decoder->files->cache_file[input->file]))
+    {
+      input_files_release (decoder->files, input->file);
+      input->failed_row = -1;
+      return (DECODE_FAILED);
+    }
+
+  for (j = input->first_row, run_end = input->first_row ; j < input->end_row ; j++)
+    {
+      if (j >= run_end)
+        {
+          if (row_covered (decoder, input->map, j))
+            {
+              if (input->map->out_y[j] >= 0) input->rows_skipped++;
+              continue;
+            }
+
+          for (run_end = j + 1 ; run_end < input->end_row && !row_covered (decoder, input->map, run_end) ; run_end++);
+        }
+
+      row = input_reader_row (&reader, j, run_end);
+
+      if (row == NULL)
+        {
+          input_reader_close (&reader);
+          input_files_release (decoder->files, input->file);
+          input->failed_row = j;
+          return (DECODE_FAILED);
+        }
+
+      memcpy (&input->records[(size_t) (j - input->first_row) * (size_t) input->cols], row, input->cols * sizeof (CHRTR2_RECORD));
+      rows++;
+    }
+
+  input_reader_close (&reader);
+  input_files_release (decoder->files, input->file);
+
+  stats_stop (decoder->stats, &timer, STATS_READ, input->file, (int64_t) rows * input->cols,
+              (int64_t) rows * input->cols * sizeof (CHRTR2_RECORD));
+
+  return (DECODE_DONE);
+}
+
+
+
+static void *decoder_thread (void *arg)
+{
+  INPUT_DECODER      *decoder = (INPUT_DECODER *) arg;
+  int32_t            file;
+  uint8_t            status;
+
+
+  while (NVTrue)
+    {
+      /*  Wait for the next file, making sure we don't get too far ahead of the caller.  */
+
+      pthread_mutex_lock (&decoder->mutex);
+
+      while (decoder->next_file < decoder->file_count && decoder->next_file - decoder->released >= decoder->max_in_flight)
+        pthread_cond_wait (&decoder->cond, &decoder->mutex);
+
+      if (decoder->next_file >= decoder->file_count)
+        {
+          pthread_mutex_unlock (&decoder->mutex);
+          break;
+        }
+
+      file = decoder->next_file++;
+
+      pthread_mutex_unlock (&decoder->mutex);
+
+
+      status = decode_file (decoder, &decoder->inputs[file]);
+
+
+      /*  The status has to be changed under the lock so the caller can't miss the wakeup.  */
+
+      pthread_mutex_lock (&decoder->mutex);
+      decoder->inputs[file].status = status;
+      pthread_cond_broadcast (&decoder->cond);
+      pthread_mutex_unlock (&decoder->mutex);
+    }
+
+  return (NULL);
+}
+
+
+
+/*  Start thread_count workers decoding the parts of the file_count input files in list (file list[i] of files, mapped by
+    map[list[i]]) that land in output rows start_row through end_row - 1 (the rows of coverage).  The decoded files are
+    numbered by their position in list.  */
+
+uint8_t input_decoder_start (INPUT_DECODER *decoder, INPUT_FILES *files, INPUT_MAP *map, COVERAGE_MAP *coverage, MERGE_STATS *stats,
+                             int32_t *list, int32_t file_count, int32_t start_row, int32_t end_row, int32_t thread_count)
+{
+  int32_t            i;
+
+
+  decoder->files = files;
+  decoder->coverage = coverage;
+  decoder->stats = stats;
+  decoder->file_count = file_count;
+  decoder->thread_count = MAX (MIN (thread_count, file_count), 1);
+  decoder->max_in_flight = decoder->thread_count;
+  decoder->next_file = 0;
+  decoder->released = 0;
+  decoder->start_row = start_row;
+  decoder->end_row = end_row;
+
+  decoder->inputs = (DECODED_INPUT *) calloc (MAX (file_count, 1), sizeof (DECODED_INPUT));
+  decoder->threads = (pthread_t *) calloc (decoder->thread_count, sizeof (pthread_t));
+  if (decoder->inputs == NULL || decoder->threads == NULL)
+    {
+      free (decoder->inputs);
+      free (decoder->threads);
+      return (NVFalse);
+    }
+
+  for (i = 0 ; i < file_count ; i++)
+    {
+      decoder->inputs[i].file = list[i];
+      decoder->inputs[i].map = &map[list[i]];
+      decoder->inputs[i].status = DECODE_PENDING;
+    }
+
+  pthread_mutex_init (&decoder->mutex, NULL);
+  pthread_cond_init (&decoder->cond, NULL);
+
+  for (i = 0 ; i < decoder->thread_count ; i++)
+    {
+      /*  Stop the workers that did start.  */
+
+      if (pthread_create (&decoder->threads[i], NULL, decoder_thread, decoder))
+        {
+          decoder->thread_count = i;
+          input_decoder_finish (decoder);
+          return (NVFalse);
+        }
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Block until input file number file has been decoded.  Check the status of the returned input for DECODE_FAILED.  */
+
+DECODED_INPUT *input_decoder_wait (INPUT_DECODER *decoder, int32_t file)
+{
+  DECODED_INPUT      *input = &decoder->inputs[file];
+
+
+  pthread_mutex_lock (&decoder->mutex);
+
+  while (input->status == DECODE_PENDING) pthread_cond_wait (&decoder->cond, &decoder->mutex);
+
+  pthread_mutex_unlock (&decoder->mutex);
+
+  return (input);
+}
+
+
+
+/*  Let go of the decoded data for file so that the workers can move on to the next one.  Files have to be released in
+    order.  */
+
+void input_decoder_release (INPUT_DECODER *decoder, int32_t file)
+{
+  DECODED_INPUT      *input = &decoder->inputs[file];
+
+
+  if (input->records != NULL) free (input->records);
+  input->records = NULL;
+
+  pthread_mutex_lock (&decoder->mutex);
+  decoder->released = file + 1;
+  pthread_cond_broadcast (&decoder->cond);
+  pthread_mutex_unlock (&decoder->mutex);
+}
+
+
+
+/*  Wait for the workers to finish and free everything.  If the caller stopped early (something failed) the workers don't
+    start on any more files.  */
+
+void input_decoder_finish (INPUT_DECODER *decoder)
+{
+  int32_t            i;
+
+
+  pthread_mutex_lock (&decoder->mutex);
+  decoder->next_file = decoder->file_count;
+  decoder->released = decoder->file_count;
+  pthread_cond_broadcast (&decoder->cond);
+  pthread_mutex_unlock (&decoder->mutex);
+
+  for (i = 0 ; i < decoder->thread_count ; i++) pthread_join (decoder->threads[i], NULL);
+
+  for (i = 0 ; i < decoder->file_count ; i++)
+    {
+      if (decoder->inputs[i].records != NULL) free (decoder->inputs[i].records);
+    }
+
+  pthread_mutex_destroy (&decoder->mutex);
+  pthread_cond_destroy (&decoder->cond);
+
+  free (decoder->inputs);
+  free (decoder->threads);
+}
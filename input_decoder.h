@@ -0,0 +1,90 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _INPUT_DECODER_H_
+#define _INPUT_DECODER_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "coverage_map.h"
+#include "input_files.h"
+#include "input_map.h"
+#include "input_reader.h"
+#include "stats.h"
+
+
+#define         DECODE_PENDING 0
+#define         DECODE_DONE 1
+#define         DECODE_FAILED 2
+
+
+/*  One input file as decoded by a worker thread.  records holds the map->start_col through map->end_col - 1 columns of input
+    rows first_row through end_row - 1 (the rows that land in the output rows that are being merged).  Rows that landed on
+    fully covered output when the worker got to them aren't filled in (they're still covered when the caller gets them).  */
+
+typedef struct
+{
+  int32_t            file;            /*  Input file number  */
+  INPUT_MAP          *map;
+  CHRTR2_RECORD      *records;
+  int32_t            cols;            /*  map->end_col - map->start_col  */
+  int32_t            first_row;       /*  First input row in records  */
+  int32_t            end_row;         /*  One past the last input row in records  */
+  uint8_t            status;          /*  DECODE_PENDING, DECODE_DONE, or DECODE_FAILED  */
+  int32_t            failed_row;      /*  Row that we couldn't read if status is DECODE_FAILED (-1 for no memory, -2 for no open)  */
+  int32_t            rows_skipped;    /*  Rows that landed on covered output and were never read  */
+} DECODED_INPUT;
+
+
+/*  Pool of worker threads that read and map the input files in parallel.  Files are handed out in precedence order and no
+    more than max_in_flight decoded files are held in memory at once.  The caller still inserts the files into the grid one
+    at a time in precedence order (see input_decoder_wait) so the result is exactly the same as reading them serially.  */
+
+typedef struct
+{
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cond;
+  pthread_t          *threads;
+  int32_t            thread_count;
+  INPUT_FILES        *files;
+  COVERAGE_MAP       *coverage;       /*  Input rows that land on covered output aren't read  */
+  MERGE_STATS        *stats;
+  int32_t            file_count;      /*  Number of files in inputs  */
+  int32_t            next_file;       /*  Next file to be handed to a worker  */
+  int32_t            released;        /*  Number of files that the caller has finished with  */
+  int32_t            max_in_flight;
+  DECODED_INPUT      *inputs;
+  int32_t            start_row;       /*  First output row being merged  */
+  int32_t            end_row;         /*  One past the last output row being merged  */
+} INPUT_DECODER;
+
+
+uint8_t input_decoder_start (INPUT_DECODER *decoder, INPUT_FILES *files, INPUT_MAP *map, COVERAGE_MAP *coverage, MERGE_STATS *stats,
+                             int32_t *list, int32_t file_count, int32_t start_row, int32_t end_row, int32_t thread_count);
+DECODED_INPUT *input_decoder_wait (INPUT_DECODER *decoder, int32_t file);
+void input_decoder_release (INPUT_DECODER *decoder, int32_t file);
+void input_decoder_finish (INPUT_DECODER *decoder);
+
+
+#endif
@@ -0,0 +1,343 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "input_files.h"
+#include "chrtr2_handles.h"
+
+
+/*  Set up count input files (nothing is opened until input_files_open is called).  The paths are copied.  If cache isn't
+    NULL the handles come from it.  Returns NVFalse (with nothing left allocated) if we couldn't allocate memory.  */
+
+uint8_t input_files_init (INPUT_FILES *files, int32_t count, char **path, int32_t max_open, INPUT_CACHE *cache)
+{
+  int32_t            i;
+
+
+  memset (files, 0, sizeof (INPUT_FILES));
+
+  pthread_mutex_init (&files->mutex, NULL);
+  pthread_cond_init (&files->released, NULL);
+
+  files->max_open = max_open;
+
+  files->path = (char **) calloc (count, sizeof (char *));
+  files->header = (CHRTR2_HEADER *) calloc (count, sizeof (CHRTR2_HEADER));
+  files->have_header = (uint8_t *) calloc (count, sizeof (uint8_t));
+  files->handle = (int32_t *) malloc (count * sizeof (int32_t));
+  files->attached = (uint8_t *) calloc (count, sizeof (uint8_t));
+  files->pins = (int32_t *) calloc (count, sizeof (int32_t));
+  files->last_used = (int64_t *) calloc (count, sizeof (int64_t));
+  files->start_row = (int32_t *) calloc (count, sizeof (int32_t));
+  files->end_row = (int32_t *) calloc (count, sizeof (int32_t));
+  files->mark = (int32_t *) calloc (count, sizeof (int32_t));
+  files->rows_read = (int64_t *) calloc (count, sizeof (int64_t));
+  files->rows_skipped = (int64_t *) calloc (count, sizeof (int64_t));
+  files->cache_file = (int32_t *) malloc (count * sizeof (int32_t));
+
+  if (files->path == NULL || files->header == NULL || files->have_header == NULL || files->handle == NULL || files->attached == NULL ||
+      files->pins == NULL || files->last_used == NULL || files->start_row == NULL || files->end_row == NULL || files->mark == NULL ||
+      files->rows_read == NULL || files->rows_skipped == NULL || files->cache_file == NULL)
+    {
+      input_files_free (files);
+      return (NVFalse);
+    }
+
+  files->cache = cache;
+
+
+  /*  files->count only covers the files that are set up so input_files_free can clean up after a failure.  */
+
+  for (i = 0 ; i < count ; i++)
+    {
+      files->handle[i] = -1;
+      files->cache_file[i] = (cache == NULL) ? -1 : input_cache_file (cache, path[i]);
+      files->path[i] = (char *) malloc (strlen (path[i]) + 1);
+
+      if ((cache != NULL && files->cache_file[i] < 0) || files->path[i] == NULL)
+        {
+          free (files->path[i]);
+          input_files_free (files);
+          return (NVFalse);
+        }
+
+      strcpy (files->path[i], path[i]);
+
+      files->count++;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Close handle (or give it back to the cache).  */
+
+static void close_file (INPUT_FILES *files, int32_t handle)
+{
+  if (files->cache != NULL)
+    {
+      input_cache_close (files->cache, handle);
+    }
+  else
+    {
+      chrtr2_handles_close (handle);
+    }
+}
+
+
+
+/*  Use the caller's open CHRTR2 handle (with its header) for file instead of opening the file.  */
+
+void input_files_attach (INPUT_FILES *files, int32_t file, int32_t handle, CHRTR2_HEADER *header)
+{
+  files->handle[file] = handle;
+  files->attached[file] = NVTrue;
+  files->header[file] = *header;
+  files->have_header[file] = NVTrue;
+}
+
+
+
+/*  Get the CHRTR2 handle for file, opening it if it isn't already open.  The file stays open until input_files_release is
+    called.  libchrtr2 keeps the file position per handle so only one thread can use a handle at a time.  If another
+    thread has the file we wait for it to be released (nobody waits while holding a file so this can't deadlock).  The
+    first time a file is opened its header is saved in files->header.  If every open file is in use we go over max_open
+    rather than wait.  Returns -1 if the file couldn't be opened (check chrtr2_strerror).  */
+
+int32_t input_files_open (INPUT_FILES *files, int32_t file)
+{
+  int32_t            i, oldest, handle;
+  CHRTR2_HEADER      header;
+
+
+  pthread_mutex_lock (&files->mutex);
+
+  while (files->pins[file]) pthread_cond_wait (&files->released, &files->mutex);
+
+  if (files->handle[file] < 0)
+    {
+      /*  Close the least recently used file that nobody is reading.  */
+
+      if (files->open_count >= files->max_open)
+        {
+          oldest = -1;
+          for (i = 0 ; i < files->count ; i++)
+            {
+              if (files->handle[i] >= 0 && !files->attached[i] && !files->pins[i] && (oldest < 0 || files->last_used[i] < files->last_used[oldest])) oldest = i;
+            }
+
+          if (oldest >= 0)
+            {
+              close_file (files, files->handle[oldest]);
+              files->handle[oldest] = -1;
+              files->open_count--;
+            }
+        }
+
+
+      if (files->cache != NULL)
+        {
+          files->handle[file] = input_cache_open (files->cache, files->cache_file[file], &header);
+        }
+      else
+        {
+          files->handle[file] = chrtr2_handles_open (files->path[file], &header, CHRTR2_READONLY);
+        }
+
+      if (files->handle[file] < 0)
+        {
+          pthread_mutex_unlock (&files->mutex);
+          return (-1);
+        }
+
+      if (!files->have_header[file])
+        {
+          files->header[file] = header;
+          files->have_header[file] = NVTrue;
+        }
+
+      files->open_count++;
+    }
+
+  files->pins[file]++;
+  files->last_used[file] = ++files->clock;
+
+  handle = files->handle[file];
+
+  pthread_mutex_unlock (&files->mutex);
+
+  return (handle);
+}
+
+
+
+/*  We're done with the handle from input_files_open.  The file is left open in case it's needed again.  */
+
+void input_files_release (INPUT_FILES *files, int32_t file)
+{
+  pthread_mutex_lock (&files->mutex);
+  files->pins[file]--;
+  pthread_cond_broadcast (&files->released);
+  pthread_mutex_unlock (&files->mutex);
+}
+
+
+
+/*  Build the index of which files land in which output rows using the input maps (map[i] for file i).  height is the
+    height of the output grid.  Files that don't land in the output grid at all aren't in any bucket.  Returns NVFalse if
+    we couldn't allocate memory.  */
+
+uint8_t input_files_index (INPUT_FILES *files, INPUT_MAP *map, int32_t height)
+{
+  int32_t            i, j, k, total;
+
+
+  files->bucket_count = (height + INPUT_INDEX_ROWS - 1) / INPUT_INDEX_ROWS;
+
+  files->bucket_start = (int32_t *) calloc (files->bucket_count + 1, sizeof (int32_t));
+  if (files->bucket_start == NULL) return (NVFalse);
+
+
+  /*  The span of output rows for each file.  */
+
+  for (i = 0 ; i < files->count ; i++)
+    {
+      files->start_row[i] = height;
+      files->end_row[i] = 0;
+
+      if (map[i].start_col >= map[i].end_col) continue;
+
+      for (j = 0 ; j < map[i].height ; j++)
+        {
+          if (map[i].out_y[j] >= 0)
+            {
+              files->start_row[i] = MIN (files->start_row[i], map[i].out_y[j]);
+              files->end_row[i] = MAX (files->end_row[i], map[i].out_y[j] + 1);
+            }
+        }
+
+      if (files->end_row[i] <= files->start_row[i]) continue;
+
+      for (k = files->start_row[i] / INPUT_INDEX_ROWS ; k <= (files->end_row[i] - 1) / INPUT_INDEX_ROWS ; k++) files->bucket_start[k + 1]++;
+    }
+
+
+  /*  Turn the counts into offsets and fill the buckets (in precedence order since we go through the files in order).  */
+
+  for (k = 0 ; k < files->bucket_count ; k++) files->bucket_start[k + 1] += files->bucket_start[k];
+
+  total = files->bucket_start[files->bucket_count];
+
+  files->bucket_file = (int32_t *) malloc (MAX (total, 1) * sizeof (int32_t));
+  if (files->bucket_file == NULL) return (NVFalse);
+
+  for (i = 0 ; i < files->count ; i++)
+    {
+      if (files->end_row[i] <= files->start_row[i]) continue;
+
+      for (k = files->start_row[i] / INPUT_INDEX_ROWS ; k <= (files->end_row[i] - 1) / INPUT_INDEX_ROWS ; k++)
+        files->bucket_file[files->bucket_start[k]++] = i;
+    }
+
+
+  /*  Filling the buckets moved each offset up to the start of the next bucket so shift them back down.  */
+
+  for (k = files->bucket_count ; k > 0 ; k--) files->bucket_start[k] = files->bucket_start[k - 1];
+  files->bucket_start[0] = 0;
+
+  return (NVTrue);
+}
+
+
+
+static int32_t compare_files (const void *a, const void *b)
+{
+  return (*((int32_t *) a) - *((int32_t *) b));
+}
+
+
+
+/*  Put the numbers of the files that land in output rows start_row through end_row - 1 in list (which has to have room for
+    all of the files) in precedence order.  Returns the number of files.  */
+
+int32_t input_files_query (INPUT_FILES *files, int32_t start_row, int32_t end_row, int32_t *list)
+{
+  int32_t            i, k, file, count = 0;
+
+
+  if (start_row >= end_row) return (0);
+
+  files->query++;
+
+  for (k = start_row / INPUT_INDEX_ROWS ; k <= (end_row - 1) / INPUT_INDEX_ROWS && k < files->bucket_count ; k++)
+    {
+      for (i = files->bucket_start[k] ; i < files->bucket_start[k + 1] ; i++)
+        {
+          file = files->bucket_file[i];
+
+          if (files->mark[file] == files->query) continue;
+          files->mark[file] = files->query;
+
+          if (files->start_row[file] < end_row && files->end_row[file] > start_row) list[count++] = file;
+        }
+    }
+
+  qsort (list, count, sizeof (int32_t), compare_files);
+
+  return (count);
+}
+
+
+
+/*  Close all of the files and free everything.  */
+
+void input_files_free (INPUT_FILES *files)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < files->count ; i++)
+    {
+      if (files->handle[i] >= 0 && !files->attached[i]) close_file (files, files->handle[i]);
+      free (files->path[i]);
+    }
+
+  pthread_mutex_destroy (&files->mutex);
+  pthread_cond_destroy (&files->released);
+
+  free (files->path);
+  free (files->header);
+  free (files->have_header);
+  free (files->handle);
+  free (files->attached);
+  free (files->pins);
+  free (files->last_used);
+  free (files->start_row);
+  free (files->end_row);
+  free (files->mark);
+  free (files->rows_read);
+  free (files->rows_skipped);
+  free (files->cache_file);
+  if (files->bucket_start != NULL) free (files->bucket_start);
+  if (files->bucket_file != NULL) free (files->bucket_file);
+}
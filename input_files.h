@@ -0,0 +1,90 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _INPUT_FILES_H_
+#define _INPUT_FILES_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "input_cache.h"
+#include "input_map.h"
+
+
+/*  Maximum number of input files that we keep open at one time.  This keeps us well under the CHRTR2 library's handle
+    table and the process file descriptor limit no matter how many input files there are.  */
+
+#define         MAX_OPEN_INPUTS 32
+
+
+/*  Number of output rows in each bucket of the input file index.  */
+
+#define         INPUT_INDEX_ROWS 256
+
+
+/*  All of the input files.  The files are opened when they're needed and, once more than max_open of them are open, the
+    least recently used file that nobody is reading gets closed.  The handles are shared by the reader threads so opening
+    and closing is done under the mutex, and a handle is only lent to one thread at a time.  The index is a list of the files that land in each band of INPUT_INDEX_ROWS output
+    rows so that a tile only has to look at the files that overlap it.  In a batch the handles come from (and go back to)
+    the batch's input cache instead of being opened and closed here.  Files that the caller already had open are attached
+    with their handles, which are never closed here and don't count against max_open.  */
+
+typedef struct
+{
+  int32_t            count;
+  char               **path;
+  CHRTR2_HEADER      *header;
+  uint8_t            *have_header;    /*  NVTrue once the file has been opened the first time  */
+  int32_t            *handle;         /*  CHRTR2 handle (-1 if the file isn't open)  */
+  uint8_t            *attached;       /*  NVTrue if handle is the caller's  */
+  int32_t            *pins;           /*  Number of users of the open handle (never more than one)  */
+  int64_t            *last_used;
+  int64_t            clock;
+  int32_t            open_count;
+  int32_t            max_open;
+  pthread_mutex_t    mutex;
+  pthread_cond_t     released;        /*  Signaled when a handle is given back  */
+  int32_t            *start_row;      /*  First output row that each file lands in  */
+  int32_t            *end_row;        /*  One past the last output row that each file lands in (0 if none)  */
+  int32_t            bucket_count;
+  int32_t            *bucket_start;   /*  Files in bucket k are bucket_file[bucket_start[k]] through bucket_file[bucket_start[k + 1] - 1]  */
+  int32_t            *bucket_file;
+  int32_t            *mark;           /*  Used by input_files_query to skip files that are in more than one bucket  */
+  int32_t            query;
+  int64_t            *rows_read;      /*  Number of input rows read from each file  */
+  int64_t            *rows_skipped;   /*  Number of input rows that landed on fully covered output and weren't read  */
+  INPUT_CACHE        *cache;          /*  NULL unless we're running a batch  */
+  int32_t            *cache_file;     /*  Cache file number of each file (-1 if there's no cache)  */
+} INPUT_FILES;
+
+
+uint8_t input_files_init (INPUT_FILES *files, int32_t count, char **path, int32_t max_open, INPUT_CACHE *cache);
+void input_files_attach (INPUT_FILES *files, int32_t file, int32_t handle, CHRTR2_HEADER *header);
+int32_t input_files_open (INPUT_FILES *files, int32_t file);
+void input_files_release (INPUT_FILES *files, int32_t file);
+uint8_t input_files_index (INPUT_FILES *files, INPUT_MAP *map, int32_t height);
+int32_t input_files_query (INPUT_FILES *files, int32_t start_row, int32_t end_row, int32_t *list);
+void input_files_free (INPUT_FILES *files);
+
+
+#endif
@@ -0,0 +1,156 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "input_map.h"
+
+
+/*  Build the row and column lookup tables for the input file (handle, header) into the output file (out_handle,
+    out_header).  Each position goes through exactly the same chrtr2_get_lat_lon, EPS nudge, dateline correction, and
+    chrtr2_get_coord steps that we used to apply to every cell.  The other coordinate is held at the center of the output
+    grid so that it is always inside.  Returns NVFalse if we couldn't allocate the tables.  */
+
+uint8_t input_map_build (INPUT_MAP *map, int32_t handle, CHRTR2_HEADER *header, int32_t out_handle, CHRTR2_HEADER *out_header,
+                         uint8_t dateline)
+{
+  int32_t            i;
+  double             lat, lon, center_lat, center_lon;
+  NV_I32_COORD2      coord, coord2;
+
+
+  map->width = header->width;
+  map->height = header->height;
+
+  map->out_x = (int32_t *) malloc (map->width * sizeof (int32_t));
+  map->out_y = (int32_t *) malloc (map->height * sizeof (int32_t));
+  if (map->out_x == NULL || map->out_y == NULL) return (NVFalse);
+
+
+  coord.x = out_header->width / 2;
+  coord.y = out_header->height / 2;
+  chrtr2_get_lat_lon (out_handle, &center_lat, &center_lon, coord);
+
+
+  /*  Columns.  */
+
+  coord.y = 0;
+  for (i = 0 ; i < map->width ; i++)
+    {
+      coord.x = i;
+      chrtr2_get_lat_lon (handle, &lat, &lon, coord);
+
+      lon = lon + EPS;
+
+
+      /*  Check for dateline crossing.  */
+
+      if (dateline && lon < 0.0) lon += 360.0;
+
+      map->out_x[i] = chrtr2_get_coord (out_handle, center_lat, lon, &coord2) ? -1 : coord2.x;
+    }
+
+
+  /*  Rows.  */
+
+  coord.x = 0;
+  for (i = 0 ; i < map->height ; i++)
+    {
+      coord.y = i;
+      chrtr2_get_lat_lon (handle, &lat, &lon, coord);
+
+      lat = lat + EPS;
+
+      map->out_y[i] = chrtr2_get_coord (out_handle, lat, center_lon, &coord2) ? -1 : coord2.y;
+    }
+
+
+  /*  Find the span of columns that land in the output grid.  */
+
+  for (map->start_col = 0 ; map->start_col < map->width && map->out_x[map->start_col] < 0 ; map->start_col++);
+  for (map->end_col = map->width ; map->end_col > map->start_col && map->out_x[map->end_col - 1] < 0 ; map->end_col--);
+
+  map->out_start_x = out_header->width;
+  map->out_end_x = 0;
+
+  for (i = map->start_col ; i < map->end_col ; i++)
+    {
+      if (map->out_x[i] >= 0)
+        {
+          map->out_start_x = MIN (map->out_start_x, map->out_x[i]);
+          map->out_end_x = MAX (map->out_end_x, map->out_x[i] + 1);
+        }
+    }
+
+
+  /*  Check for a constant offset.  Every column in the span has to be offset_x over from its input column and every row has
+      to be offset_y up (or off of the output grid).  */
+
+  map->aligned = (map->start_col < map->end_col);
+  map->offset_x = map->aligned ? map->out_x[map->start_col] - map->start_col : 0;
+  map->offset_y = 0;
+
+  for (i = map->start_col ; i < map->end_col && map->aligned ; i++)
+    {
+      if (map->out_x[i] != i + map->offset_x) map->aligned = NVFalse;
+    }
+
+  for (i = 0 ; i < map->height && map->out_y[i] < 0 ; i++);
+  if (i < map->height) map->offset_y = map->out_y[i] - i;
+
+  for ( ; i < map->height && map->aligned ; i++)
+    {
+      if (map->out_y[i] >= 0 && map->out_y[i] != i + map->offset_y) map->aligned = NVFalse;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Find the range of input rows (first_row through end_input_row - 1) that land in output rows start_row through
+    end_row - 1.  The range is empty (first_row == end_input_row) if none of them do.  */
+
+void input_map_rows (INPUT_MAP *map, int32_t start_row, int32_t end_row, int32_t *first_row, int32_t *end_input_row)
+{
+  int32_t            i;
+
+
+  *first_row = *end_input_row = 0;
+
+  for (i = 0 ; i < map->height ; i++)
+    {
+      if (map->out_y[i] >= start_row && map->out_y[i] < end_row)
+        {
+          if (*first_row == *end_input_row) *first_row = i;
+          *end_input_row = i + 1;
+        }
+    }
+}
+
+
+
+void input_map_free (INPUT_MAP *map)
+{
+  if (map->out_x != NULL) free (map->out_x);
+  if (map->out_y != NULL) free (map->out_y);
+  map->out_x = map->out_y = NULL;
+}
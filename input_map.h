@@ -0,0 +1,58 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _INPUT_MAP_H_
+#define _INPUT_MAP_H_
+
+#include "chrtr2_merge.h"
+
+
+/*  Mapping from the rows and columns of an input file to the rows and columns of the output grid.  Since both are regular
+    lat/lon grids the output column only depends on the input column and the output row only depends on the input row, so
+    we only have to ask the library for width + height coordinates instead of width * height.  If the input has the same
+    grid spacing as (and is registered with) the output grid the mapping is a constant offset and we flag it as aligned so
+    the merge can work on whole row spans.  */
+
+typedef struct
+{
+  int32_t            width;           /*  Width of the input file  */
+  int32_t            height;          /*  Height of the input file  */
+  int32_t            *out_x;          /*  Output column for each input column (-1 if outside of the output grid)  */
+  int32_t            *out_y;          /*  Output row for each input row (-1 if outside of the output grid)  */
+  uint8_t            aligned;         /*  NVTrue if out_x[k] = k + offset_x and out_y[j] = j + offset_y  */
+  int32_t            offset_x;        /*  Column offset for aligned inputs  */
+  int32_t            offset_y;        /*  Row offset for aligned inputs  */
+  int32_t            start_col;       /*  First input column that lands in the output grid  */
+  int32_t            end_col;         /*  One past the last input column that lands in the output grid  */
+  int32_t            out_start_x;     /*  First output column that the input lands in  */
+  int32_t            out_end_x;       /*  One past the last output column that the input lands in  */
+} INPUT_MAP;
+
+
+uint8_t input_map_build (INPUT_MAP *map, int32_t handle, CHRTR2_HEADER *header, int32_t out_handle, CHRTR2_HEADER *out_header,
+                         uint8_t dateline);
+void input_map_rows (INPUT_MAP *map, int32_t start_row, int32_t end_row, int32_t *first_row, int32_t *end_input_row);
+void input_map_free (INPUT_MAP *map);
+
+
+#endif
@@ -0,0 +1,102 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "input_reader.h"
+
+
+/*  Set up a reader for columns start_col through start_col + cols - 1 of an open CHRTR2 file that has height rows.  cache
+    and cache_file are the input cache (NULL if there isn't one) and the file's number in it.  */
+
+uint8_t input_reader_open (INPUT_READER *reader, int32_t handle, int32_t height, int32_t start_col, int32_t cols, INPUT_CACHE *cache,
+                           int32_t cache_file)
+{
+  reader->handle = handle;
+  reader->cache = cache;
+  reader->cache_file = cache_file;
+  reader->height = height;
+  reader->start_col = start_col;
+  reader->cols = cols;
+  reader->block_start = -1;
+  reader->block_count = 0;
+
+  reader->block_rows = MAX (1, READ_BLOCK_SIZE / (cols * (int32_t) sizeof (CHRTR2_RECORD)));
+  reader->block_rows = MIN (reader->block_rows, height);
+
+  reader->buffer = (CHRTR2_RECORD *) malloc ((size_t) reader->block_rows * (size_t) cols * sizeof (CHRTR2_RECORD));
+  if (reader->buffer == NULL) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+/*  Return a pointer to the cols records of the window for row.  If the row isn't in the current block we read the block
+    that starts at row and stops before end_row, the first row after it that the caller doesn't want (the end of the rows
+    it needs or a row that lands on covered output), so we never read rows that aren't used.  Returns NULL if the library
+    couldn't read the row (check chrtr2_strerror).  */
+
+CHRTR2_RECORD *input_reader_row (INPUT_READER *reader, int32_t row, int32_t end_row)
+{
+  int32_t            i;
+
+
+  if (reader->block_start < 0 || row < reader->block_start || row >= reader->block_start + reader->block_count)
+    {
+      reader->block_start = row;
+      reader->block_count = MIN (reader->block_rows, MIN (end_row, reader->height) - row);
+
+      if (reader->cache != NULL)
+        {
+          if (!input_cache_read (reader->cache, reader->cache_file, reader->handle, reader->block_start, reader->block_count,
+                                 reader->start_col, reader->cols, reader->buffer))
+            {
+              reader->block_start = -1;
+              reader->block_count = 0;
+              return (NULL);
+            }
+        }
+      else
+        {
+          for (i = 0 ; i < reader->block_count ; i++)
+            {
+              if (chrtr2_read_record_row (reader->handle, row + i, reader->start_col, reader->cols,
+                                          &reader->buffer[(size_t) i * (size_t) reader->cols]))
+                {
+                  reader->block_start = -1;
+                  reader->block_count = 0;
+                  return (NULL);
+                }
+            }
+        }
+    }
+
+  return (&reader->buffer[(size_t) (row - reader->block_start) * (size_t) reader->cols]);
+}
+
+
+
+void input_reader_close (INPUT_READER *reader)
+{
+  if (reader->buffer != NULL) free (reader->buffer);
+  reader->buffer = NULL;
+}
@@ -0,0 +1,62 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _INPUT_READER_H_
+#define _INPUT_READER_H_
+
+#include "chrtr2_merge.h"
+#include "input_cache.h"
+
+
+/*  Approximate size, in bytes, of the record buffer that we read each block of rows into.  */
+
+#define         READ_BLOCK_SIZE 4194304
+
+
+/*  Buffered reader for a column window of a CHRTR2 file.  Rows are read a block at a time using the library's row reader
+    and handed back as contiguous spans of records so that the merge doesn't make a library call for every cell.  A block
+    never runs past the rows that the caller says it wants.  If there is an input cache the blocks go through the cache (a
+    block is shared with other merges of the same file that want the same rows).  */
+
+typedef struct
+{
+  int32_t            handle;          /*  CHRTR2 handle of the input file  */
+  int32_t            height;          /*  Number of rows in the input file  */
+  int32_t            start_col;       /*  First column of the window  */
+  int32_t            cols;            /*  Number of columns in the window  */
+  int32_t            block_rows;      /*  Maximum number of rows read at one time  */
+  int32_t            block_start;     /*  First row currently in the buffer (-1 if the buffer is empty)  */
+  int32_t            block_count;     /*  Number of rows currently in the buffer  */
+  CHRTR2_RECORD      *buffer;         /*  block_rows * cols records  */
+  INPUT_CACHE        *cache;          /*  NULL if there's no input cache  */
+  int32_t            cache_file;      /*  Cache file number of the input file  */
+} INPUT_READER;
+
+
+uint8_t input_reader_open (INPUT_READER *reader, int32_t handle, int32_t height, int32_t start_col, int32_t cols, INPUT_CACHE *cache,
+                           int32_t cache_file);
+CHRTR2_RECORD *input_reader_row (INPUT_READER *reader, int32_t row, int32_t end_row);
+void input_reader_close (INPUT_READER *reader);
+
+
+#endif
@@ -21,33 +21,18 @@
 
 *********************************************************************************************/
 
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <math.h>
-#include <errno.h>
-#include <time.h>
 #include <getopt.h>
 
-#include "nvutility.h"
-
-#include "misp.h"
-#include "chrtr2.h"
+#include "chrtr2_merge.h"
+#include "merge_context.h"
+#include "pipeline.h"
+#include "verify.h"
+#include "batch.h"
+#include "checkpoint.h"
 
 #include "version.h"
 
 
-#define         FILTER 9
-#define         EPS 1e-10
-
-
-typedef struct
-{
-  CHRTR2_RECORD      ch2;
-  int32_t            rank;
-} CH2_GRID;
-
-
 
 /*
 
@@ -61,14 +46,120 @@ typedef struct
 
 void usage ()
 {
-  fprintf (stderr, "\n\nUsage: chrtr2_merge [-e] [-b SIZE] [-n] CHRTR2_FILE1 CHRTR2_FILE2 [CHRTR2_FILE3...] [-o OUTPUT_FILE]\n\n");
+  fprintf (stderr, "\n\nUsage: chrtr2_merge [-e] [-b SIZE[m][,SIZE[m]...]] [-n] [--threads N] [--regrid-workers N] [--mem-limit SIZE] [--holes-only] [--incremental] [--list LIST_FILE] [--pipeline] [--stats-json FILE] [--verify[=N]] [--area S,W,N,E|AREA_FILE] [--checkpoint] [--resume] [--gtiff TIFF_FILE] [--raw BIL_FILE] [--pyramid] [--policy POLICY] [--summary-json FILE] CHRTR2_FILE1 [CHRTR2_FILE2...] [-o OUTPUT_FILE]\n\n");
+  fprintf (stderr, "       chrtr2_merge --batch JOB_FILE [--jobs N] [--threads N] [--regrid-workers N] [--mem-limit SIZE] [--cache SIZE]\n\n");
   fprintf (stderr, "This program merges two or more CHRTR2 grids into a single CHRTR2 grid file.\n");
   fprintf (stderr, "The first file name on the command line takes precedence over the second\n");
-  fprintf (stderr, "which takes precedence over the third... rinse, wash, repeat.  There is a\n");
-  fprintf (stderr, "limit of 16 CHRTR2 files that can be merged.\n\n");
+  fprintf (stderr, "which takes precedence over the third... rinse, wash, repeat.  There is no\n");
+  fprintf (stderr, "practical limit on the number of CHRTR2 files that can be merged.  Only %d\n", MAX_OPEN_INPUTS);
+  fprintf (stderr, "of them are kept open at a time and each part of the output only reads the\n");
+  fprintf (stderr, "files that overlap it.\n\n");
   fprintf (stderr, "-e = exclude\n");
-  fprintf (stderr, "-b = buffer zone SIZE in grid cells for exclude (implies -e)\n");
+  fprintf (stderr, "-b = buffer zone SIZE in grid cells for exclude (implies -e).  If SIZE is followed by m\n");
+  fprintf (stderr, "     it is in meters instead of grid cells.  A comma separated list of sizes sets\n");
+  fprintf (stderr, "     the buffer for the second, third... input files.  The last size in the list\n");
+  fprintf (stderr, "     is used for any remaining files.\n");
   fprintf (stderr, "-n = no regrid of the output file\n");
+  fprintf (stderr, "--threads = number of threads used to read the input files (default 1).  This\n");
+  fprintf (stderr, "            never changes the output.\n");
+  fprintf (stderr, "--regrid-workers = number of MISP processes to regrid with at once (default 1,\n");
+  fprintf (stderr, "                   a single pass).  With more than one, each process regrids a\n");
+  fprintf (stderr, "                   band of rows plus %d rows of overlap and only sees the data\n", REGRID_HALO);
+  fprintf (stderr, "                   in it, so interpolated values can differ from a single pass\n");
+  fprintf (stderr, "                   (real, digitized, and land masked data never change).  Use\n");
+  fprintf (stderr, "                   bench/chrtr2_diff to measure the difference on your data.\n");
+  fprintf (stderr, "--mem-limit = process the output in tiles so that memory use stays under SIZE.\n");
+  fprintf (stderr, "              SIZE is in megabytes unless followed by K, M, or G.  Each tile only\n");
+  fprintf (stderr, "              reads the parts of the input files that it needs.  When regridding,\n");
+  fprintf (stderr, "              MISP only sees the data within %d rows of each tile so the\n", REGRID_HALO);
+  fprintf (stderr, "              interpolated values may differ slightly from a single pass.\n");
+  fprintf (stderr, "--holes-only = only regrid the areas that have holes in them (cells that aren't real,\n");
+  fprintf (stderr, "               digitized, or land masked data).  Only the data within %d cells of a\n", REGRID_HALO);
+  fprintf (stderr, "               hole is given to MISP and rows with no holes are copied straight to\n");
+  fprintf (stderr, "               the output file.  The interpolated values may differ slightly from a\n");
+  fprintf (stderr, "               full regrid.\n");
+  fprintf (stderr, "--incremental = keep a manifest of the input files next to the output file\n");
+  fprintf (stderr, "                (OUTPUT_FILE.manifest).  If the options and input files are the\n");
+  fprintf (stderr, "                same as the last --incremental run, only the output rows that\n");
+  fprintf (stderr, "                changed input data can reach are redone and the output file is\n");
+  fprintf (stderr, "                updated in place.  When regridding, the redone rows may differ\n");
+  fprintf (stderr, "                slightly from a full merge (see --mem-limit).\n");
+  fprintf (stderr, "--list = read more input file names, one per line, from LIST_FILE.  They come\n");
+  fprintf (stderr, "         after any input files on the command line.  Blank lines and lines\n");
+  fprintf (stderr, "         starting with # are ignored.\n");
+  fprintf (stderr, "--pipeline = process the output in bands of rows (%d rows, or the --mem-limit\n", PIPELINE_BAND_ROWS);
+  fprintf (stderr, "             tiles) and run three stages at once: the input files for the\n");
+  fprintf (stderr, "             next band are read while the current band is merged and the last\n");
+  fprintf (stderr, "             band is regridded and written.  This needs room for two bands at\n");
+  fprintf (stderr, "             once so the bands are half the size that --mem-limit alone would\n");
+  fprintf (stderr, "             use (plus the rows read ahead for the next band).  As\n");
+  fprintf (stderr, "             with --mem-limit, the interpolated values may differ slightly from\n");
+  fprintf (stderr, "             a single pass.\n");
+  fprintf (stderr, "--stats-json = write the wall and CPU time, cells per second, bytes read and\n");
+  fprintf (stderr, "               written, and most memory in use at the start or end of each\n");
+  fprintf (stderr, "               phase of the merge, the peak memory of the whole run, and the\n");
+  fprintf (stderr, "               read times of each input file, to FILE as JSON.  In a batch the\n");
+  fprintf (stderr, "               memory is for all of the running jobs.\n");
+  fprintf (stderr, "--verify = check the merged grid (before it is regridded) against the original\n");
+  fprintf (stderr, "           cell at a time merge and report any cells whose Z, status, or\n");
+  fprintf (stderr, "           source file differ.  The check is done in bands of %d rows.\n", VERIFY_BAND_ROWS);
+  fprintf (stderr, "           With --verify=N only every Nth band is checked.  The program exits\n");
+  fprintf (stderr, "           with an error (after writing the output file) if any cell differs.\n");
+  fprintf (stderr, "--area = make the output file for this area instead of the MBR of all of\n");
+  fprintf (stderr, "         the input files.  The area is either the south latitude, west longitude,\n");
+  fprintf (stderr, "         north latitude, and east longitude of an MBR (in decimal degrees,\n");
+  fprintf (stderr, "         separated by commas) or a file with one latitude, longitude pair per\n");
+  fprintf (stderr, "         line that defines a polygon.  The output file covers the part of the\n");
+  fprintf (stderr, "         MBR of the area that is inside the MBR of the input files and, for a\n");
+  fprintf (stderr, "         polygon, cells outside of the polygon are left empty.\n");
+  fprintf (stderr, "         Only the parts of the input files within the exclude buffers and the\n");
+  fprintf (stderr, "         regrid halo (%d cells) of the area are read.\n", REGRID_HALO);
+  fprintf (stderr, "--checkpoint = process the output in tiles of at most %d rows and, each\n", CHECKPOINT_BAND_ROWS);
+  fprintf (stderr, "               time a tile has been written and synced to the disk, save\n");
+  fprintf (stderr, "               the progress in OUTPUT_FILE.checkpoint.  As with --mem-limit,\n");
+  fprintf (stderr, "               the interpolated values may differ slightly from a single pass.\n");
+  fprintf (stderr, "               Can't be used with --incremental.\n");
+  fprintf (stderr, "--resume = same as --checkpoint but, if the checkpoint file from an earlier\n");
+  fprintf (stderr, "           run of the same merge (same options and unchanged input files) is\n");
+  fprintf (stderr, "           there, only the tiles that weren't finished are merged.  The output\n");
+  fprintf (stderr, "           file is the same as if the earlier run had finished.\n");
+  fprintf (stderr, "--gtiff = also write the output to TIFF_FILE, a tiled, compressed GeoTIFF with Z,\n");
+  fprintf (stderr, "          status, and source file number (1 for the first input file) bands,\n");
+  fprintf (stderr, "          from the same rows as the output file.  Cells with no data are\n");
+  fprintf (stderr, "          %.1f in every band.\n", RASTER_NULL);
+  fprintf (stderr, "--raw = also write the output Z values to BIL_FILE, a raw 32 bit float raster\n");
+  fprintf (stderr, "        with an ESRI header (BIL_FILE with a .hdr extension).  --gtiff and --raw\n");
+  fprintf (stderr, "        can't be used with --incremental or --checkpoint.\n");
+  fprintf (stderr, "--pyramid = also build overview levels (reduced by 2, 4, 8, ... until they fit\n");
+  fprintf (stderr, "            in %d by %d cells) of the minimum, maximum, and mean Z of the\n", PYRAMID_TOP_SIZE, PYRAMID_TOP_SIZE);
+  fprintf (stderr, "            output in OUTPUT_FILE.pyramid as the output rows are written.  A\n");
+  fprintf (stderr, "            block with any real, digitized, or land masked data only uses that\n");
+  fprintf (stderr, "            data.  Can't be used with --incremental or --checkpoint.\n");
+  fprintf (stderr, "--policy = how a cell that already has data is resolved against the data from\n");
+  fprintf (stderr, "           the other input files.  first (the default) keeps the first file\n");
+  fprintf (stderr, "           with data, shoalest keeps the smallest Z, uncertainty keeps the\n");
+  fprintf (stderr, "           lowest (known) uncertainty, newest keeps the data from the most\n");
+  fprintf (stderr, "           recently modified file, and status keeps real over digitized over\n");
+  fprintf (stderr, "           land masked over interpolated data.  Ties go to the first file.\n");
+  fprintf (stderr, "           Only first can be used with -e or -b.\n");
+  fprintf (stderr, "--summary-json = write a QA summary of the output to FILE: the Z range, a Z\n");
+  fprintf (stderr, "                 histogram (%g wide bins), the number of cells with each status\n", SUMMARY_BIN_SIZE);
+  fprintf (stderr, "                 bit, and the number of cells that came from each input file.\n");
+  fprintf (stderr, "                 It's gathered as the output rows are written.  Can't be used\n");
+  fprintf (stderr, "                 with --incremental or --checkpoint.\n");
+  fprintf (stderr, "--batch = run all of the merges in JOB_FILE in this one process.  Each line of\n");
+  fprintf (stderr, "          JOB_FILE is a chrtr2_merge command line without the program name\n");
+  fprintf (stderr, "          (blank lines and lines starting with # are ignored).  Input file\n");
+  fprintf (stderr, "          handles and blocks of decoded input rows are shared by all of the\n");
+  fprintf (stderr, "          jobs and the grids are reused from job to job.\n");
+  fprintf (stderr, "--jobs = number of batch jobs to run at the same time (default 1).  With\n");
+  fprintf (stderr, "         --batch, --threads, --regrid-workers and --mem-limit are the totals\n");
+  fprintf (stderr, "         for all of the running jobs.  Jobs that don't set their own get an\n");
+  fprintf (stderr, "         even share and a job only starts when its share is free.  A job that\n");
+  fprintf (stderr, "         reads an earlier job's output file (or writes a file that an earlier\n");
+  fprintf (stderr, "         job reads or writes) waits for that job to finish.\n");
+  fprintf (stderr, "--cache = size of the batch cache of decoded input rows (default %dM, 0 to\n", BATCH_CACHE_BYTES / 1048576);
+  fprintf (stderr, "          turn it off).\n");
   fprintf (stderr, "-o = set the output file name instead of defaulting\n\n");
   fprintf (stderr, "Examples:\n\n");
   fprintf (stderr, "chrtr2_merge file1.ch2 file2.ch2\n\n");
@@ -94,548 +185,521 @@ void usage ()
   fprintf (stderr, "  MBR that includes all three files and the data from file3.ch2 will be\n");
   fprintf (stderr, "  inserted only where there are no points from file1.ch2 or file2.ch2 within 10\n");
   fprintf (stderr, "  grid cells of the data from file3.ch2.\n\n");
+  fprintf (stderr, "chrtr2_merge -b 10,250m file1.ch2 file2.ch2 file3.ch2\n\n");
+  fprintf (stderr, "  Same as the above example except that the data from file3.ch2 will be\n");
+  fprintf (stderr, "  inserted only where there are no points from file1.ch2 or file2.ch2 within\n");
+  fprintf (stderr, "  250 meters of the data from file3.ch2.\n\n");
 
   fflush (stderr);
   exit (-1);
 }
 
 
+/*  Add the file names in list_file (one per line) to the input files of context.  Returns NVFalse if we couldn't read the
+    file.  */
 
-int32_t main (int32_t argc, char *argv[])
+static uint8_t read_file_list (char *list_file, MERGE_CONTEXT *context)
 {
-  char               c;
-  extern char        *optarg;
-  extern int         optind;
-  int32_t            i, j, k, m, n, option_index = 0, chrtr2_handle[17], buffer_size = 4, start_x, end_x, start_y, end_y;
-  int32_t            row_filter, col_filter, percent = 0 , old_percent = -1, grid_rows, grid_cols, input_count = 0, file_count = 0;
-  char               input_file[16][512], output_file[512];
-  uint8_t            exclude = NVFalse, dateline = NVFalse, regrid = NVTrue, hit;
-  CHRTR2_HEADER      chrtr2_header[17];
-  CHRTR2_RECORD      chrtr2_record;
-  CH2_GRID           **grid;
-  float              min_z, max_z, *array;
-  double             lat, lon;
-  NV_F64_MBR         new_mbr;
-  NV_F64_XYMBR       mbr, misp_mbr;
-  NV_F64_COORD3      xyz;
-  NV_F64_COORD2      xy;
-  NV_I32_COORD2      coord, coord2;
-
-
-  printf ("\n\n %s \n\n\n", VERSION);
+  FILE               *fp;
+  char               string[1024], *name, *end;
 
 
-  strcpy (output_file, "");
+  if ((fp = fopen (list_file, "r")) == NULL) return (NVFalse);
 
-  while (NVTrue) 
+  while (fgets (string, sizeof (string), fp) != NULL)
     {
-      static struct option long_options[] = {{0, no_argument, 0, 0}};
-
-      c = (char) getopt_long (argc, argv, "enb:o:", long_options, &option_index);
-      if (c == -1) break;
-
-      switch (c) 
-        {
-        case 0:
-
-          switch (option_index)
-            {
-            case 0:
-              break;
-            }
-          break;
+      /*  Strip leading and trailing white space.  */
 
-        case 'e':
-          exclude = NVTrue;
-          break;
-
-        case 'n':
-          regrid = NVFalse;
-          break;
+      for (name = string ; *name == ' ' || *name == '\t' ; name++);
+      for (end = name + strlen (name) ; end > name && (end[-1] == '\n' || end[-1] == '\r' || end[-1] == ' ' || end[-1] == '\t') ; end--);
+      *end = 0;
 
-        case 'b':
-          sscanf (optarg, "%d", &buffer_size);
-          exclude = NVTrue;
-          break;
+      if (!name[0] || name[0] == '#') continue;
 
-        case 'o':
-          strcpy (output_file, optarg);
-          break;
 
-        default:
-          usage ();
+      if (!merge_context_add_file (context, name))
+        {
+          fprintf (stderr, "\n\n%s\n\n", context->error_message);
           exit (-1);
-          break;
         }
     }
 
+  fclose (fp);
 
-  /* Make sure we got the mandatory file names.  */
+  return (NVTrue);
+}
 
-  file_count = argc - optind;
-  if (file_count < 2 || file_count > 16) usage ();
 
 
-  /*  Open all of the input files and determine the MBR of the output file.  */
+/*  Convert a size like 512, 512M, or 4G to bytes.  Plain numbers are megabytes.  Returns -1 on error.  */
 
-  new_mbr.wlon = 999.0;
-  new_mbr.elon = -999.0;
-  new_mbr.slat = 999.0;
-  new_mbr.nlat = -999.0;
+static int64_t parse_mem_limit (char *string)
+{
+  double             size;
+  char               units = 'M';
 
-  for (i = 0 ; i < file_count ; i++)
-    {
-      strcpy (input_file[i], argv[optind + i]);
 
-      fprintf (stderr, "Input file %d  : %s\n", i + 1, input_file[i]);
-      fflush (stderr);
+  if (sscanf (string, "%lf%c", &size, &units) < 1 || size <= 0.0) return (-1);
 
+  switch (units)
+    {
+    case 'k':
+    case 'K':
+      return ((int64_t) (size * 1024.0));
 
-      /*  Open the input file.  */
+    case 'm':
+    case 'M':
+      return ((int64_t) (size * 1048576.0));
 
-      chrtr2_handle[i] = chrtr2_open_file (input_file[i], &chrtr2_header[i], CHRTR2_READONLY);
+    case 'g':
+    case 'G':
+      return ((int64_t) (size * 1073741824.0));
+    }
 
-      if (chrtr2_handle[i] < 0)
-        {
-          fprintf (stderr, "\n\nThe file %s is not a CHRTR2 file or there was an error reading the file.\nThe error message returned was:%s\n\n",
-                   input_file[i], chrtr2_strerror ());
-          exit (-1);
-        }
+  return (-1);
+}
 
-      new_mbr.wlon = MIN (new_mbr.wlon, chrtr2_header[i].mbr.wlon);
-      new_mbr.slat = MIN (new_mbr.slat, chrtr2_header[i].mbr.slat);
-      new_mbr.elon = MAX (new_mbr.elon, chrtr2_header[i].mbr.elon);
-      new_mbr.nlat = MAX (new_mbr.nlat, chrtr2_header[i].mbr.nlat);
 
-      if (!dateline && new_mbr.elon > 360.0) dateline = NVTrue;
-    }
 
+/*  Everything that can be set on the command line (or on one line of a batch job file).  The merge itself is set up in
+    context, the rest only matters to the command line.  */
 
-  if (dateline && new_mbr.elon < new_mbr.wlon) new_mbr.elon += 360.0;
-
+typedef struct
+{
+  MERGE_CONTEXT      context;
+  char               list_file[512];
+  char               batch_file[512];
+  uint8_t            threads_set;     /*  --threads was given  */
+  uint8_t            workers_set;     /*  --regrid-workers was given  */
+  int32_t            jobs;            /*  Number of batch jobs to run at once  */
+  int64_t            cache_bytes;     /*  Size of the batch input cache  */
+  int32_t            error;           /*  What merge_context_run returned for the job  */
+  char               error_message[512];
+} OPTIONS;
 
-  chrtr2_header[16] = chrtr2_header[0];
-  chrtr2_header[16].mbr = new_mbr;
-  chrtr2_header[16].width = NINT ((new_mbr.elon - new_mbr.wlon) / chrtr2_header[0].lon_grid_size_degrees) + 1;
-  chrtr2_header[16].height = NINT ((new_mbr.nlat - new_mbr.slat) / chrtr2_header[0].lat_grid_size_degrees) + 1;
 
 
-  /*  Make the output file name.  */
+/*  Copy the file name argument of option to to (size bytes).  Names that don't fit are rejected.  */
 
-  if (strlen (output_file) < 3)
-    {
-      strcpy (output_file, input_file[0]);
-      sprintf (&output_file[strlen (output_file) - 4], "__merged.ch2");
-    }
-  else
+static void copy_argument (char *to, int32_t size, char *option, char *argument)
+{
+  if (strlen (argument) >= (size_t) size)
     {
-      /*  Make sure the .ch2 extension was included if the output file was specified on the command line.  */
-
-      if (strcmp (&output_file[strlen (output_file) - 4], ".ch2")) strcat (output_file, ".ch2");
+      fprintf (stderr, "\n\nThe %s file name is too long (at most %d characters) : %s\n\n", option, size - 1, argument);
+      exit (-1);
     }
 
+  strcpy (to, argument);
+}
 
-  /*  Try to create and open the chrtr2 output file.  */
 
-  chrtr2_handle[16] = chrtr2_create_file (output_file, &chrtr2_header[16]);
-  if (chrtr2_handle[16] < 0)
-    {
-      chrtr2_perror ();
-      exit (-1);
-    }
 
+/*  Parse a command line into options.  If job_line is set argv came from a line of a batch job file (which can't start
+    another batch).  */
 
-  fprintf (stderr, "Output file : %s\n\n", output_file);
-  fflush (stderr);
+static void parse_options (int32_t argc, char *argv[], OPTIONS *options, uint8_t job_line)
+{
+  char               c;
+  extern char        *optarg;
+  extern int         optind;
+  int32_t            i, option_index = 0;
+  char               *buffer_arg;
+  MERGE_CONTEXT      *context = &options->context;
 
 
-  /*  Allocate the output grid in memory so we don't have to keep reading and writing the output file.  */
+  memset (options, 0, sizeof (OPTIONS));
+  merge_context_init (context);
+  options->jobs = 1;
+  options->cache_bytes = BATCH_CACHE_BYTES;
 
-  grid = (CH2_GRID **) malloc (chrtr2_header[16].height * sizeof (CH2_GRID *));
-  if (grid == NULL)
-    {
-      perror ("Allocating grid array in main.c");
-      exit (-1);
-    }
 
-  for (i = 0 ; i < chrtr2_header[16].height ; i++)
-    {
-      grid[i] = (CH2_GRID *) calloc (chrtr2_header[16].width, sizeof (CH2_GRID));
-      if (grid[i] == NULL)
-        {
-          perror ("Allocating grid[i] array in main.c");
-          exit (-1);
-        }
-    }
-      
+  /*  Start getopt over since we parse more than one command line in a batch.  */
 
-  /*  Read all of the input CHRTR2 files and fill the sparse grid.  */
+  optind = 0;
 
-  for (i = 0 ; i < file_count ; i++)
+  while (NVTrue) 
     {
-      /*  Loop for height of input file.  */
+      static struct option long_options[] = {{"threads", required_argument, 0, 0},
+                                             {"mem-limit", required_argument, 0, 0},
+                                             {"holes-only", no_argument, 0, 0},
+                                             {"incremental", no_argument, 0, 0},
+                                             {"list", required_argument, 0, 0},
+                                             {"pipeline", no_argument, 0, 0},
+                                             {"stats-json", required_argument, 0, 0},
+                                             {"verify", optional_argument, 0, 0},
+                                             {"batch", required_argument, 0, 0},
+                                             {"jobs", required_argument, 0, 0},
+                                             {"cache", required_argument, 0, 0},
+                                             {"area", required_argument, 0, 0},
+                                             {"checkpoint", no_argument, 0, 0},
+                                             {"resume", no_argument, 0, 0},
+                                             {"gtiff", required_argument, 0, 0},
+                                             {"raw", required_argument, 0, 0},
+                                             {"pyramid", no_argument, 0, 0},
+                                             {"policy", required_argument, 0, 0},
+                                             {"summary-json", required_argument, 0, 0},
+                                             {"regrid-workers", required_argument, 0, 0},
+                                             {0, no_argument, 0, 0}};
 
-      for (j = 0 ; j < chrtr2_header[i].height ; j++)
+      c = (char) getopt_long (argc, argv, "enb:o:", long_options, &option_index);
+      if (c == -1) break;
+
+      switch (c) 
         {
-          coord.y = j;
+        case 0:
 
+          switch (option_index)
+            {
+            case 0:
+              sscanf (optarg, "%d", &context->merge.thread_count);
+              if (context->merge.thread_count < 1) usage ();
+              options->threads_set = NVTrue;
+              break;
+
+            case 1:
+              context->mem_limit = parse_mem_limit (optarg);
+              if (context->mem_limit < 0) usage ();
+              break;
 
-          /*  Loop for width of input file.  */
+            case 2:
+              context->merge.holes_only = NVTrue;
+              break;
 
-          for (k = 0 ; k < chrtr2_header[i].width ; k++)
-            {
-              coord.x = k;
+            case 3:
+              context->incremental = NVTrue;
+              break;
 
+            case 4:
+              copy_argument (options->list_file, sizeof (options->list_file), "--list", optarg);
+              break;
 
-              /*  Read the input record.  */
+            case 5:
+              context->pipeline = NVTrue;
+              break;
 
-              chrtr2_read_record (chrtr2_handle[i], coord, &chrtr2_record);
+            case 6:
+              copy_argument (context->stats_file, sizeof (context->stats_file), "--stats-json", optarg);
+              break;
 
+            case 7:
+              context->merge.verify = 1;
+              if (optarg != NULL) sscanf (optarg, "%d", &context->merge.verify);
+              if (context->merge.verify < 1) usage ();
+              break;
 
-              /*  For the first file we just slap the data into the grid.  */
+            case 8:
+              if (job_line) usage ();
+              copy_argument (options->batch_file, sizeof (options->batch_file), "--batch", optarg);
+              break;
 
-	      if (!i)
-		{
-		  grid[coord2.y][coord2.x].ch2 = chrtr2_record;
-		  grid[coord2.y][coord2.x].rank = i + 1;
-		}
+            case 9:
+              if (job_line) usage ();
+              sscanf (optarg, "%d", &options->jobs);
+              if (options->jobs < 1) usage ();
+              break;
 
+            case 10:
+              if (job_line) usage ();
+              options->cache_bytes = strcmp (optarg, "0") ? parse_mem_limit (optarg) : 0;
+              if (options->cache_bytes < 0) usage ();
+              break;
 
-              /*  Get the lat and lon of the center position of the input grid cell.  */
+            case 11:
+              if (!merge_context_area (&options->context, optarg))
+                {
+                  fprintf (stderr, "\n\n%s\n", options->context.error_message);
+                  perror ("    ");
+                  exit (-1);
+                }
+              break;
 
-              chrtr2_get_lat_lon (chrtr2_handle[i], &lat, &lon, coord);
+            case 12:
+              context->checkpoint = NVTrue;
+              break;
 
-              lat = lat + EPS;
-              lon = lon + EPS;      
+            case 13:
+              context->checkpoint = context->resume = NVTrue;
+              break;
 
+            case 14:
+              copy_argument (context->gtiff_file, sizeof (context->gtiff_file), "--gtiff", optarg);
+              break;
 
-              /*  Check for dateline crossing.  */
+            case 15:
+              copy_argument (context->raw_file, sizeof (context->raw_file), "--raw", optarg);
+              break;
 
-              if (dateline && lon < 0.0) lon += 360.0;
+            case 16:
+              context->pyramid = NVTrue;
+              break;
 
+            case 17:
+              if ((context->merge.policy = merge_policy_parse (optarg)) < 0) usage ();
+              break;
 
-              /*  Check to see if the lat and lon is in the output file (it damn well should be).  */
+            case 18:
+              copy_argument (context->summary_file, sizeof (context->summary_file), "--summary-json", optarg);
+              break;
 
-              if (!chrtr2_get_coord (chrtr2_handle[16], lat, lon, &coord2))
-                {
-                  /*  If we're using the exclude option...  */
-
-                  if (exclude)
-                    {
-                      /*  Check for real, hand-drawn/digitized, or land masked data.  */
-
-                      if (chrtr2_record.status & (CHRTR2_REAL | CHRTR2_DIGITIZED_CONTOUR | CHRTR2_LAND_MASK))
-                        {
-                          /*  The first file is already populated (see above).  For subsequent files we have to check against what's already loaded into the grid.
-                              Don't forget the buffer-size.  */
-
-                          if (i)
-                            {
-                              /*  Determine the buffer_size box to exclude.  */
-
-                              start_x = MAX (coord2.x - buffer_size, 0);
-                              end_x = MIN (coord2.x + buffer_size, chrtr2_header[16].width - 1);
-                              start_y = MAX (coord2.y - buffer_size, 0);
-                              end_y = MIN (coord2.y + buffer_size, chrtr2_header[16].height - 1);
-
-
-                              /*  Check all bins in the buffer.  */
-
-                              hit = NVFalse;
-                              for (m = start_y ; m <= end_y ; m++)
-                                {
-                                  for (n = start_x ; n <= end_x ; n++)
-                                    {
-                                      /*  First check to see that the point isn't from this file.  */
-
-                                      if ((grid[m][n].rank != i + 1) && 
-                                          (grid[m][n].ch2.status & (CHRTR2_REAL | CHRTR2_DIGITIZED_CONTOUR | CHRTR2_LAND_MASK))) hit = NVTrue;
-                                    }
-                                }
-
-
-                              /*  If no bins in the buffer had real, hand-drawn/digitized, or land mask data, fill the bin.  */
-
-                              if (!hit)
-                                {
-                                  grid[coord2.y][coord2.x].ch2 = chrtr2_record;
-                                  grid[coord2.y][coord2.x].rank = i + 1;
-                                }                                  
-                            }
-                        }
-                    }
-                  else
-                    {
-                      /*  The first file is already populated (see above).  For subsequent files we have to check against what's already loaded into the grid.
-                          Don't forget the buffer-size.  */
-
-                      if (i)
-                        {
-                          /*  We only load data where there is no data (i.e. NULL).  This is actually more of an insert than a merge but
-                              this is what we need.  If there is no data in the bin, place the new data into the bin.  */
-
-                          if (!grid[coord2.y][coord2.x].ch2.status)
-                            {
-                              grid[coord2.y][coord2.x].ch2 = chrtr2_record;
-                              grid[coord2.y][coord2.x].rank = i + 1;
-                            }
-                        }
-                    }
-                }
+            case 19:
+              sscanf (optarg, "%d", &context->merge.regrid_workers);
+              if (context->merge.regrid_workers < 1) usage ();
+              options->workers_set = NVTrue;
+              break;
             }
+          break;
 
+        case 'e':
+          context->merge.exclude = NVTrue;
+          break;
 
-          percent = NINT (((float) j / (float) chrtr2_header[i].height) * 100.0);
-          if (percent != old_percent)
-            {
-              fprintf (stderr, "Reading CHRTR2 file %d of %d - %03d%% complete\r", i + 1, file_count, percent);
-              fflush (stderr);
-              old_percent = percent;
-            }
-        }
-    }
+        case 'n':
+          context->merge.regrid = NVFalse;
+          break;
 
-  fprintf (stderr, "                                                                   \r");
-  fprintf (stderr, "\nData read complete\n\n");
-  fflush (stderr);
+        case 'b':
 
+          /*  Either a single buffer size or a comma separated list of per file buffer sizes.  A trailing m means the size
+              is in meters.  */
 
-  min_z = 9999999999.0;
-  max_z = -9999999999.0;
+          context->buffer_size = (float *) realloc (context->buffer_size, (strlen (optarg) / 2 + 1) * sizeof (float));
+          context->buffer_meters = (uint8_t *) realloc (context->buffer_meters, (strlen (optarg) / 2 + 1) * sizeof (uint8_t));
+          if (context->buffer_size == NULL || context->buffer_meters == NULL)
+            {
+              perror ("Allocating buffer sizes in main.c");
+              exit (-1);
+            }
 
+          context->buffer_count = 0;
+          for (buffer_arg = strtok (optarg, ",") ; buffer_arg != NULL ; buffer_arg = strtok (NULL, ","))
+            {
+              if (sscanf (buffer_arg, "%f", &context->buffer_size[context->buffer_count]) != 1 ||
+                  context->buffer_size[context->buffer_count] < 0.0) usage ();
+              context->buffer_meters[context->buffer_count] = (strchr (buffer_arg, 'm') != NULL);
+              context->buffer_count++;
+            }
+          context->merge.exclude = NVTrue;
+          break;
 
-  /*  Close the input files.  */
+        case 'o':
+          copy_argument (context->output_file, sizeof (context->output_file), "-o", optarg);
+          break;
 
-  for (i = 0 ; i < file_count ; i++) chrtr2_close_file (chrtr2_handle[i]);
+        default:
+          usage ();
+          exit (-1);
+          break;
+        }
+    }
 
 
-  /*  Check to see if we want to regrid.  */
+  /*  The input file names are the rest of the command line followed by the contents of the list file.  */
 
-  if (regrid)
+  for (i = optind ; i < argc ; i++)
     {
-      /*  Define the MBR for the new grid (adding the filter border).  */
+      if (!merge_context_add_file (context, argv[i]))
+        {
+          fprintf (stderr, "\n\n%s\n\n", context->error_message);
+          exit (-1);
+        }
+    }
 
-      mbr.min_x = chrtr2_header[16].mbr.wlon;
-      mbr.min_y = chrtr2_header[16].mbr.slat;
-      mbr.max_x = chrtr2_header[16].mbr.elon;
-      mbr.max_y = chrtr2_header[16].mbr.nlat;
+  if (options->list_file[0] && !read_file_list (options->list_file, context))
+    {
+      fprintf (stderr, "\n\nUnable to read the input file list %s\n", options->list_file);
+      perror ("    ");
+      exit (-1);
+    }
 
 
-      /*  Add the filter border to the MBR.  */
+  /*  An incremental update doesn't rewrite every row so a checkpoint couldn't say what's in the output file.  */
 
-      mbr.min_x -= ((double) FILTER * chrtr2_header[16].lon_grid_size_degrees);
-      mbr.min_y -= ((double) FILTER * chrtr2_header[16].lat_grid_size_degrees);
-      mbr.max_x += ((double) FILTER * chrtr2_header[16].lon_grid_size_degrees);
-      mbr.max_y += ((double) FILTER * chrtr2_header[16].lat_grid_size_degrees);
+  if (context->checkpoint && context->incremental) usage ();
 
 
-      /*  Number of rows and columns in the area  */
+  /*  The raster outputs (and the pyramid and summary) are made from the output rows as they go by so they need all of them.  */
 
-      grid_rows = NINT ((mbr.max_y - mbr.min_y) / chrtr2_header[16].lat_grid_size_degrees);
-      grid_cols = NINT ((mbr.max_x - mbr.min_x) / chrtr2_header[16].lon_grid_size_degrees);
+  if ((context->gtiff_file[0] || context->raw_file[0] || context->pyramid || context->summary_file[0]) &&
+      (context->checkpoint || context->incremental)) usage ();
 
 
-      row_filter = grid_rows - FILTER;
-      col_filter = grid_cols - FILTER;
+  /*  -e is first file wins with exclude buffers so it can't be mixed with the other policies.  */
 
+  if (context->merge.exclude && context->merge.policy != MERGE_POLICY_FIRST) usage ();
 
-      /*  We're going to let MISP/SURF handle everything in zero based units of the bin size.  That is, we subtract off the
-          west lon from longitudes then divide by the grid size in the X direction.  We do the same with the latitude using
-          the south latitude.  This will give us values that range from 0.0 to grid5_cols in longitude and 0.0 to
-          grid5_rows in latitude.  */
 
-      misp_mbr.min_x = 0.0;
-      misp_mbr.min_y = 0.0;
-      misp_mbr.max_x = (double) grid_cols;
-      misp_mbr.max_y = (double) grid_rows;
+  /*  A batch gets its input files from the job file.  */
 
+  if (options->batch_file[0])
+    {
+      if (context->path_count) usage ();
+      return;
+    }
 
-      misp_init (1.0, 1.0, 0.05, 4, 20.0, 20, 999999.0, -999999.0, -2, misp_mbr);
 
+  /* Make sure we got the mandatory file names.  */
 
-      for (i = 0 ; i < chrtr2_header[16].height ; i++)
-        {
-          coord.y = i;
+  if (context->merge.file_count < 2) usage ();
+}
 
-          for (j = 0 ; j < chrtr2_header[16].width ; j++)
-            {
-              coord.x = j;
 
 
-              /*  No point in loading null values.  */
+/*  Run job number job of a batch.  */
 
-              if (grid[coord.y][coord.x].ch2.status)
-                {
-                  chrtr2_get_lat_lon (chrtr2_handle[16], &xy.y, &xy.x, coord);
+static void run_job (BATCH *batch, int32_t job, BATCH_WORKER *worker)
+{
+  OPTIONS            *options;
 
 
-                  /*
-                    Load the points.
+  options = &((OPTIONS *) batch->data)[job];
 
-                    IMPORTANT NOTE:  MISP and GMT (by default) grid using corner posts.  That is, the data in a bin is assigned to the 
-                    lower left corner of the bin.  Normal gridding/binning systems use the center of the bin.  Because of this we need
-                    to lie to MISP/GMT and tell them that the point is really half a bin lower and to the left.  This is extremely
-                    confusing but it works ;-)
-                  */
+  fprintf (stderr, "Job %d of %d (line %d) started\n\n", job + 1, batch->job_count, batch->job[job].line);
+  fflush (stderr);
 
-                  xyz.x = (xy.x - mbr.min_x) / chrtr2_header[16].lon_grid_size_degrees;
-                  xyz.y = (xy.y - mbr.min_y) / chrtr2_header[16].lat_grid_size_degrees;
-                  xyz.z = grid[coord.y][coord.x].ch2.z;
+  options->error = merge_context_run (&options->context, worker->grid, &batch->cache);
+  strcpy (options->error_message, options->context.error_message);
 
-                  input_count++;
+  merge_context_free (&options->context);
 
-                  misp_load (xyz);
-                }
-            }
+  fprintf (stderr, "Job %d of %d (line %d) %s\n\n", job + 1, batch->job_count, batch->job[job].line,
+           options->error == MERGE_OK ? "finished" : "failed");
+  fflush (stderr);
+}
 
-          percent = NINT (((float) i / (float) chrtr2_header[16].height) * 100.0);
-          if (percent != old_percent)
-            {
-              fprintf (stderr, "Loading data for re-grid - %03d%% complete\r", percent);
-              fflush (stderr);
-              old_percent = percent;
-            }
-        }
 
-      fprintf (stderr, "                                                                   \r");
-      fprintf (stderr, "\nData load complete, %d points loaded\n\n", input_count);
 
+int32_t main (int32_t argc, char *argv[])
+{
+  int32_t            i, error, failed = 0, errors = 0;
+  char               output_file[512];
+  OPTIONS            options, *job_options;
+  MERGE_CONTEXT      *job;
+  BATCH              batch;
 
-      fprintf (stderr, "Processing grid\n");
-      fflush (stderr);
 
+  printf ("\n\n %s \n\n\n", VERSION);
 
-      misp_proc ();
 
+  parse_options (argc, argv, &options, NVFalse);
 
-      fprintf (stderr, "Processing grid complete\n");
-      fflush (stderr);
 
+  if (!options.batch_file[0])
+    {
+      error = merge_context_run (&options.context, NULL, NULL);
+
+      if (error != MERGE_OK && error != MERGE_ERROR_VERIFY)
+        {
+          fprintf (stderr, "\n\n%s\n\n", options.context.error_message);
+          exit (-1);
+        }
 
-      array = (float *) malloc ((grid_cols + 1) * sizeof (float));
+      if (error == MERGE_ERROR_VERIFY) failed++;
 
-      if (array == NULL)
+      merge_context_free (&options.context);
+    }
+  else
+    {
+      if (!batch_read (&batch, options.batch_file, argv[0]))
         {
-          perror ("Allocating array in main.c");
+          fprintf (stderr, "\n\nUnable to read the job file %s\n", options.batch_file);
+          perror ("    ");
           exit (-1);
         }
 
 
-      /*  This is where we stuff the new interpolated surface into the new CHRTR2.  */
+      /*  Parse all of the jobs before we start so a bad line doesn't stop the batch part way through.  Jobs that don't set
+          their own --threads, --regrid-workers or --mem-limit get an even share of the batch's.  */
 
-      for (i = 0 ; i < grid_rows ; i++)
+      if ((job_options = (OPTIONS *) calloc (MAX (batch.job_count, 1), sizeof (OPTIONS))) == NULL)
         {
-          if (!misp_rtrv (array)) break;
+          perror ("Allocating jobs in main.c");
+          exit (-1);
+        }
 
+      for (i = 0 ; i < batch.job_count ; i++)
+        {
+          fprintf (stderr, "Job %d (line %d of %s) : ", i + 1, batch.job[i].line, options.batch_file);
+          parse_options (batch.job[i].argc, batch.job[i].argv, &job_options[i], NVTrue);
+          fprintf (stderr, "%d input files\n", job_options[i].context.path_count);
 
-          /*  Only use data that aren't in the filter border  */
+          job = &job_options[i].context;
 
-          if (i >= FILTER && i < row_filter)
-            {
-              coord.y = i - FILTER;
+          if (!job_options[i].threads_set) job->merge.thread_count = MAX (1, options.context.merge.thread_count / options.jobs);
+          if (!job_options[i].workers_set) job->merge.regrid_workers = MAX (1, options.context.merge.regrid_workers / options.jobs);
+          if (!job->mem_limit && options.context.mem_limit) job->mem_limit = options.context.mem_limit / options.jobs;
+          if (options.jobs > 1) job->merge.quiet = NVTrue;
 
-              for (j = 0 ; j < grid_cols ; j++)
-                {
-                  /*  Only use data that aren't in the filter border  */
-
-                  if (j >= FILTER && j < col_filter)
-                    {
-                      coord.x = j - FILTER;
 
+          /*  The jobs share the input file handle limit too.  */
 
-                      /*  Make sure we're inside the CHRTR2 bounds.  */
+          job->max_open = MAX (2, MAX_OPEN_INPUTS / options.jobs);
 
-                      if (coord.y >= 0 && coord.y < chrtr2_header[16].height && coord.x >= 0 && coord.x < chrtr2_header[16].width)
-                        {
-                          /*  Don't replace real, hand-drawn/digitized, or land masked data.  */
+          batch.job[i].threads = MAX (job->merge.thread_count, job->merge.regrid_workers);
+          batch.job[i].mem_limit = job->mem_limit;
 
-                          if (!(grid[coord.y][coord.x].ch2.status & (CHRTR2_REAL | CHRTR2_DIGITIZED_CONTOUR | CHRTR2_LAND_MASK)))
-                            {
-                              grid[coord.y][coord.x].ch2.z = array[j];
-                              grid[coord.y][coord.x].ch2.status |= CHRTR2_INTERPOLATED;
-                            }
 
-                          min_z = MIN (grid[coord.y][coord.x].ch2.z, min_z);
-                          max_z = MAX (grid[coord.y][coord.x].ch2.z, max_z);
+          /*  So that a job that reads another job's output doesn't start until that job is done.  */
 
-                          chrtr2_write_record (chrtr2_handle[16], coord, grid[coord.y][coord.x].ch2);
-                        }
-                    }
-                }
+          if (!merge_context_output_file (job, output_file))
+            {
+              fprintf (stderr, "\n\nJob %d (line %d of %s) : the output file name is too long\n\n", i + 1, batch.job[i].line,
+                       options.batch_file);
+              exit (-1);
             }
 
-          percent = NINT (((float) i / (float) grid_rows) * 100.0);
-          if (percent != old_percent)
+          if (!batch_files (&batch, i, output_file, job->path_count, job->path))
             {
-              fprintf (stderr, "Retrieving data for output file - %03d%% complete\r", percent);
-              fflush (stderr);
-              old_percent = percent;
+              perror ("Allocating job file names in main.c");
+              exit (-1);
             }
         }
 
-
-      fprintf (stderr, "                                                                   \r");
-      fprintf (stderr, "\nFinal grid retrieval complete\n\n");
+      fprintf (stderr, "\n");
       fflush (stderr);
 
-
-      free (array);
-    }
-  else
-    {
-      for (i = 0 ; i < chrtr2_header[16].height ; i++)
+      if (!batch_run (&batch, options.jobs, MAX (options.context.merge.thread_count, options.context.merge.regrid_workers),
+                      options.context.mem_limit, MAX_OPEN_INPUTS, options.cache_bytes, run_job, job_options))
         {
-          coord.y = i;
+          perror ("Starting batch workers in main.c");
+          exit (-1);
+        }
 
-          for (j = 0 ; j < chrtr2_header[16].width ; j++)
+      for (i = 0 ; i < batch.job_count ; i++)
+        {
+          if (job_options[i].error == MERGE_ERROR_VERIFY)
             {
-              coord.x = j;
-
-              if (grid[coord.y][coord.x].ch2.status)
-                {
-                  min_z = MIN (grid[coord.y][coord.x].ch2.z, min_z);
-                  max_z = MAX (grid[coord.y][coord.x].ch2.z, max_z);
-
-                  chrtr2_write_record (chrtr2_handle[16], coord, grid[coord.y][coord.x].ch2);
-                }
+              fprintf (stderr, "Job %d (line %d of %s) didn't match the reference merge (see --verify above)\n", i + 1,
+                       batch.job[i].line, options.batch_file);
+              failed++;
             }
-
-          percent = NINT (((float) i / (float) chrtr2_header[16].height) * 100.0);
-          if (percent != old_percent)
+          else if (job_options[i].error != MERGE_OK)
             {
-              fprintf (stderr, "Writing chrtr2 data - %03d%% complete\r", percent);
-              fflush (stderr);
-              old_percent = percent;
+              fprintf (stderr, "Job %d (line %d of %s) failed : %s\n", i + 1, batch.job[i].line, options.batch_file,
+                       job_options[i].error_message);
+              errors++;
             }
         }
 
-
-      fprintf (stderr, "                                                                   \r");
-      fprintf (stderr, "\nFile writing complete\n\n");
-      fflush (stderr);
+      free (job_options);
+      batch_free (&batch);
     }
 
 
-  for (i = 0 ; i < chrtr2_header[16].height ; i++) free (grid[i]);
-  free (grid);
-
-      
-  chrtr2_close_file (chrtr2_handle[16]);
-
-
-  /*  Update the header with the observed min and max values.  */
-
-  chrtr2_header[16].min_observed_z = min_z;
-  chrtr2_header[16].max_observed_z = max_z;
-
-  chrtr2_update_header (chrtr2_handle[16], chrtr2_header[16]);
-
-  chrtr2_close_file (chrtr2_handle[16]);
-
-
   fprintf (stderr, "\n\n%s complete\n\n\n", argv[0]);
   fflush (stderr);
 
+  if (errors)
+    {
+      fprintf (stderr, "%s : %d of the jobs failed (see above)\n\n", argv[0], errors);
+      exit (-1);
+    }
+
+  if (failed)
+    {
+      fprintf (stderr, "%s : the merged grid didn't match the reference merge (see --verify above)\n\n", argv[0]);
+      exit (-1);
+    }
+
 
   /*  Please ignore the following line.  It is useless.  Except...
 
@@ -0,0 +1,581 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "manifest.h"
+
+
+/*  FNV-1a hash of size bytes of data added to hash.  */
+
+static inline uint64_t hash_bytes (uint64_t hash, void *data, size_t size)
+{
+  uint8_t            *ptr = (uint8_t *) data;
+  size_t             i;
+
+
+  for (i = 0 ; i < size ; i++)
+    {
+      hash ^= ptr[i];
+      hash *= 0x100000001b3ULL;
+    }
+
+  return (hash);
+}
+
+
+
+/*  Write the options and output grid definition of the merge to options (which has to hold at least 1024 characters).
+    This has to be on one line so the per file exclude buffers (there could be hundreds) are hashed.  */
+
+void manifest_options (MERGE *merge, char *options)
+{
+  uint64_t           buffers, polygon;
+  CHRTR2_HEADER      *header;
+
+
+  header = &merge->output_header;
+
+  buffers = 0xcbf29ce484222325ULL;
+  buffers = hash_bytes (buffers, merge->buffer_x, merge->file_count * sizeof (int32_t));
+  buffers = hash_bytes (buffers, merge->buffer_y, merge->file_count * sizeof (int32_t));
+
+  sprintf (options, "exclude=%d regrid=%d holes_only=%d mbr=%.11f,%.11f,%.11f,%.11f grid=%.11f,%.11f buffers=%016llx",
+           merge->exclude, merge->regrid, merge->holes_only, header->mbr.wlon, header->mbr.slat, header->mbr.elon, header->mbr.nlat,
+           header->lon_grid_size_degrees, header->lat_grid_size_degrees, (unsigned long long) buffers);
+
+
+  /*  Only the policies other than the default (and -e) are added so older manifests still match.  */
+
+  if (merge->policy != MERGE_POLICY_FIRST && merge->policy != MERGE_POLICY_EXCLUDE)
+    sprintf (&options[strlen (options)], " policy=%s", merge_policy_name (merge->policy));
+
+
+  /*  The number of regrid processes changes the interpolated values.  A single pass isn't added so older manifests still
+      match.  */
+
+  if (merge->regrid && merge->regrid_workers > 1) sprintf (&options[strlen (options)], " regrid_workers=%d", merge->regrid_workers);
+
+
+  /*  The part of the merge grid that is in the output file for --area.  */
+
+  if (merge->area != NULL)
+    {
+      polygon = 0xcbf29ce484222325ULL;
+      polygon = hash_bytes (polygon, merge->area->polygon_x, merge->area->polygon_count * sizeof (double));
+      polygon = hash_bytes (polygon, merge->area->polygon_y, merge->area->polygon_count * sizeof (double));
+
+      sprintf (&options[strlen (options)], " area=%d,%d,%d,%d polygon=%016llx", merge->area->x, merge->area->y,
+               merge->area->header.width, merge->area->header.height, (unsigned long long) polygon);
+    }
+}
+
+
+
+/*  Set up an empty manifest for the merge.  The checksums are all zero until manifest_checksum is called and the bands
+    have no data.  Returns NVFalse (with the error in merge and nothing left allocated) if we ran out of memory.  */
+
+uint8_t manifest_init (MANIFEST *manifest, MERGE *merge)
+{
+  int32_t            i;
+  CHRTR2_HEADER      *header;
+  struct stat        file_stat;
+
+
+  memset (manifest, 0, sizeof (MANIFEST));
+
+  header = &merge->output_header;
+
+  manifest->width = header->width;
+  manifest->height = header->height;
+  manifest->band_count = (header->height + MANIFEST_BAND_ROWS - 1) / MANIFEST_BAND_ROWS;
+  manifest->file_count = merge->file_count;
+
+  manifest->input = (MANIFEST_INPUT *) calloc (manifest->file_count, sizeof (MANIFEST_INPUT));
+
+  if (manifest->input == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating manifest in manifest.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+
+  manifest->min_z = (float *) malloc (manifest->band_count * sizeof (float));
+  manifest->max_z = (float *) malloc (manifest->band_count * sizeof (float));
+
+  if (manifest->min_z == NULL || manifest->max_z == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating manifest ranges in manifest.c: %s", strerror (errno));
+      manifest_free (manifest);
+      return (NVFalse);
+    }
+
+  for (i = 0 ; i < manifest->band_count ; i++)
+    {
+      manifest->min_z[i] = 9999999999.0;
+      manifest->max_z[i] = -9999999999.0;
+    }
+
+
+  manifest_options (merge, manifest->options);
+
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      manifest->input[i].path = strdup (merge->inputs.path[i]);
+
+      if (manifest->input[i].path == NULL)
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating manifest file names in manifest.c: %s", strerror (errno));
+          manifest_free (manifest);
+          return (NVFalse);
+        }
+
+      manifest->input[i].size = -1;
+      manifest->input[i].mtime = -1;
+
+      if (!stat (merge->inputs.path[i], &file_stat))
+        {
+          manifest->input[i].size = (int64_t) file_stat.st_size;
+          manifest->input[i].mtime = (int64_t) file_stat.st_mtim.tv_sec * 1000000000 + (int64_t) file_stat.st_mtim.tv_nsec;
+        }
+
+      manifest->input[i].checksum = (uint64_t *) calloc (manifest->band_count, sizeof (uint64_t));
+
+      if (manifest->input[i].checksum == NULL)
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating manifest checksums in manifest.c: %s", strerror (errno));
+          manifest_free (manifest);
+          return (NVFalse);
+        }
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Parse an open manifest file.  */
+
+static uint8_t parse_manifest (FILE *fp, MANIFEST *manifest)
+{
+  char               string[2048];
+  int32_t            i, k;
+  long long          size, mtime;
+  unsigned long long checksum;
+  float              min_z, max_z;
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, "CHRTR2_MERGE MANIFEST 2", 23)) return (NVFalse);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, "OPTIONS ", 8)) return (NVFalse);
+  string[strcspn (string, "\n")] = 0;
+  if (strlen (&string[8]) >= sizeof (manifest->options)) return (NVFalse);
+  strcpy (manifest->options, &string[8]);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL ||
+      sscanf (string, "SIZE %d %d %d %d", &manifest->width, &manifest->height, &k, &manifest->band_count) != 4 ||
+      k != MANIFEST_BAND_ROWS || manifest->band_count != (manifest->height + MANIFEST_BAND_ROWS - 1) / MANIFEST_BAND_ROWS) return (NVFalse);
+
+
+  if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "FILES %d", &manifest->file_count) != 1 ||
+      manifest->file_count < 1) return (NVFalse);
+
+  manifest->input = (MANIFEST_INPUT *) calloc (manifest->file_count, sizeof (MANIFEST_INPUT));
+  if (manifest->input == NULL) return (NVFalse);
+
+
+  for (i = 0 ; i < manifest->file_count ; i++)
+    {
+      /*  FILE size mtime path (the path is the rest of the line so it can have spaces in it).  */
+
+      if (fgets (string, sizeof (string), fp) == NULL || sscanf (string, "FILE %lld %lld %n", &size, &mtime, &k) != 2) return (NVFalse);
+      if (strchr (string, '\n') == NULL) return (NVFalse);
+      string[strcspn (string, "\n")] = 0;
+      if ((manifest->input[i].path = strdup (&string[k])) == NULL) return (NVFalse);
+
+      manifest->input[i].size = (int64_t) size;
+      manifest->input[i].mtime = (int64_t) mtime;
+
+      manifest->input[i].checksum = (uint64_t *) calloc (manifest->band_count, sizeof (uint64_t));
+      if (manifest->input[i].checksum == NULL) return (NVFalse);
+
+      for (k = 0 ; k < manifest->band_count ; k++)
+        {
+          if (fscanf (fp, "%llx", &checksum) != 1) return (NVFalse);
+          manifest->input[i].checksum[k] = (uint64_t) checksum;
+        }
+
+      if (fgets (string, sizeof (string), fp) == NULL) return (NVFalse);
+    }
+
+
+  /*  RANGES followed by the minimum and maximum Z of each band.  */
+
+  if (fgets (string, sizeof (string), fp) == NULL || strncmp (string, "RANGES", 6)) return (NVFalse);
+
+  manifest->min_z = (float *) malloc (manifest->band_count * sizeof (float));
+  manifest->max_z = (float *) malloc (manifest->band_count * sizeof (float));
+  if (manifest->min_z == NULL || manifest->max_z == NULL) return (NVFalse);
+
+  for (k = 0 ; k < manifest->band_count ; k++)
+    {
+      if (fscanf (fp, "%f %f", &min_z, &max_z) != 2) return (NVFalse);
+      manifest->min_z[k] = min_z;
+      manifest->max_z[k] = max_z;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Read the manifest in path.  Returns NVFalse if there isn't one or we can't make sense of it (in which case we just do a
+    full merge).  */
+
+uint8_t manifest_read (MANIFEST *manifest, char *path)
+{
+  FILE               *fp;
+
+
+  memset (manifest, 0, sizeof (MANIFEST));
+
+  if ((fp = fopen (path, "r")) == NULL) return (NVFalse);
+
+  if (!parse_manifest (fp, manifest))
+    {
+      fclose (fp);
+      manifest_free (manifest);
+      return (NVFalse);
+    }
+
+  fclose (fp);
+
+  return (NVTrue);
+}
+
+
+
+/*  Write the manifest to path.  We write it to a temporary file and rename it so that a crash can't leave a manifest that
+    doesn't match the output file.  */
+
+uint8_t manifest_write (MANIFEST *manifest, char *path)
+{
+  FILE               *fp;
+  char               temp[1024];
+  int32_t            i, k;
+
+
+  sprintf (temp, "%s.tmp", path);
+
+  if ((fp = fopen (temp, "w")) == NULL) return (NVFalse);
+
+  fprintf (fp, "CHRTR2_MERGE MANIFEST 2\n");
+  fprintf (fp, "OPTIONS %s\n", manifest->options);
+  fprintf (fp, "SIZE %d %d %d %d\n", manifest->width, manifest->height, MANIFEST_BAND_ROWS, manifest->band_count);
+  fprintf (fp, "FILES %d\n", manifest->file_count);
+
+  for (i = 0 ; i < manifest->file_count ; i++)
+    {
+      fprintf (fp, "FILE %lld %lld %s\n", (long long) manifest->input[i].size, (long long) manifest->input[i].mtime, manifest->input[i].path);
+
+      for (k = 0 ; k < manifest->band_count ; k++)
+        fprintf (fp, "%016llx%c", (unsigned long long) manifest->input[i].checksum[k], (k % 4 == 3 || k == manifest->band_count - 1) ? '\n' : ' ');
+    }
+
+  fprintf (fp, "RANGES\n");
+
+  for (k = 0 ; k < manifest->band_count ; k++)
+    fprintf (fp, "%.9g %.9g%c", manifest->min_z[k], manifest->max_z[k], (k % 4 == 3 || k == manifest->band_count - 1) ? '\n' : ' ');
+
+  if (fclose (fp))
+    {
+      remove (temp);
+      return (NVFalse);
+    }
+
+
+  remove (path);
+
+  if (rename (temp, path))
+    {
+      remove (temp);
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Returns NVTrue if old describes an output file that was made with the same options, output grid, and input files (in
+    the same order) as manifest.  */
+
+uint8_t manifest_match (MANIFEST *manifest, MANIFEST *old)
+{
+  int32_t            i;
+
+
+  if (strcmp (manifest->options, old->options) || manifest->width != old->width || manifest->height != old->height ||
+      manifest->band_count != old->band_count || manifest->file_count != old->file_count) return (NVFalse);
+
+  for (i = 0 ; i < manifest->file_count ; i++) if (strcmp (manifest->input[i].path, old->input[i].path)) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+/*  Compute the band checksums for input file i.  The input geometry is hashed into every band so that moving or resizing
+    an input makes all of the bands dirty.  Under the newest policy the file's modification time decides which data wins
+    so it's hashed into every band that the file lands in (touching the file has to redo them).  Returns NVFalse (with the
+    error in merge) if we couldn't read the file.  */
+
+static uint8_t checksum_input (MANIFEST *manifest, MERGE *merge, int32_t i)
+{
+  int32_t            j, k, band, cols, handle, run_end;
+  uint64_t           seed, hash;
+  CHRTR2_HEADER      *header;
+  CHRTR2_RECORD      *row;
+  INPUT_MAP          *map;
+  INPUT_READER       reader;
+
+
+  header = &merge->inputs.header[i];
+  map = &merge->input_map[i];
+
+  seed = 0xcbf29ce484222325ULL;
+  seed = hash_bytes (seed, &header->mbr, sizeof (header->mbr));
+  seed = hash_bytes (seed, &header->lat_grid_size_degrees, sizeof (header->lat_grid_size_degrees));
+  seed = hash_bytes (seed, &header->lon_grid_size_degrees, sizeof (header->lon_grid_size_degrees));
+  seed = hash_bytes (seed, &header->width, sizeof (header->width));
+  seed = hash_bytes (seed, &header->height, sizeof (header->height));
+
+  for (k = 0 ; k < manifest->band_count ; k++) manifest->input[i].checksum[k] = seed;
+
+
+  cols = map->end_col - map->start_col;
+  if (cols <= 0) return (NVTrue);
+
+  if ((handle = input_files_open (&merge->inputs, i)) < 0)
+    {
+      merge_error (merge, MERGE_ERROR_OPEN, "Error opening %s for checksum.\nThe error message returned was:%s", merge->inputs.path[i],
+                   chrtr2_strerror ());
+      return (NVFalse);
+    }
+
+  if (!input_reader_open (&reader, handle, map->height, map->start_col, cols, merge->inputs.cache, merge->inputs.cache_file[i]))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input buffer in manifest.c: %s", strerror (ENOMEM));
+      input_files_release (&merge->inputs, i);
+      return (NVFalse);
+    }
+
+  for (j = run_end = 0 ; j < map->height ; j++)
+    {
+      if (map->out_y[j] < 0) continue;
+
+
+      /*  Only the rows that land in the output are read.  */
+
+      if (j >= run_end) for (run_end = j + 1 ; run_end < map->height && map->out_y[run_end] >= 0 ; run_end++);
+
+      if ((row = input_reader_row (&reader, j, run_end)) == NULL)
+        {
+          merge_error (merge, MERGE_ERROR_READ, "Error reading row %d of %s for checksum.\nThe error message returned was:%s", j,
+                       merge->inputs.path[i], chrtr2_strerror ());
+          input_reader_close (&reader);
+          input_files_release (&merge->inputs, i);
+          return (NVFalse);
+        }
+
+      band = map->out_y[j] / MANIFEST_BAND_ROWS;
+      hash = manifest->input[i].checksum[band];
+
+      if (merge->file_time != NULL) hash = hash_bytes (hash, &merge->file_time[i], sizeof (int64_t));
+
+
+      /*  Hash the fields one at a time since the record may have padding in it.  */
+
+      for (k = 0 ; k < cols ; k++)
+        {
+          if (map->out_x[map->start_col + k] < 0) continue;
+
+          hash = hash_bytes (hash, &row[k].z, sizeof (row[k].z));
+          hash = hash_bytes (hash, &row[k].status, sizeof (row[k].status));
+          hash = hash_bytes (hash, &row[k].number_of_points, sizeof (row[k].number_of_points));
+          hash = hash_bytes (hash, &row[k].horizontal_uncertainty, sizeof (row[k].horizontal_uncertainty));
+          hash = hash_bytes (hash, &row[k].vertical_uncertainty, sizeof (row[k].vertical_uncertainty));
+          hash = hash_bytes (hash, &row[k].uncertainty, sizeof (row[k].uncertainty));
+        }
+
+      manifest->input[i].checksum[band] = hash;
+    }
+
+  input_reader_close (&reader);
+  input_files_release (&merge->inputs, i);
+
+  return (NVTrue);
+}
+
+
+
+/*  Fill in the checksums of all of the input files.  If old isn't NULL (it has to match manifest) we reuse its checksums for
+    any input file whose size and modification time haven't changed instead of rereading it.  Returns NVFalse (with the
+    error in merge) if we couldn't read an input file.  */
+
+uint8_t manifest_checksum (MANIFEST *manifest, MERGE *merge, MANIFEST *old)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < manifest->file_count ; i++)
+    {
+      if (old != NULL && manifest->input[i].size >= 0 && manifest->input[i].size == old->input[i].size &&
+          manifest->input[i].mtime == old->input[i].mtime)
+        {
+          memcpy (manifest->input[i].checksum, old->input[i].checksum, manifest->band_count * sizeof (uint64_t));
+          continue;
+        }
+
+      fprintf (stderr, "Checksumming input file %d\n", i + 1);
+      fflush (stderr);
+
+      if (!checksum_input (manifest, merge, i)) return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Find the output rows that have to be redone because an input checksum changed.  Each dirty band is grown by halo rows
+    (how far a change in the input can reach in the output), out to whole bands so that every band is either kept or
+    redone (and so is its range), and overlapping ranges are combined.  start_row and end_row have to have room for
+    band_count ranges.  Returns the number of ranges.  */
+
+int32_t manifest_dirty (MANIFEST *manifest, MANIFEST *old, int32_t halo, int32_t *start_row, int32_t *end_row)
+{
+  int32_t            i, k, count = 0, start, end;
+  uint8_t            dirty;
+
+
+  for (k = 0 ; k < manifest->band_count ; k++)
+    {
+      dirty = NVFalse;
+      for (i = 0 ; i < manifest->file_count ; i++)
+        {
+          if (manifest->input[i].checksum[k] != old->input[i].checksum[k])
+            {
+              dirty = NVTrue;
+              break;
+            }
+        }
+
+      if (!dirty) continue;
+
+      start = MAX (k * MANIFEST_BAND_ROWS - halo, 0) / MANIFEST_BAND_ROWS * MANIFEST_BAND_ROWS;
+      end = MIN (((k + 1) * MANIFEST_BAND_ROWS + halo + MANIFEST_BAND_ROWS - 1) / MANIFEST_BAND_ROWS * MANIFEST_BAND_ROWS,
+                 manifest->height);
+
+      if (count && start <= end_row[count - 1])
+        {
+          end_row[count - 1] = end;
+        }
+      else
+        {
+          start_row[count] = start;
+          end_row[count] = end;
+          count++;
+        }
+    }
+
+  return (count);
+}
+
+
+
+/*  Copy the range of every band of old (which has to match manifest) that isn't in one of the range_count ranges of rows
+    that are being redone (from manifest_dirty).  The bands that are redone are left empty for the output writer to fill
+    in.  */
+
+void manifest_keep (MANIFEST *manifest, MANIFEST *old, int32_t range_count, int32_t *start_row, int32_t *end_row)
+{
+  int32_t            i, k;
+
+
+  for (k = 0 ; k < manifest->band_count ; k++)
+    {
+      for (i = 0 ; i < range_count ; i++) if (k * MANIFEST_BAND_ROWS < end_row[i] && (k + 1) * MANIFEST_BAND_ROWS > start_row[i]) break;
+
+      if (i < range_count) continue;
+
+      manifest->min_z[k] = old->min_z[k];
+      manifest->max_z[k] = old->max_z[k];
+    }
+}
+
+
+
+/*  Combine the ranges of all of the bands into min_z and max_z (min_z > max_z if there's no data).  */
+
+void manifest_range (MANIFEST *manifest, float *min_z, float *max_z)
+{
+  int32_t            k;
+
+
+  *min_z = 9999999999.0;
+  *max_z = -9999999999.0;
+
+  for (k = 0 ; k < manifest->band_count ; k++)
+    {
+      *min_z = MIN (*min_z, manifest->min_z[k]);
+      *max_z = MAX (*max_z, manifest->max_z[k]);
+    }
+}
+
+
+
+void manifest_free (MANIFEST *manifest)
+{
+  int32_t            i;
+
+
+  free (manifest->min_z);
+  free (manifest->max_z);
+  manifest->min_z = manifest->max_z = NULL;
+
+  if (manifest->input == NULL) return;
+
+  for (i = 0 ; i < manifest->file_count ; i++)
+    {
+      if (manifest->input[i].path != NULL) free (manifest->input[i].path);
+      if (manifest->input[i].checksum != NULL) free (manifest->input[i].checksum);
+    }
+
+  free (manifest->input);
+  manifest->input = NULL;
+}
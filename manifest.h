@@ -0,0 +1,77 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _MANIFEST_H_
+#define _MANIFEST_H_
+
+#include "merge.h"
+
+
+/*  Number of output rows covered by each checksum in the manifest.  */
+
+#define         MANIFEST_BAND_ROWS 64
+
+
+/*  What we know about one input file's contribution to the output.  checksum[k] is a hash of the input data (and the input
+    geometry) that lands in output rows k * MANIFEST_BAND_ROWS through (k + 1) * MANIFEST_BAND_ROWS - 1.  */
+
+typedef struct
+{
+  char               *path;
+  int64_t            size;            /*  File size and modification time (nanoseconds) so we don't have to reread unchanged files  */
+  int64_t            mtime;
+  uint64_t           *checksum;
+} MANIFEST_INPUT;
+
+
+/*  Sidecar manifest for incremental merges.  It's kept next to the output file and describes everything that went into
+    it.  If the options and the list of input files haven't changed we only have to redo the output rows whose input
+    checksums have.  The range of the output data in each band is kept too so the header's range can be rebuilt from the
+    bands that weren't redone plus the ones that were.  */
+
+typedef struct
+{
+  char               options[1024];   /*  Everything other than the input data that changes the output  */
+  int32_t            width;
+  int32_t            height;
+  int32_t            band_count;
+  int32_t            file_count;
+  MANIFEST_INPUT     *input;
+  float              *min_z;          /*  Range of the output data in each band (min_z > max_z if the band has none)  */
+  float              *max_z;
+} MANIFEST;
+
+
+void manifest_options (MERGE *merge, char *options);
+uint8_t manifest_init (MANIFEST *manifest, MERGE *merge);
+uint8_t manifest_read (MANIFEST *manifest, char *path);
+uint8_t manifest_write (MANIFEST *manifest, char *path);
+uint8_t manifest_match (MANIFEST *manifest, MANIFEST *old);
+uint8_t manifest_checksum (MANIFEST *manifest, MERGE *merge, MANIFEST *old);
+int32_t manifest_dirty (MANIFEST *manifest, MANIFEST *old, int32_t halo, int32_t *start_row, int32_t *end_row);
+void manifest_keep (MANIFEST *manifest, MANIFEST *old, int32_t range_count, int32_t *start_row, int32_t *end_row);
+void manifest_range (MANIFEST *manifest, float *min_z, float *max_z);
+void manifest_free (MANIFEST *manifest);
+
+
+#endif
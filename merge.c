@@ -0,0 +1,789 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdarg.h>
+
+#include "merge.h"
+
+
+/*  MERGE.error is set from whichever thread fails first.  */
+
+static pthread_mutex_t error_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*  Record why the merge failed (printf style message).  Only the first failure is kept since the later ones are usually
+    just fallout from it.  */
+
+void merge_error (MERGE *merge, int32_t error, char *format, ...)
+{
+  va_list            args;
+
+
+  pthread_mutex_lock (&error_mutex);
+
+  if (merge->error == MERGE_OK)
+    {
+      merge->error = error;
+
+      va_start (args, format);
+      vsnprintf (merge->error_message, sizeof (merge->error_message), format, args);
+      va_end (args);
+    }
+
+  pthread_mutex_unlock (&error_mutex);
+}
+
+
+
+/*  Returns NVTrue if anything in the merge has failed.  */
+
+uint8_t merge_failed (MERGE *merge)
+{
+  int32_t            error;
+
+
+  pthread_mutex_lock (&error_mutex);
+  error = merge->error;
+  pthread_mutex_unlock (&error_mutex);
+
+  return (error != MERGE_OK);
+}
+
+
+
+/*  Figure out how many output rows we can process at one time and still stay under mem_limit bytes.  Each tile also has to
+    hold its exclude and regrid halos.  Returns the height of the output grid if there is no limit or everything fits.  The
+    grid tiles are only allocated where there is data but we have to assume that all of them will be.  */
+
+int32_t merge_tile_rows (MERGE *merge, int64_t mem_limit)
+{
+  int64_t            cell_bytes, row_bytes, rows;
+  int32_t            height, halo;
+
+
+  height = merge->output_header.height;
+
+  if (!mem_limit) return (height);
+
+
+  cell_bytes = sizeof (float) + sizeof (uint16_t) + sizeof (GRID_RANK) + sizeof (GRID_EXTRA);
+  if (merge->exclude || (merge->regrid && merge->holes_only)) cell_bytes += sizeof (uint32_t);
+  if (merge->regrid) cell_bytes += MISP_CELL_BYTES;
+
+
+  /*  Decoded input rows held by the reader threads.  */
+
+  if (merge->thread_count > 1) cell_bytes += merge->thread_count * sizeof (CHRTR2_RECORD);
+
+  row_bytes = cell_bytes * (int64_t) merge->output_header.width;
+
+  halo = merge->halo + (merge->regrid ? REGRID_HALO + FILTER : 0);
+
+
+  /*  The output rows waiting to be written are a fixed number of rows no matter how big the tile is.  */
+
+  mem_limit -= WRITE_QUEUE_ROWS * (int64_t) merge->output_header.width * (int64_t) sizeof (CHRTR2_RECORD);
+
+  rows = mem_limit / row_bytes - 2 * halo;
+
+  if (rows < 1)
+    {
+      fprintf (stderr, "\n\nWarning: the memory limit is too small to hold the tile halos, using one row per tile.\n\n");
+      fflush (stderr);
+      rows = 1;
+    }
+
+  return ((int32_t) MIN (rows, (int64_t) height));
+}
+
+
+
+/*  The insert kernels have to be inlined into each case of insert_row for the policy to be a constant in them.  */
+
+#ifdef __GNUC__
+#define         INSERT_KERNEL static inline __attribute__ ((always_inline))
+#else
+#define         INSERT_KERNEL static inline
+#endif
+
+
+
+/*  Insert count records from input file number rank (starting at 1) into grid row y starting at column x under policy.  The
+    span is split at the tile edges so each tile is only looked up once and the tests run straight down its planes.  This is
+    only called with a constant policy so each policy gets its own loop with none of the other policies' tests in it.  */
+
+INSERT_KERNEL void insert_span (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *exclude_map, int32_t policy, int32_t y, int32_t x,
+                                int32_t count, CHRTR2_RECORD *record, GRID_RANK rank, int32_t buffer_x, int32_t buffer_y)
+{
+  int32_t            j, end, offset;
+  size_t             number;
+  uint8_t            replace;
+  GRID_TILE          *tile;
+
+
+  for ( ; count > 0 ; x += end, record += end, count -= end)
+    {
+      end = MIN (count, GRID_TILE_SIZE - (x & GRID_TILE_MASK));
+
+      number = merge_grid_tile_number (grid, y, x);
+      offset = merge_grid_offset (y, x);
+      tile = grid->tile[number];
+
+      for (j = 0 ; j < end ; j++)
+        {
+          /*  For the first file we just slap the data into the grid.  */
+
+          if (rank == 1 && (policy == MERGE_POLICY_FIRST || policy == MERGE_POLICY_EXCLUDE))
+            {
+              replace = NVTrue;
+            }
+
+
+          /*  If we're using the exclude option we only insert real, hand-drawn/digitized, or land masked data and only if no
+              bins in the buffer have hard data from the higher precedence files.  */
+
+          else if (policy == MERGE_POLICY_EXCLUDE)
+            {
+              replace = ((record[j].status & HARD_DATA) && !exclude_map_hit (exclude_map, x + j, y, buffer_x, buffer_y));
+            }
+
+
+          /*  Otherwise the policy decides.  By default we only load data where there is no data (i.e. NULL).  This is
+              actually more of an insert than a merge but this is what we need.  */
+
+          else
+            {
+              replace = merge_policy_replaces (policy, &record[j], rank, tile->z[offset + j], tile->status[offset + j],
+                                               (grid->extra[number] != NULL) ? grid->extra[number][offset + j].uncertainty : 0.0,
+                                               tile->rank[offset + j], merge->file_time);
+            }
+
+          if (!replace) continue;
+
+
+          /*  An empty input cell doesn't change an empty tile (nothing reads the Z or rank of a cell with no status) so we
+              don't allocate a tile for the holes in the input.  */
+
+          if (tile == &merge_grid_null_tile)
+            {
+              if (!record[j].status) continue;
+
+              if ((tile = merge_grid_new_tile (grid, number)) == NULL) return;
+            }
+
+          merge_grid_store (grid, number, offset + j, &record[j], rank);
+        }
+    }
+}
+
+
+
+/*  Insert row j of input file number file into the grid under policy.  input_row is indexed by input column (only
+    map->start_col through map->end_col - 1 are valid).  */
+
+INSERT_KERNEL void insert_policy_row (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *exclude_map, int32_t policy, int32_t file, int32_t j,
+                                      CHRTR2_RECORD *input_row)
+{
+  int32_t            k, x, y, buffer_x, buffer_y;
+  INPUT_MAP          *map;
+
+
+  map = &merge->input_map[file];
+  buffer_x = merge->buffer_x[file];
+  buffer_y = merge->buffer_y[file];
+
+  y = map->out_y[j] - grid->start_row;
+
+
+  /*  If the input is aligned with the output grid the row is just a span of the output row.  */
+
+  if (map->aligned)
+    {
+      insert_span (merge, grid, exclude_map, policy, y, map->start_col + map->offset_x, map->end_col - map->start_col,
+                   &input_row[map->start_col], file + 1, buffer_x, buffer_y);
+    }
+  else
+    {
+      for (k = map->start_col ; k < map->end_col ; k++)
+        {
+          x = map->out_x[k];
+
+          if (x >= 0) insert_span (merge, grid, exclude_map, policy, y, x, 1, &input_row[k], file + 1, buffer_x, buffer_y);
+        }
+    }
+}
+
+
+
+/*  Insert row j of input file number file into the grid.  The policy is picked here, once per row, so that each policy's
+    kernel is compiled with the policy as a constant.  */
+
+static void insert_row (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *exclude_map, int32_t file, int32_t j, CHRTR2_RECORD *input_row)
+{
+  switch (merge->policy)
+    {
+    case MERGE_POLICY_FIRST:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_FIRST, file, j, input_row);
+      break;
+
+    case MERGE_POLICY_EXCLUDE:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_EXCLUDE, file, j, input_row);
+      break;
+
+    case MERGE_POLICY_SHOALEST:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_SHOALEST, file, j, input_row);
+      break;
+
+    case MERGE_POLICY_UNCERTAINTY:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_UNCERTAINTY, file, j, input_row);
+      break;
+
+    case MERGE_POLICY_NEWEST:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_NEWEST, file, j, input_row);
+      break;
+
+    case MERGE_POLICY_STATUS:
+      insert_policy_row (merge, grid, exclude_map, MERGE_POLICY_STATUS, file, j, input_row);
+      break;
+    }
+}
+
+
+
+/*  Returns NVTrue if input row j (which has to land in the grid) of the file mapped by map lands on fully covered output.  */
+
+static inline uint8_t row_covered (COVERAGE_MAP *coverage, MERGE_GRID *grid, INPUT_MAP *map, int32_t j)
+{
+  return (coverage_map_full (coverage, map->out_y[j] - grid->start_row, map->out_start_x, map->out_end_x));
+}
+
+
+
+/*  Returns the first input row after row j (up to end_row) that doesn't land in the grid or lands on fully covered output.
+    Rows j up to there are all read, so that's as far as a read block of the file can go.  */
+
+static int32_t read_end (COVERAGE_MAP *coverage, MERGE_GRID *grid, INPUT_MAP *map, int32_t j, int32_t end_row)
+{
+  for (j++ ; j < end_row && map->out_y[j] >= 0 && !row_covered (coverage, grid, map, j) ; j++);
+
+  return (j);
+}
+
+
+
+/*  Rebuild the exclude map for input file number file.  The file's exclude buffer boxes can only reach the part of the
+    grid that the file lands in grown by its buffer so that's all that we build.  Returns the number of cells in it.  */
+
+static int64_t build_exclude_map (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *exclude_map, int32_t file)
+{
+  int32_t            j, y, start_x, end_x, start_y, end_y;
+  INPUT_MAP          *map;
+
+
+  map = &merge->input_map[file];
+
+  start_y = grid->rows;
+  end_y = 0;
+
+  for (j = 0 ; j < map->height ; j++)
+    {
+      y = map->out_y[j] - grid->start_row;
+
+      if (map->out_y[j] >= 0 && y >= 0 && y < grid->rows)
+        {
+          start_y = MIN (start_y, y);
+          end_y = MAX (end_y, y + 1);
+        }
+    }
+
+
+  /*  Nothing from the file lands in the grid so there won't be any exclude tests.  */
+
+  if (start_y >= end_y || map->out_start_x >= map->out_end_x) return (0);
+
+  start_x = MAX (map->out_start_x - merge->buffer_x[file], 0);
+  end_x = MIN (map->out_end_x + merge->buffer_x[file], grid->width);
+  start_y = MAX (start_y - merge->buffer_y[file], 0);
+  end_y = MIN (end_y + merge->buffer_y[file], grid->rows);
+
+  exclude_map_build (exclude_map, grid, start_x, start_y, end_x, end_y);
+
+  return ((int64_t) (end_x - start_x) * (int64_t) (end_y - start_y));
+}
+
+
+
+/*  Insert the count input files in list (in precedence order) into the grid.  The files are read here or, if decoder
+    isn't NULL, by its threads, and they're always inserted one at a time in precedence order.  Input rows that land on
+    output that the higher precedence files have already covered can't change anything so we don't read them, and we
+    don't open a file at all if all of its rows are covered.  Returns NVFalse (with the error in merge) if anything
+    failed.  */
+
+static uint8_t insert_files (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *exclude_map, COVERAGE_MAP *coverage, int32_t *list,
+                             int32_t count, INPUT_DECODER *decoder)
+{
+  int32_t            i, j, n, y, first_row, end_row, run_end, handle, percent = 0, old_percent = -1;
+  int64_t            cells;
+  uint8_t            reading = NVFalse, ok = NVTrue;
+  INPUT_MAP          *map;
+  DECODED_INPUT      *decoded = NULL;
+  INPUT_READER       reader;
+  CHRTR2_RECORD      *input_row;
+  STATS_TIMER        timer;
+
+
+  for (n = 0 ; n < count && ok ; n++)
+    {
+      i = list[n];
+      map = &merge->input_map[i];
+
+
+      /*  Snapshot the hard data from the higher precedence files for the exclude buffer test.  */
+
+      if (merge->exclude && i)
+        {
+          stats_start (merge->stats, &timer);
+          cells = build_exclude_map (merge, grid, exclude_map, i);
+          stats_stop (merge->stats, &timer, STATS_EXCLUDE, -1, cells, 0);
+        }
+
+
+      if (decoder != NULL)
+        {
+          decoded = input_decoder_wait (decoder, n);
+
+          if (decoded->status == DECODE_FAILED)
+            {
+              if (decoded->failed_row == -1)
+                {
+                  merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input decoder buffers in merge.c: %s", strerror (ENOMEM));
+                }
+              else if (decoded->failed_row == -2)
+                {
+                  merge_error (merge, MERGE_ERROR_OPEN, "Error opening %s.\nThe error message returned was:%s", merge->inputs.path[i],
+                               chrtr2_strerror ());
+                }
+              else
+                {
+                  merge_error (merge, MERGE_ERROR_READ, "Error reading row %d of %s.\nThe error message returned was:%s",
+                               decoded->failed_row, merge->inputs.path[i], chrtr2_strerror ());
+                }
+
+              ok = NVFalse;
+              break;
+            }
+
+          first_row = decoded->first_row;
+          end_row = decoded->end_row;
+          merge->inputs.rows_skipped[i] += decoded->rows_skipped;
+        }
+      else
+        {
+          input_map_rows (map, grid->start_row, grid->start_row + grid->rows, &first_row, &end_row);
+
+
+          /*  Don't open the file if everything that it lands on is already covered.  */
+
+          for (j = first_row ; j < end_row && (map->out_y[j] < 0 || row_covered (coverage, grid, map, j)) ; j++);
+
+          reading = (map->start_col < map->end_col && j < end_row);
+
+
+          /*  Only read the columns that land in the output grid (it damn well should be all of them).  */
+
+          if (reading)
+            {
+              if ((handle = input_files_open (&merge->inputs, i)) < 0)
+                {
+                  merge_error (merge, MERGE_ERROR_OPEN, "Error opening %s.\nThe error message returned was:%s", merge->inputs.path[i],
+                               chrtr2_strerror ());
+                  ok = NVFalse;
+                  break;
+                }
+
+              if (!input_reader_open (&reader, handle, merge->inputs.header[i].height, map->start_col, map->end_col - map->start_col,
+                                      merge->inputs.cache, merge->inputs.cache_file[i]))
+                {
+                  merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input reader buffer in merge.c: %s", strerror (ENOMEM));
+                  input_files_release (&merge->inputs, i);
+                  ok = NVFalse;
+                  break;
+                }
+            }
+        }
+
+
+      /*  Loop for the input rows that land in the grid.  The coverage doesn't change until the whole file is in so the rows
+          up to run_end are known to be uncovered.  Covered rows that the decoder threads read anyway (the coverage grew
+          after they got to them) were read so they aren't counted as skipped.  */
+
+      for (j = first_row, run_end = first_row ; j < end_row && map->start_col < map->end_col ; j++)
+        {
+          if (j >= run_end && map->out_y[j] >= 0 && row_covered (coverage, grid, map, j))
+            {
+              if (decoder == NULL) merge->inputs.rows_skipped[i]++;
+            }
+          else if (map->out_y[j] >= 0)
+            {
+              /*  Get the row of input records.  Note that input_row[0] is input column start_col.  */
+
+              if (decoder != NULL)
+                {
+                  input_row = &decoded->records[(size_t) (j - first_row) * (size_t) decoded->cols];
+                }
+              else
+                {
+                  stats_start (merge->stats, &timer);
+
+                  if (j >= run_end) run_end = read_end (coverage, grid, map, j, end_row);
+
+                  input_row = input_reader_row (&reader, j, run_end);
+                  if (input_row == NULL)
+                    {
+                      merge_error (merge, MERGE_ERROR_READ, "Error reading row %d of %s.\nThe error message returned was:%s", j,
+                                   merge->inputs.path[i], chrtr2_strerror ());
+                      ok = NVFalse;
+                      break;
+                    }
+
+                  stats_stop (merge->stats, &timer, STATS_READ, i, map->end_col - map->start_col,
+                              (map->end_col - map->start_col) * sizeof (CHRTR2_RECORD));
+                }
+
+              stats_start (merge->stats, &timer);
+
+              insert_row (merge, grid, exclude_map, i, j, input_row - map->start_col);
+
+              stats_stop (merge->stats, &timer, STATS_INSERT, -1, map->end_col - map->start_col, 0);
+
+
+              /*  The grid couldn't allocate a tile (or an extra plane) so some of the row didn't go in.  */
+
+              if (grid->failed)
+                {
+                  merge_error (merge, MERGE_ERROR_MEMORY, "Allocating grid tiles in merge_grid.c: %s", strerror (ENOMEM));
+                  ok = NVFalse;
+                  break;
+                }
+
+              merge->inputs.rows_read[i]++;
+            }
+
+
+          percent = NINT (((float) (j - first_row) / (float) (end_row - first_row)) * 100.0);
+          if (!merge->quiet && percent != old_percent)
+            {
+              fprintf (stderr, "Reading CHRTR2 file %d of %d - %03d%% complete\r", i + 1, merge->file_count, percent);
+              fflush (stderr);
+              old_percent = percent;
+            }
+        }
+
+
+      /*  Now that the whole file is in we can update the coverage of the rows that it landed on.  This can't be done as we
+          go because, in exclude mode, a later row of the same file can still replace an earlier one.  */
+
+      if (ok && map->start_col < map->end_col)
+        {
+          for (j = first_row, y = -1 ; j < end_row ; j++)
+            {
+              if (map->out_y[j] >= 0 && map->out_y[j] != y)
+                {
+                  y = map->out_y[j];
+                  coverage_map_update (coverage, grid, y - grid->start_row, map->out_start_x, map->out_end_x);
+                }
+            }
+        }
+
+
+      if (decoder != NULL)
+        {
+          input_decoder_release (decoder, n);
+        }
+      else
+        {
+          if (reading)
+            {
+              input_reader_close (&reader);
+              input_files_release (&merge->inputs, i);
+            }
+        }
+    }
+
+  return (ok);
+}
+
+
+
+/*  Set up the reading of the input files that land in output rows start_row through start_row + rows - 1.  If
+    thread_count is more than 0 that many decoder threads start reading the files right away, even though the grid that
+    they're going into may still be in use.  Returns NVFalse (with the error in merge and nothing left set up) if it
+    failed.  */
+
+uint8_t merge_read_start (MERGE *merge, MERGE_READ *read, int32_t start_row, int32_t rows, int32_t thread_count)
+{
+  memset (read, 0, sizeof (MERGE_READ));
+
+  read->start_row = start_row;
+  read->rows = rows;
+
+
+  /*  Only the cells that the policy can't replace block the lower precedence files.  */
+
+  if (!coverage_map_alloc (&read->coverage, merge->output_header.width, rows, merge_policy_coverage (merge->policy)))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating coverage map in merge.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+
+  /*  Find the files that overlap the rows.  */
+
+  if ((read->list = (int32_t *) malloc (merge->file_count * sizeof (int32_t))) == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input file list in merge.c: %s", strerror (errno));
+      coverage_map_free (&read->coverage);
+      return (NVFalse);
+    }
+
+  read->count = input_files_query (&merge->inputs, start_row, start_row + rows, read->list);
+
+
+  /*  Start the workers that read the input files in the background.  */
+
+  if (thread_count > 0)
+    {
+      if (!input_decoder_start (&read->decoder, &merge->inputs, merge->input_map, &read->coverage, merge->stats, read->list,
+                                read->count, start_row, start_row + rows, thread_count))
+        {
+          merge_error (merge, MERGE_ERROR_THREAD, "Starting input decoder threads in merge.c: %s", strerror (errno));
+          free (read->list);
+          read->list = NULL;
+          coverage_map_free (&read->coverage);
+          return (NVFalse);
+        }
+
+      read->decoding = NVTrue;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Stop the decoder threads (if they were started) and free everything in read.  */
+
+void merge_read_free (MERGE_READ *read)
+{
+  if (read->list == NULL) return;
+
+  if (read->decoding) input_decoder_finish (&read->decoder);
+  read->decoding = NVFalse;
+
+  free (read->list);
+  read->list = NULL;
+
+  coverage_map_free (&read->coverage);
+}
+
+
+
+/*  Fill the grid (which has to be reset to read's rows) from read and free read.  Returns NVFalse (with the error in merge)
+    if anything failed.  */
+
+uint8_t merge_insert_read (MERGE *merge, MERGE_GRID *grid, MERGE_READ *read)
+{
+  uint8_t            ok;
+  EXCLUDE_MAP        exclude_map;
+
+
+  memset (&exclude_map, 0, sizeof (EXCLUDE_MAP));
+
+  if (merge->exclude && !exclude_map_alloc (&exclude_map, grid->width, grid->rows))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating exclude_map in merge.c: %s", strerror (errno));
+      merge_read_free (read);
+      return (NVFalse);
+    }
+
+  ok = insert_files (merge, grid, &exclude_map, &read->coverage, read->list, read->count, read->decoding ? &read->decoder : NULL);
+
+  merge_read_free (read);
+
+  exclude_map_free (&exclude_map);
+
+  if (ok && !merge->quiet)
+    {
+      fprintf (stderr, "                                                                   \r");
+      fprintf (stderr, "\nData read complete\n\n");
+      fflush (stderr);
+    }
+
+  return (ok);
+}
+
+
+
+/*  Read the input CHRTR2 files that overlap the grid and fill the grid.  Only the input rows that land in the grid's output
+    rows are read (see insert_files).  With more than one thread the files are read by decoder threads.  Returns NVFalse
+    (with the error in merge) if anything failed.  */
+
+uint8_t merge_insert (MERGE *merge, MERGE_GRID *grid)
+{
+  MERGE_READ         read;
+
+
+  if (!merge_read_start (merge, &read, grid->start_row, grid->rows, merge->thread_count > 1 ? merge->thread_count : 0))
+    return (NVFalse);
+
+  return (merge_insert_read (merge, grid, &read));
+}
+
+
+
+/*  Tell the user about the input files (or parts of them) that were completely covered by higher precedence files and
+    never read.  */
+
+void merge_coverage_report (MERGE *merge)
+{
+  int32_t            i;
+  int64_t            read = 0, skipped = 0;
+
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      read += merge->inputs.rows_read[i];
+      skipped += merge->inputs.rows_skipped[i];
+
+      if (!merge->inputs.rows_read[i] && merge->inputs.rows_skipped[i])
+        fprintf (stderr, "Input file %d (%s) is completely covered by higher precedence files and was never read\n", i + 1,
+                 merge->inputs.path[i]);
+    }
+
+  if (skipped)
+    {
+      fprintf (stderr, "Skipped %lld of %lld input rows that landed on fully covered output\n\n", (long long) skipped,
+               (long long) (read + skipped));
+      fflush (stderr);
+    }
+}
+
+
+
+/*  Write output rows write_start through write_end - 1 to the output file without regridding.  Only the runs of cells that
+    have data are written.  Tiles that never got any data are skipped as a whole.  */
+
+void merge_write (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end)
+{
+  int32_t            i, j, row, end, offset, run_start, percent = 0, old_percent = -1;
+  size_t             number = 0;
+  GRID_TILE          *tile = NULL;
+  CHRTR2_RECORD      *records;
+  GRID_RANK          *rank;
+
+
+  for (i = write_start ; i < write_end ; i++)
+    {
+      records = output_writer_next (&merge->writer);
+      rank = output_writer_rank (&merge->writer);
+      run_start = -1;
+      row = i - grid->start_row;
+
+      for (j = 0 ; j < grid->width ; j++)
+        {
+          if (!(j & GRID_TILE_MASK))
+            {
+              number = merge_grid_tile_number (grid, row, j);
+              tile = grid->tile[number];
+
+
+              /*  Nothing in this part of the row.  */
+
+              if (tile == &merge_grid_null_tile)
+                {
+                  end = MIN (j + GRID_TILE_SIZE, grid->width);
+
+                  if (merge->update)
+                    {
+                      memset (&records[j], 0, (end - j) * sizeof (CHRTR2_RECORD));
+                      if (run_start < 0) run_start = j;
+                    }
+                  else if (run_start >= 0)
+                    {
+                      output_writer_run (&merge->writer, run_start, j);
+                      run_start = -1;
+                    }
+
+                  j = end - 1;
+                  continue;
+                }
+            }
+
+          offset = merge_grid_offset (row, j);
+
+          if (tile->status[offset])
+            {
+              merge_grid_get (grid, number, offset, &records[j]);
+              if (rank != NULL) rank[j] = tile->rank[offset];
+              if (run_start < 0) run_start = j;
+            }
+
+
+          /*  If we're updating an existing output file we have to clear cells that no longer have any data (the same as a
+              newly created file).  */
+
+          else if (merge->update)
+            {
+              memset (&records[j], 0, sizeof (CHRTR2_RECORD));
+              if (run_start < 0) run_start = j;
+            }
+
+          else if (run_start >= 0)
+            {
+              output_writer_run (&merge->writer, run_start, j);
+              run_start = -1;
+            }
+        }
+
+      if (run_start >= 0) output_writer_run (&merge->writer, run_start, grid->width);
+
+      output_writer_queue (&merge->writer, i);
+
+      percent = NINT (((float) (i - write_start) / (float) (write_end - write_start)) * 100.0);
+      if (!merge->quiet && percent != old_percent)
+        {
+          fprintf (stderr, "Writing chrtr2 data - %03d%% complete\r", percent);
+          fflush (stderr);
+          old_percent = percent;
+        }
+    }
+
+
+  if (!merge->quiet)
+    {
+      fprintf (stderr, "                                                                   \r");
+      fprintf (stderr, "\nFile writing complete\n\n");
+      fflush (stderr);
+    }
+}
@@ -0,0 +1,142 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _MERGE_H_
+#define _MERGE_H_
+
+#include "chrtr2_merge.h"
+#include "area.h"
+#include "coverage_map.h"
+#include "exclude_map.h"
+#include "input_decoder.h"
+#include "input_files.h"
+#include "input_map.h"
+#include "input_reader.h"
+#include "merge_grid.h"
+#include "merge_policy.h"
+#include "output_writer.h"
+#include "stats.h"
+
+
+/*  MISP search radius (in grid cells) that we pass to misp_init.  */
+
+#define         MISP_SEARCH_RADIUS 20
+
+
+/*  Number of rows that we regrid above and below each tile so that the interior of the tile sees the same control points
+    that it would if we regridded the whole area at once.  */
+
+#define         REGRID_HALO (FILTER + MISP_SEARCH_RADIUS)
+
+
+/*  Rough number of bytes per grid cell that MISP allocates internally.  Only used to size the tiles for --mem-limit.  */
+
+#define         MISP_CELL_BYTES 16
+
+
+/*  Why a merge failed (MERGE.error, and what merge_context_run returns).  */
+
+#define         MERGE_OK 0
+#define         MERGE_ERROR_ARGUMENT 1        /*  Options or input files that can't be merged  */
+#define         MERGE_ERROR_MEMORY 2
+#define         MERGE_ERROR_OPEN 3            /*  A file couldn't be opened or created  */
+#define         MERGE_ERROR_READ 4
+#define         MERGE_ERROR_WRITE 5
+#define         MERGE_ERROR_THREAD 6          /*  A thread or regrid worker process couldn't be started or failed  */
+#define         MERGE_ERROR_VERIFY 7          /*  --verify found cells that didn't match the reference merge  */
+
+
+/*  Called each time a tile of output rows has been merged (and regridded) and handed to the output writer with the number
+    of output rows done so far and the number that the merge will do in all.  It's called from whichever thread finished
+    the tile.  */
+
+typedef void (*MERGE_PROGRESS) (void *data, int32_t done_rows, int32_t total_rows);
+
+
+/*  Everything about the merge that doesn't change from tile to tile.  The input arrays have file_count entries.  */
+
+typedef struct
+{
+  int32_t            file_count;
+  INPUT_FILES        inputs;          /*  Input file names, headers, and (lazily opened) handles  */
+  INPUT_MAP          *input_map;
+  int32_t            *buffer_x;       /*  Exclude buffer (in output cells) for each input file  */
+  int32_t            *buffer_y;
+  int32_t            output_handle;   /*  With --area this is a scratch file that only defines the merge grid  */
+  CHRTR2_HEADER      output_header;   /*  The merge grid  */
+  AREA               *area;           /*  Part of the merge grid that goes in the output file (NULL unless --area)  */
+  OUTPUT_WRITER      writer;          /*  All output rows go through the writer thread  */
+  uint8_t            exclude;
+  int32_t            policy;          /*  MERGE_POLICY_ (MERGE_POLICY_EXCLUDE if exclude is set)  */
+  int64_t            *file_time;      /*  Modification time of each input file (only for MERGE_POLICY_NEWEST)  */
+  uint8_t            regrid;
+  uint8_t            holes_only;      /*  Only regrid the areas around holes (--holes-only)  */
+  uint8_t            dateline;
+  uint8_t            update;          /*  Updating an existing output file in place (--incremental)  */
+  uint8_t            quiet;           /*  Don't print progress (the --pipeline stages run at the same time)  */
+  MERGE_STATS        *stats;          /*  NULL unless --stats-json was used  */
+  int32_t            verify;          /*  Check every verify'th band against the reference merge (0 for no --verify)  */
+  int32_t            verify_bands;    /*  Bands that were checked  */
+  int64_t            verify_cells;    /*  Cells that were checked  */
+  int64_t            verify_diffs;    /*  Cells that didn't match the reference merge  */
+  int32_t            thread_count;    /*  Threads that read the input files (--threads)  */
+  int32_t            regrid_workers;  /*  MISP processes for the banded regrid (--regrid-workers, 1 for a single pass)  */
+  int32_t            halo;            /*  Rows around a tile that have to be merged for the exclude buffers to be right  */
+  uint8_t            checkpoint;      /*  Mark a checkpoint in the output writer after each tile (--checkpoint)  */
+  MERGE_PROGRESS     progress;        /*  NULL for no progress calls  */
+  void               *progress_data;
+  int32_t            done_rows;       /*  Output rows finished so far  */
+  int32_t            total_rows;      /*  Output rows in all of the tiles  */
+  int32_t            error;           /*  MERGE_ERROR_ code of the first failure (MERGE_OK if nothing has failed)  */
+  char               error_message[512];
+} MERGE;
+
+
+/*  The reading of the input files for one grid of output rows.  With decoder threads the reads can be started (see
+    merge_read_start) before the grid is free so they overlap whatever the grid is still being used for.  The decoder
+    threads only get max_in_flight files ahead of the insert so the read ahead is bounded.  */
+
+typedef struct
+{
+  int32_t            start_row;       /*  Output rows being read  */
+  int32_t            rows;
+  int32_t            *list;           /*  Files that land in the rows in precedence order (NULL if nothing is set up)  */
+  int32_t            count;
+  COVERAGE_MAP       coverage;        /*  Coverage of the rows (input rows that land on covered output aren't read)  */
+  INPUT_DECODER      decoder;
+  uint8_t            decoding;        /*  The decoder threads were started  */
+} MERGE_READ;
+
+
+void merge_error (MERGE *merge, int32_t error, char *format, ...);
+uint8_t merge_failed (MERGE *merge);
+int32_t merge_tile_rows (MERGE *merge, int64_t mem_limit);
+uint8_t merge_read_start (MERGE *merge, MERGE_READ *read, int32_t start_row, int32_t rows, int32_t thread_count);
+void merge_read_free (MERGE_READ *read);
+uint8_t merge_insert_read (MERGE *merge, MERGE_GRID *grid, MERGE_READ *read);
+uint8_t merge_insert (MERGE *merge, MERGE_GRID *grid);
+void merge_coverage_report (MERGE *merge);
+void merge_write (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end);
+
+
+#endif
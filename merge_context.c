@@ -0,0 +1,1219 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <stdarg.h>
+#include <sys/stat.h>
+
+#include "merge_context.h"
+#include "regrid.h"
+#include "manifest.h"
+#include "pipeline.h"
+#include "verify.h"
+#include "checkpoint.h"
+#include "chrtr2_handles.h"
+
+
+/*  Exclude buffer (in output grid cells) when none was given.  */
+
+static float         default_buffer_size = 4.0;
+static uint8_t       default_buffer_meters = NVFalse;
+
+
+
+/*  Set up an empty merge with the default options (regrid, one thread, one regrid process, no memory limit).  */
+
+void merge_context_init (MERGE_CONTEXT *context)
+{
+  memset (context, 0, sizeof (MERGE_CONTEXT));
+
+  context->merge.regrid = NVTrue;
+  context->merge.thread_count = 1;
+  context->merge.regrid_workers = 1;
+  context->max_open = MAX_OPEN_INPUTS;
+}
+
+
+
+/*  Set the error in context (printf style message) for the merge_context_ functions that fail before the merge starts.  */
+
+static void context_error (MERGE_CONTEXT *context, int32_t error, char *format, ...)
+{
+  va_list            args;
+
+
+  context->error = error;
+
+  va_start (args, format);
+  vsnprintf (context->error_message, sizeof (context->error_message), format, args);
+  va_end (args);
+}
+
+
+
+/*  Add an input file (in precedence order).  The name is copied.  Returns NVFalse (with the error in context) if there
+    are already MAX_INPUT_FILES input files (the source of each cell is kept as a 16 bit file number), the name is too
+    long, or we couldn't allocate memory.  */
+
+uint8_t merge_context_add_file (MERGE_CONTEXT *context, char *path)
+{
+  char               **paths;
+  int32_t            *handles;
+  CHRTR2_HEADER      *headers;
+
+
+  if (context->path_count >= MAX_INPUT_FILES)
+    {
+      context_error (context, MERGE_ERROR_ARGUMENT, "Too many input files, the limit is %d", MAX_INPUT_FILES);
+      return (NVFalse);
+    }
+
+  if (strlen (path) >= sizeof (context->output_file))
+    {
+      context_error (context, MERGE_ERROR_ARGUMENT, "Input file name is too long : %s", path);
+      return (NVFalse);
+    }
+
+
+  /*  The arrays that did grow stay grown so the context is still good if one of them couldn't.  */
+
+  if ((paths = (char **) realloc (context->path, (context->path_count + 1) * sizeof (char *))) != NULL) context->path = paths;
+  if ((handles = (int32_t *) realloc (context->handle, (context->path_count + 1) * sizeof (int32_t))) != NULL) context->handle = handles;
+  if ((headers = (CHRTR2_HEADER *) realloc (context->header, (context->path_count + 1) * sizeof (CHRTR2_HEADER))) != NULL)
+    context->header = headers;
+
+  if (paths == NULL || handles == NULL || headers == NULL || (context->path[context->path_count] = strdup (path)) == NULL)
+    {
+      context_error (context, MERGE_ERROR_MEMORY, "Allocating input files in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  context->handle[context->path_count] = -1;
+
+  context->path_count++;
+  context->merge.file_count = context->path_count;
+
+  return (NVTrue);
+}
+
+
+
+/*  Add an input file (in precedence order) that the caller already has open.  handle and header are what chrtr2_open_file
+    gave the caller and path is the name it was opened with (for messages, the manifest, and the checkpoint).  The merge
+    only reads from the handle and doesn't close it.  Returns NVFalse (with the error in context) if we couldn't add it
+    (see merge_context_add_file).  */
+
+uint8_t merge_context_add_handle (MERGE_CONTEXT *context, char *path, int32_t handle, CHRTR2_HEADER *header)
+{
+  if (!merge_context_add_file (context, path)) return (NVFalse);
+
+  context->handle[context->path_count - 1] = handle;
+  context->header[context->path_count - 1] = *header;
+
+  return (NVTrue);
+}
+
+
+
+/*  Only merge the area in string (see area_parse).  Returns NVFalse (with the error in context) if the area couldn't be
+    read.  */
+
+uint8_t merge_context_area (MERGE_CONTEXT *context, char *string)
+{
+  if (!area_parse (&context->area, string))
+    {
+      context_error (context, MERGE_ERROR_ARGUMENT, "Unable to read the area %s (an empty MBR or fewer than 3 polygon points?)", string);
+      return (NVFalse);
+    }
+
+  context->merge.area = &context->area;
+
+  return (NVTrue);
+}
+
+
+
+/*  Call progress with data each time a tile of output rows is finished.  */
+
+void merge_context_progress (MERGE_CONTEXT *context, MERGE_PROGRESS progress, void *data)
+{
+  context->progress = progress;
+  context->progress_data = data;
+}
+
+
+
+/*  Put the name of the file that the merge in context writes (512 characters) in output_file.  With no output file set it's
+    the first input file's name with __merged.ch2 in place of its .ch2.  Returns NVFalse if the name wouldn't fit (or there
+    are no input files to name it after).  */
+
+uint8_t merge_context_output_file (MERGE_CONTEXT *context, char *output_file)
+{
+  size_t             length;
+
+
+  length = strlen (context->output_file);
+
+  if (length < 3)
+    {
+      if (!context->path_count) return (NVFalse);
+
+      length = strlen (context->path[0]);
+      length -= MIN (length, 4);
+
+      if (length + strlen ("__merged.ch2") >= sizeof (context->output_file)) return (NVFalse);
+
+      strcpy (output_file, context->path[0]);
+      strcpy (&output_file[length], "__merged.ch2");
+    }
+  else
+    {
+      strcpy (output_file, context->output_file);
+
+
+      /*  Make sure the .ch2 extension was included if the output file was specified on the command line.  */
+
+      if (length < 4 || strcmp (&output_file[length - 4], ".ch2"))
+        {
+          if (length + 4 >= sizeof (context->output_file)) return (NVFalse);
+
+          strcat (output_file, ".ch2");
+        }
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Called by the output writer thread when all of the output rows before done_row are on the disk.  */
+
+static void save_checkpoint (void *data, int32_t done_row, float min_z, float max_z)
+{
+  CHECKPOINT         *checkpoint = (CHECKPOINT *) data;
+
+
+  checkpoint->done_row = done_row;
+  checkpoint->min_z = min_z;
+  checkpoint->max_z = max_z;
+
+  if (!checkpoint_write (checkpoint))
+    {
+      fprintf (stderr, "\n\nWarning: unable to write the checkpoint file %s\n", checkpoint->path);
+      perror ("    ");
+    }
+}
+
+
+
+/*  Everything that merge_context_run sets up that has to be cleaned up whether the merge finishes or fails part way
+    through.  free_run closes (or frees) whatever is still open when the merge is over.  */
+
+typedef struct
+{
+  MERGE              merge;
+  MERGE_GRID         *grid;
+  MERGE_GRID         own_grid[2];
+  MERGE_STATS        stats;
+  MANIFEST           manifest;
+  MANIFEST           old_manifest;
+  CHECKPOINT         checkpoint;
+  RASTER_OUTPUT      raster[MAX_RASTER_OUTPUTS];
+  int32_t            raster_count;    /*  Raster outputs that were opened  */
+  int32_t            rasters_closed;  /*  The first rasters_closed of them have been closed  */
+  PYRAMID            pyramid;
+  OUTPUT_SUMMARY     summary;
+  MERGE_TILE         *tiles;
+  int32_t            *range_start;
+  int32_t            *range_end;
+  int32_t            file_handle;     /*  Output file (or in-memory grid file), -1 if it isn't open  */
+  int32_t            write_handle;    /*  Output writer's own handle of the output file until the writer starts (or -1)  */
+  int32_t            scratch_handle;  /*  --area scratch file (or -1)  */
+  char               grid_file[1024]; /*  Scratch files to remove (empty if there aren't any)  */
+  char               scratch_file[1024];
+  uint8_t            inputs_open;
+  uint8_t            writer_started;
+  uint8_t            pyramid_open;
+  uint8_t            summary_open;
+} MERGE_RUN;
+
+
+
+/*  The output writer has finished.  Its handle changes at each checkpoint so, if it had one of its own, we're done with
+    whichever one it has now.  Otherwise it's the output file's handle now.  */
+
+static void writer_done (MERGE_RUN *run)
+{
+  if (run->merge.area != NULL)
+    {
+      run->file_handle = run->merge.writer.handle;
+    }
+  else if (run->merge.writer.handle != run->file_handle && run->merge.writer.handle >= 0)
+    {
+      chrtr2_handles_close (run->merge.writer.handle);
+    }
+
+  run->write_handle = -1;
+  run->writer_started = NVFalse;
+}
+
+
+
+/*  Close and free everything in run that is still open.  Anything but the input files, the stats, the manifests, the
+    checkpoint, and the grids is only still open if the merge failed.  The output file is left the way the failure left it
+    (and so is the checkpoint file for a --resume).  */
+
+static void free_run (MERGE_RUN *run)
+{
+  int32_t            i;
+  MERGE              *merge = &run->merge;
+
+
+  if (run->writer_started)
+    {
+      output_writer_finish (&merge->writer);
+      writer_done (run);
+    }
+
+  for (i = run->rasters_closed ; i < run->raster_count ; i++) raster_output_close (&run->raster[i]);
+
+  if (run->pyramid_open) pyramid_close (&run->pyramid);
+
+  if (run->write_handle >= 0) chrtr2_handles_close (run->write_handle);
+
+  if (run->scratch_handle >= 0) chrtr2_handles_close (run->scratch_handle);
+  if (run->scratch_file[0]) remove (run->scratch_file);
+
+  if (run->file_handle >= 0) chrtr2_handles_close (run->file_handle);
+  if (run->grid_file[0]) remove (run->grid_file);
+
+  if (merge->stats != NULL) stats_free (merge->stats);
+
+  if (run->summary_open) output_summary_free (&run->summary);
+
+
+  /*  Close the input files.  */
+
+  if (run->inputs_open)
+    {
+      if (merge->input_map != NULL) for (i = 0 ; i < merge->file_count ; i++) input_map_free (&merge->input_map[i]);
+
+      input_files_free (&merge->inputs);
+    }
+
+  free (merge->input_map);
+  free (merge->buffer_x);
+  free (merge->buffer_y);
+  free (merge->file_time);
+
+  manifest_free (&run->manifest);
+  manifest_free (&run->old_manifest);
+  checkpoint_free (&run->checkpoint);
+
+  free (run->tiles);
+  free (run->range_start);
+  free (run->range_end);
+
+  if (run->grid == run->own_grid)
+    {
+      merge_grid_free (&run->grid[0]);
+      merge_grid_free (&run->grid[1]);
+    }
+}
+
+
+
+/*  Do the merge in context with run.  Returns NVFalse (with the error in run->merge) if it failed.  */
+
+static uint8_t run_merge (MERGE_CONTEXT *context, MERGE_RUN *run, INPUT_CACHE *cache)
+{
+  int32_t            i, k, buffer_count, tile_rows, tile_count, tile, start_row, halo, grid_count;
+  int32_t            range, range_count, handle, halo_x, write_handle;
+  int32_t            done_row = 0, raster_type[MAX_RASTER_OUTPUTS];
+  char               output_file[512], manifest_file[1024], stats_file[512];
+  char               *raster_file[MAX_RASTER_OUTPUTS];
+  uint8_t            *buffer_meters, incremental, update = NVFalse, pipeline, whole, verified = NVTrue, resume = NVFalse;
+  float              *buffer_size;
+  int64_t            mem_limit;
+  CHRTR2_HEADER      old_header, *file_header;
+  STATS_TIMER        timer;
+  MERGE              *merge = &run->merge;
+  MERGE_GRID         *grid = run->grid;
+  NV_F64_MBR         new_mbr;
+  struct stat        file_stat;
+
+
+  strcpy (stats_file, context->stats_file);
+  buffer_size = context->buffer_size;
+  buffer_meters = context->buffer_meters;
+  buffer_count = context->buffer_count;
+  incremental = context->incremental;
+  pipeline = context->pipeline;
+  mem_limit = context->mem_limit;
+
+
+  if (merge->file_count < 1)
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "No input files to merge");
+      return (NVFalse);
+    }
+
+
+  /*  The source of each cell is kept as a 16 bit file number (see GRID_RANK).  */
+
+  if (merge->file_count > MAX_INPUT_FILES)
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "Too many input files (%d), the limit is %d", merge->file_count, MAX_INPUT_FILES);
+      return (NVFalse);
+    }
+
+
+  /*  An incremental update or a checkpoint only make sense for an output file.  The raster outputs, the pyramid, and the
+      summary need every output row so they can't be updated either.  */
+
+  if (context->in_memory && (incremental || context->checkpoint))
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "An in-memory merge can't be incremental or checkpointed");
+      return (NVFalse);
+    }
+
+  if (context->gtiff_file[0])
+    {
+      raster_file[run->raster_count] = context->gtiff_file;
+      raster_type[run->raster_count++] = RASTER_GTIFF;
+    }
+
+  if (context->raw_file[0])
+    {
+      raster_file[run->raster_count] = context->raw_file;
+      raster_type[run->raster_count++] = RASTER_RAW;
+    }
+
+  if (run->raster_count && (incremental || context->checkpoint))
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "GeoTIFF and raw outputs can't be made by an incremental or checkpointed merge");
+      return (NVFalse);
+    }
+
+
+  /*  None of the rasters are open yet.  */
+
+  run->rasters_closed = run->raster_count;
+
+  if (context->pyramid && (incremental || context->checkpoint))
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "A pyramid can't be made by an incremental or checkpointed merge");
+      return (NVFalse);
+    }
+
+  if (context->summary_file[0] && (incremental || context->checkpoint))
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "A summary can't be made by an incremental or checkpointed merge");
+      return (NVFalse);
+    }
+
+
+  /*  -e is a policy of its own (first file wins, with the exclude buffers).  */
+
+  if (merge->policy == MERGE_POLICY_EXCLUDE) merge->exclude = NVTrue;
+
+  if (merge->exclude)
+    {
+      if (merge->policy != MERGE_POLICY_FIRST && merge->policy != MERGE_POLICY_EXCLUDE)
+        {
+          merge_error (merge, MERGE_ERROR_ARGUMENT, "The exclude option can't be used with the %s policy", merge_policy_name (merge->policy));
+          return (NVFalse);
+        }
+
+      merge->policy = MERGE_POLICY_EXCLUDE;
+    }
+
+
+  if (!input_files_init (&merge->inputs, merge->file_count, context->path, context->max_open, cache))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input files in merge_context.c: %s", strerror (ENOMEM));
+      return (NVFalse);
+    }
+
+  run->inputs_open = NVTrue;
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      if (context->handle[i] >= 0) input_files_attach (&merge->inputs, i, context->handle[i], &context->header[i]);
+    }
+
+
+  if (stats_file[0])
+    {
+      if (!stats_init (&run->stats, merge->file_count))
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating stats in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+
+      merge->stats = &run->stats;
+    }
+
+
+  merge->input_map = (INPUT_MAP *) calloc (merge->file_count, sizeof (INPUT_MAP));
+  merge->buffer_x = (int32_t *) calloc (merge->file_count, sizeof (int32_t));
+  merge->buffer_y = (int32_t *) calloc (merge->file_count, sizeof (int32_t));
+
+  if (merge->input_map == NULL || merge->buffer_x == NULL || merge->buffer_y == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input arrays in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+
+  /*  Read the headers of all of the input files and determine the MBR of the output file.  The files are only held open
+      while we're using them.  */
+
+  stats_start (merge->stats, &timer);
+
+  new_mbr.wlon = 999.0;
+  new_mbr.elon = -999.0;
+  new_mbr.slat = 999.0;
+  new_mbr.nlat = -999.0;
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      fprintf (stderr, "Input file %d  : %s\n", i + 1, merge->inputs.path[i]);
+      fflush (stderr);
+
+
+      /*  Open the input file.  */
+
+      if (input_files_open (&merge->inputs, i) < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "The file %s is not a CHRTR2 file or there was an error reading the file.\n"
+                       "The error message returned was:%s", merge->inputs.path[i], chrtr2_strerror ());
+          return (NVFalse);
+        }
+
+      input_files_release (&merge->inputs, i);
+
+      new_mbr.wlon = MIN (new_mbr.wlon, merge->inputs.header[i].mbr.wlon);
+      new_mbr.slat = MIN (new_mbr.slat, merge->inputs.header[i].mbr.slat);
+      new_mbr.elon = MAX (new_mbr.elon, merge->inputs.header[i].mbr.elon);
+      new_mbr.nlat = MAX (new_mbr.nlat, merge->inputs.header[i].mbr.nlat);
+
+      if (!merge->dateline && new_mbr.elon > 360.0) merge->dateline = NVTrue;
+    }
+
+
+  if (merge->dateline && new_mbr.elon < new_mbr.wlon) new_mbr.elon += 360.0;
+
+
+  /*  The newest policy goes by the modification times of the input files.  A file that we can't stat is the oldest.  */
+
+  if (merge->policy == MERGE_POLICY_NEWEST)
+    {
+      merge->file_time = (int64_t *) malloc (merge->file_count * sizeof (int64_t));
+      if (merge->file_time == NULL)
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input file times in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+
+      for (i = 0 ; i < merge->file_count ; i++)
+        {
+          merge->file_time[i] = -1;
+
+          if (!stat (merge->inputs.path[i], &file_stat)) merge->file_time[i] = (int64_t) file_stat.st_mtime;
+        }
+    }
+
+
+  merge->output_header = merge->inputs.header[0];
+  merge->output_header.mbr = new_mbr;
+  merge->output_header.width = NINT ((new_mbr.elon - new_mbr.wlon) / merge->inputs.header[0].lon_grid_size_degrees) + 1;
+  merge->output_header.height = NINT ((new_mbr.nlat - new_mbr.slat) / merge->inputs.header[0].lat_grid_size_degrees) + 1;
+
+
+  /*  With --area the output file only covers the area.  */
+
+  if (merge->area != NULL)
+    {
+      if (!area_header (merge->area, &merge->output_header, merge->dateline))
+        {
+          merge_error (merge, MERGE_ERROR_ARGUMENT, "The area doesn't overlap the input files");
+          return (NVFalse);
+        }
+
+      merge->output_header = merge->area->header;
+    }
+
+
+  /*  Make the output file name.  */
+
+  if (!merge_context_output_file (context, output_file))
+    {
+      merge_error (merge, MERGE_ERROR_ARGUMENT, "The output file name is too long");
+      return (NVFalse);
+    }
+
+
+  /*  Figure out the exclude buffer (in output grid cells) for each of the input files after the first.  The rows around a
+      tile that have to be merged to get the exclude test right in the tile is the sum of the buffers since each file's
+      buffer can reach data that was only inserted because of the previous file's buffer.  */
+
+  if (merge->exclude)
+    {
+      if (!buffer_count)
+        {
+          buffer_size = &default_buffer_size;
+          buffer_meters = &default_buffer_meters;
+          buffer_count = 1;
+        }
+
+      for (i = 1 ; i < merge->file_count ; i++)
+        {
+          k = MIN (i - 1, buffer_count - 1);
+
+          exclude_buffer_cells (&merge->output_header, buffer_size[k], buffer_meters[k], &merge->buffer_x[i], &merge->buffer_y[i]);
+
+          merge->halo += merge->buffer_y[i];
+        }
+    }
+
+
+  /*  For --area we merge a grid that is bigger than the output file by the exclude buffers and the regrid halo on every side
+      so that the cells along the edges of the area come out the same as they would in a merge of the whole MBR.  Only the
+      input data that lands in that grid is ever read.  */
+
+  file_header = &merge->output_header;
+
+  if (merge->area != NULL)
+    {
+      for (i = 1, halo_x = 0 ; i < merge->file_count ; i++) halo_x += merge->buffer_x[i];
+
+      area_grid (merge->area, halo_x + (merge->regrid ? REGRID_HALO : 0), merge->halo + (merge->regrid ? REGRID_HALO : 0),
+                 &merge->output_header);
+
+      file_header = &merge->area->header;
+    }
+
+
+  /*  Figure out how many output rows we can hold in memory at once.  Without a memory limit we just allocate the whole
+      output grid in memory so we don't have to keep reading and writing the output file.  If we're doing the whole output
+      file in one tile we don't need a halo.  The pipeline holds two tiles at once so they have to be half the size.  With
+      --checkpoint the tiles are the most rows that we're willing to redo after a --resume.  */
+
+  if (pipeline)
+    {
+      tile_rows = mem_limit ? merge_tile_rows (merge, mem_limit / 2) : MIN (PIPELINE_BAND_ROWS, merge->output_header.height);
+    }
+  else
+    {
+      tile_rows = merge_tile_rows (merge, mem_limit);
+    }
+
+  if (context->checkpoint) tile_rows = MIN (tile_rows, CHECKPOINT_BAND_ROWS);
+
+
+  /*  If this is an incremental merge and there's a manifest from a previous run with the same options and input files
+      (and the output file is still there and the same size) we update the output file in place instead of starting
+      over.  Any other manifest is stale so we get rid of it before we touch the output file.  It gets rewritten once the
+      output file is complete.  */
+
+  sprintf (manifest_file, "%s.manifest", output_file);
+
+  if (incremental)
+    {
+      if (!manifest_init (&run->manifest, merge)) return (NVFalse);
+
+      if (manifest_read (&run->old_manifest, manifest_file))
+        {
+          if (manifest_match (&run->manifest, &run->old_manifest))
+            {
+              run->file_handle = chrtr2_handles_open (output_file, &old_header, CHRTR2_UPDATE);
+
+              if (run->file_handle >= 0)
+                {
+                  if (old_header.width == file_header->width && old_header.height == file_header->height &&
+                      old_header.mbr.wlon == file_header->mbr.wlon && old_header.mbr.slat == file_header->mbr.slat)
+                    {
+                      update = NVTrue;
+                    }
+                  else
+                    {
+                      chrtr2_handles_close (run->file_handle);
+                      run->file_handle = -1;
+                    }
+                }
+            }
+
+          if (!update) manifest_free (&run->old_manifest);
+        }
+    }
+
+  remove (manifest_file);
+
+
+  /*  For --resume, if the checkpoint from the last run matches this merge (and the output file is still there) we pick up
+      after the last tile that it says is on the disk.  */
+
+  if (context->checkpoint)
+    {
+      if (!checkpoint_init (&run->checkpoint, merge, output_file, tile_rows)) return (NVFalse);
+
+      if (context->resume)
+        {
+          if (checkpoint_read (&run->checkpoint))
+            {
+              run->file_handle = chrtr2_handles_open (output_file, &old_header, CHRTR2_UPDATE);
+
+              if (run->file_handle >= 0)
+                {
+                  if (old_header.width == file_header->width && old_header.height == file_header->height &&
+                      old_header.mbr.wlon == file_header->mbr.wlon && old_header.mbr.slat == file_header->mbr.slat)
+                    {
+                      resume = NVTrue;
+                      done_row = run->checkpoint.done_row;
+                    }
+                  else
+                    {
+                      chrtr2_handles_close (run->file_handle);
+                      run->file_handle = -1;
+                    }
+                }
+            }
+
+          if (resume)
+            {
+              fprintf (stderr, "Resuming at output row %d of %d\n\n", done_row, merge->output_header.height);
+            }
+          else
+            {
+              fprintf (stderr, "No checkpoint of this merge to resume from, starting over\n\n");
+            }
+          fflush (stderr);
+        }
+    }
+
+
+  /*  Try to create and open the chrtr2 output file.  An in-memory merge gets a scratch file with the output header
+      instead.  It's only used for the grid coordinates.  */
+
+  if (context->in_memory)
+    {
+      sprintf (run->grid_file, "%s.grid", output_file);
+
+      run->file_handle = chrtr2_handles_create (run->grid_file, file_header);
+      if (run->file_handle < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to create %s : %s", run->grid_file, chrtr2_strerror ());
+          return (NVFalse);
+        }
+    }
+  else if (!update && !resume)
+    {
+      run->file_handle = chrtr2_handles_create (output_file, file_header);
+      if (run->file_handle < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to create %s : %s", output_file, chrtr2_strerror ());
+          return (NVFalse);
+        }
+    }
+
+
+  /*  With checkpoints the output writer closes and opens its handle again each time it syncs the output file so, unless
+      it has the --area output file to itself, it needs a handle of its own.  The merge keeps using output_handle for the
+      grid coordinates.  A new output file is closed first so that its header is on the disk.  */
+
+  write_handle = run->file_handle;
+
+  if (context->checkpoint && merge->area == NULL)
+    {
+      if (!resume)
+        {
+          chrtr2_handles_close (run->file_handle);
+          run->file_handle = chrtr2_handles_open (output_file, &old_header, CHRTR2_UPDATE);
+        }
+
+      write_handle = run->write_handle = chrtr2_handles_open (output_file, &old_header, CHRTR2_UPDATE);
+
+      if (run->file_handle < 0 || run->write_handle < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to open %s : %s", output_file, chrtr2_strerror ());
+          return (NVFalse);
+        }
+    }
+
+
+  /*  All of the merge grid coordinates come from the library so, for --area, we need a handle with the merge grid's header.
+      That's a scratch file next to the output file that is never written to.  */
+
+  merge->output_handle = run->file_handle;
+
+  if (merge->area != NULL)
+    {
+      merge->area->handle = run->file_handle;
+
+      sprintf (run->scratch_file, "%s.area", output_file);
+
+      merge->output_handle = run->scratch_handle = chrtr2_handles_create (run->scratch_file, &merge->output_header);
+      if (run->scratch_handle < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to create %s : %s", run->scratch_file, chrtr2_strerror ());
+          return (NVFalse);
+        }
+
+      if (!area_spans (merge->area))
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating area spans in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+    }
+
+
+  if (context->in_memory)
+    {
+      fprintf (stderr, "Output grid : %d by %d cells in memory\n\n", file_header->width, file_header->height);
+    }
+  else
+    {
+      fprintf (stderr, "Output file : %s\n\n", output_file);
+    }
+
+  if (merge->area != NULL) fprintf (stderr, "Area : %d by %d cells (merged with a %d by %d cell halo)\n\n", file_header->width,
+                                    file_header->height, merge->area->x, merge->area->y);
+  fflush (stderr);
+
+
+  /*  Work out where the rows and columns of each input file land in the output grid.  */
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      if ((handle = input_files_open (&merge->inputs, i)) < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Error opening %s.\nThe error message returned was:%s", merge->inputs.path[i],
+                       chrtr2_strerror ());
+          return (NVFalse);
+        }
+
+      if (!input_map_build (&merge->input_map[i], handle, &merge->inputs.header[i], merge->output_handle, &merge->output_header,
+                            merge->dateline))
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input map in merge_context.c: %s", strerror (errno));
+          input_files_release (&merge->inputs, i);
+          return (NVFalse);
+        }
+
+      input_files_release (&merge->inputs, i);
+    }
+
+
+  /*  Index the input files by the output rows that they land in so each tile only has to look at the files that overlap
+      it.  */
+
+  if (!input_files_index (&merge->inputs, merge->input_map, merge->output_header.height))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating input file index in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  stats_stop (merge->stats, &timer, STATS_OPEN, -1, merge->file_count, 0);
+
+
+  /*  The ranges of output rows that we have to merge.  Normally this is the whole output file but an incremental update
+      only has to redo the rows that the changed input data can reach.  */
+
+  run->range_start = (int32_t *) malloc (((merge->output_header.height + MANIFEST_BAND_ROWS - 1) / MANIFEST_BAND_ROWS + 1) * sizeof (int32_t));
+  run->range_end = (int32_t *) malloc (((merge->output_header.height + MANIFEST_BAND_ROWS - 1) / MANIFEST_BAND_ROWS + 1) * sizeof (int32_t));
+
+  if (run->range_start == NULL || run->range_end == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating row ranges in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  range_count = 1;
+  run->range_start[0] = 0;
+  run->range_end[0] = merge->output_header.height;
+
+  if (incremental)
+    {
+      if (!manifest_checksum (&run->manifest, merge, update ? &run->old_manifest : NULL)) return (NVFalse);
+
+      if (update)
+        {
+          range_count = manifest_dirty (&run->manifest, &run->old_manifest, merge->halo + (merge->regrid ? REGRID_HALO : 0),
+                                        run->range_start, run->range_end);
+
+          manifest_keep (&run->manifest, &run->old_manifest, range_count, run->range_start, run->range_end);
+
+          for (i = k = 0 ; i < range_count ; i++) k += run->range_end[i] - run->range_start[i];
+
+          fprintf (stderr, "Incremental update of %d of %d output rows\n\n", k, merge->output_header.height);
+          fflush (stderr);
+
+          manifest_free (&run->old_manifest);
+        }
+    }
+
+
+  for (i = tile_count = 0 ; i < range_count ; i++) tile_count += (run->range_end[i] - run->range_start[i] + tile_rows - 1) / tile_rows;
+
+  whole = (range_count == 1 && run->range_start[0] == 0 && run->range_end[0] == merge->output_header.height && tile_count == 1);
+
+  halo = whole ? 0 : merge->halo + (merge->regrid ? REGRID_HALO : 0);
+
+  grid_count = (pipeline && tile_count > 1) ? 2 : 1;
+
+  for (i = 0 ; i < grid_count ; i++)
+    {
+      if (!merge_grid_resize (&grid[i], merge->output_header.width, MIN (tile_rows + 2 * halo, merge->output_header.height)))
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating grid array in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+    }
+
+
+  /*  The output rows of each tile.  */
+
+  if ((run->tiles = (MERGE_TILE *) malloc (tile_count * sizeof (MERGE_TILE))) == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating tiles in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  tile = 0;
+  for (range = 0 ; range < range_count ; range++)
+    {
+      for (start_row = run->range_start[range] ; start_row < run->range_end[range] ; start_row += tile_rows)
+        {
+          /*  Tiles that were finished before a --resume are already on the disk.  */
+
+          if (MIN (start_row + tile_rows, run->range_end[range]) <= done_row) continue;
+
+          run->tiles[tile].start_row = start_row;
+          run->tiles[tile].end_row = MIN (start_row + tile_rows, run->range_end[range]);
+          tile++;
+        }
+    }
+
+  tile_count = tile;
+
+  for (i = merge->total_rows = 0 ; i < tile_count ; i++) merge->total_rows += run->tiles[i].end_row - run->tiles[i].start_row;
+
+
+  /*  Start the thread that writes the output rows while we merge and regrid.  */
+
+  if (!output_writer_start (&merge->writer, write_handle, merge->output_header.width, merge->area, merge->stats))
+    {
+      merge_error (merge, MERGE_ERROR_THREAD, "Starting output writer in merge_context.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  run->writer_started = NVTrue;
+
+  if (context->in_memory)
+    {
+      context->records = (CHRTR2_RECORD *) calloc ((size_t) file_header->width * (size_t) file_header->height, sizeof (CHRTR2_RECORD));
+      if (context->records == NULL)
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating output grid in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+
+      output_writer_memory (&merge->writer, context->records, file_header->width);
+    }
+
+
+  /*  The raster outputs are written from the same rows as the output file.  */
+
+  for (run->rasters_closed = 0, i = 0 ; i < run->raster_count ; i++)
+    {
+      if (!raster_output_open (&run->raster[i], raster_file[i], raster_type[i], file_header))
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to create %s : %s", raster_file[i], run->raster[i].error);
+          run->raster_count = i;
+          return (NVFalse);
+        }
+
+      output_writer_raster (&merge->writer, &run->raster[i]);
+    }
+
+  if (context->pyramid)
+    {
+      if (!pyramid_open (&run->pyramid, output_file, file_header))
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Unable to create %s : %s", run->pyramid.path, run->pyramid.error);
+          return (NVFalse);
+        }
+
+      run->pyramid_open = NVTrue;
+
+      output_writer_pyramid (&merge->writer, &run->pyramid);
+    }
+
+  if (context->summary_file[0])
+    {
+      if (!output_summary_init (&run->summary, merge->file_count, SUMMARY_BIN_SIZE))
+        {
+          merge_error (merge, MERGE_ERROR_MEMORY, "Allocating output summary in merge_context.c: %s", strerror (errno));
+          return (NVFalse);
+        }
+
+      run->summary_open = NVTrue;
+
+      output_writer_summary (&merge->writer, &run->summary);
+    }
+
+
+  /*  The rows we don't redo in an incremental update (or that were finished before a --resume) keep their values so we
+      have to start with their range.  For an incremental update that's the range of the bands that were kept (the old
+      header's range could be from data that is gone now).  Since they're being overwritten, null cells have to be written
+      too.  */
+
+  merge->update = update;
+
+  if (incremental) output_writer_bands (&merge->writer, MANIFEST_BAND_ROWS, run->manifest.min_z, run->manifest.max_z);
+
+  if (update) manifest_range (&run->manifest, &merge->writer.min_z, &merge->writer.max_z);
+
+  if (resume)
+    {
+      merge->writer.min_z = run->checkpoint.min_z;
+      merge->writer.max_z = run->checkpoint.max_z;
+    }
+
+  if (context->checkpoint)
+    {
+      output_writer_checkpoints (&merge->writer, output_file, save_checkpoint, &run->checkpoint);
+      merge->checkpoint = NVTrue;
+    }
+
+
+  if (grid_count > 1)
+    {
+      if (!merge_pipeline (merge, grid, run->tiles, tile_count, halo)) return (NVFalse);
+    }
+  else
+    {
+      if (!merge_tiles (merge, &grid[0], run->tiles, tile_count, halo, whole)) return (NVFalse);
+    }
+
+
+  if (!output_writer_finish (&merge->writer))
+    {
+      writer_done (run);
+      merge_error (merge, MERGE_ERROR_WRITE, "Error writing row %d of output file %s : %s", merge->writer.failed_row, output_file,
+                   merge->writer.error);
+      return (NVFalse);
+    }
+
+  writer_done (run);
+
+  while (run->rasters_closed < run->raster_count)
+    {
+      i = run->rasters_closed++;
+
+      if (!raster_output_close (&run->raster[i]))
+        {
+          merge_error (merge, MERGE_ERROR_WRITE, "Error writing %s : %s", raster_file[i], run->raster[i].error);
+          return (NVFalse);
+        }
+    }
+
+  if (context->pyramid)
+    {
+      run->pyramid_open = NVFalse;
+
+      if (!pyramid_close (&run->pyramid))
+        {
+          merge_error (merge, MERGE_ERROR_WRITE, "Error writing %s : %s", run->pyramid.path, run->pyramid.error);
+          return (NVFalse);
+        }
+    }
+
+
+  /*  We're done with the --area scratch file.  From here on the output file is the area's.  */
+
+  if (merge->area != NULL)
+    {
+      chrtr2_handles_close (run->scratch_handle);
+      run->scratch_handle = -1;
+
+      remove (run->scratch_file);
+      run->scratch_file[0] = 0;
+
+      merge->output_handle = run->file_handle;
+      merge->output_header = merge->area->header;
+    }
+
+  merge_coverage_report (merge);
+
+  if (merge->verify) verified = merge_verify_report (merge);
+
+
+  if (merge->stats != NULL)
+    {
+      if (!stats_write_json (merge->stats, stats_file, &merge->inputs, output_file, &merge->output_header))
+        {
+          fprintf (stderr, "\n\nWarning: unable to write the stats file %s\n", stats_file);
+          perror ("    ");
+        }
+    }
+
+  if (context->summary_file[0])
+    {
+      if (!output_summary_write_json (&run->summary, context->summary_file, &merge->inputs, output_file, &merge->output_header))
+        {
+          fprintf (stderr, "\n\nWarning: unable to write the summary file %s\n", context->summary_file);
+          perror ("    ");
+        }
+    }
+
+
+  /*  Update the header with the observed min and max values.  */
+
+  merge->output_header.min_observed_z = merge->writer.min_z;
+  merge->output_header.max_observed_z = merge->writer.max_z;
+
+  if (context->in_memory)
+    {
+      chrtr2_handles_close (merge->output_handle);
+      run->file_handle = -1;
+
+      remove (run->grid_file);
+      run->grid_file[0] = 0;
+
+      context->output_header = merge->output_header;
+    }
+  else
+    {
+      chrtr2_update_header (merge->output_handle, merge->output_header);
+
+      chrtr2_handles_close (merge->output_handle);
+      run->file_handle = -1;
+    }
+
+
+  /*  Now that the output file is complete we can save the manifest for the next incremental merge.  After a --resume we
+      don't know the range of the bands that were written before it so the next incremental merge has to start over.  */
+
+  if (incremental && !resume && !manifest_write (&run->manifest, manifest_file))
+    {
+      fprintf (stderr, "\n\nWarning: unable to write the manifest file %s\n", manifest_file);
+      perror ("    ");
+    }
+
+
+  /*  The output file is complete so there's nothing left to resume.  */
+
+  if (context->checkpoint) remove (run->checkpoint.path);
+
+
+  /*  A --verify mismatch is only reported once the output is complete.  */
+
+  if (!verified)
+    {
+      merge_error (merge, MERGE_ERROR_VERIFY, "%lld cells of the merged grid didn't match the reference merge (see --verify above)",
+                   (long long) merge->verify_diffs);
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Run the merge in context.  grid is the two grids to use (they can have been used by an earlier merge) or NULL to use
+    grids of our own.  cache is the batch input cache (NULL if we aren't running a batch).  Returns MERGE_OK or, if the
+    merge failed, the MERGE_ERROR_ code with the message in context->error_message.  Everything that the merge opened or
+    allocated is closed or freed either way.  MERGE_ERROR_VERIFY (--verify found differences) is only returned after the
+    output is complete.  */
+
+int32_t merge_context_run (MERGE_CONTEXT *context, MERGE_GRID *grid, INPUT_CACHE *cache)
+{
+  MERGE_RUN          run;
+
+
+  memset (&run, 0, sizeof (MERGE_RUN));
+
+  run.merge = context->merge;
+  run.merge.progress = context->progress;
+  run.merge.progress_data = context->progress_data;
+  run.merge.error = MERGE_OK;
+  run.merge.error_message[0] = 0;
+
+  run.file_handle = run.write_handle = run.scratch_handle = -1;
+
+  if (grid == NULL)
+    {
+      run.grid = run.own_grid;
+    }
+  else
+    {
+      run.grid = grid;
+    }
+
+
+  context->error = MERGE_OK;
+  context->error_message[0] = 0;
+
+  if (!run_merge (context, &run, cache))
+    {
+      context->error = run.merge.error;
+      strcpy (context->error_message, run.merge.error_message);
+
+
+      /*  The in-memory output is only good if the merge finished.  */
+
+      if (context->error != MERGE_ERROR_VERIFY && context->records != NULL)
+        {
+          free (context->records);
+          context->records = NULL;
+        }
+    }
+
+  free_run (&run);
+
+  return (context->error);
+}
+
+
+
+/*  Free everything in the context (including the in-memory output grid).  */
+
+void merge_context_free (MERGE_CONTEXT *context)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < context->path_count ; i++) free (context->path[i]);
+
+  if (context->path != NULL) free (context->path);
+  if (context->handle != NULL) free (context->handle);
+  if (context->header != NULL) free (context->header);
+  if (context->buffer_size != NULL) free (context->buffer_size);
+  if (context->buffer_meters != NULL) free (context->buffer_meters);
+  if (context->records != NULL) free (context->records);
+
+  area_free (&context->area);
+
+  memset (context, 0, sizeof (MERGE_CONTEXT));
+}
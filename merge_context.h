@@ -0,0 +1,87 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _MERGE_CONTEXT_H_
+#define _MERGE_CONTEXT_H_
+
+#include "merge.h"
+#include "input_cache.h"
+
+
+/*  One merge, set up by a program that links with the merge library (the chrtr2_merge command line is just one of them).
+    Fill it in with merge_context_init and the merge_context_ functions (or set the fields directly), call
+    merge_context_run, and then merge_context_free.  Each context is only good for one merge.
+
+    The inputs can be CHRTR2 file names (opened and closed by the merge as they're needed) or CHRTR2 files that the caller
+    already has open.  The output is either written to output_file or, with in_memory set, returned in output_header and
+    records.  The merge still gets its grid coordinates from the CHRTR2 library so an in-memory merge creates a scratch
+    file (OUTPUT_FILE.grid) that only has the output header in it and removes it when it's done.  The merge opens and closes
+    CHRTR2 files from several threads so a caller that opens or closes CHRTR2 files of its own while a merge is running has
+    to use chrtr2_handles_open, chrtr2_handles_create, and chrtr2_handles_close (chrtr2_handles.h).  Nothing in the merge
+    exits.  When a merge_context_ function fails it returns the error (a MERGE_ERROR_ code) in error and says why in
+    error_message, after closing and freeing whatever the merge had set up.  */
+
+typedef struct
+{
+  MERGE              merge;           /*  Only the options are set  */
+  char               output_file[512];
+  char               stats_file[512];
+  char               gtiff_file[512]; /*  GeoTIFF output (written along with the output, empty for none)  */
+  char               raw_file[512];   /*  Raw (ESRI BIL) Z output (empty for none)  */
+  uint8_t            pyramid;         /*  Build the overview pyramid (OUTPUT_FILE.pyramid)  */
+  char               summary_file[512]; /*  QA summary JSON (empty for none)  */
+  char               **path;
+  int32_t            *handle;         /*  Caller's CHRTR2 handle for each input (-1 if the merge opens the file)  */
+  CHRTR2_HEADER      *header;         /*  Header of each of the caller's open inputs  */
+  int32_t            path_count;
+  float              *buffer_size;
+  uint8_t            *buffer_meters;
+  int32_t            buffer_count;
+  uint8_t            incremental;
+  uint8_t            pipeline;
+  int64_t            mem_limit;
+  int32_t            max_open;        /*  Most input files that the merge keeps open  */
+  AREA               area;            /*  merge.area points here if an area was set  */
+  uint8_t            checkpoint;
+  uint8_t            resume;
+  MERGE_PROGRESS     progress;        /*  NULL for no progress calls  */
+  void               *progress_data;
+  uint8_t            in_memory;       /*  Return the output in output_header and records instead of writing output_file  */
+  CHRTR2_HEADER      output_header;   /*  Header of the merged grid (in_memory only)  */
+  CHRTR2_RECORD      *records;        /*  Merged grid, output_header.width by output_header.height, row major  */
+  int32_t            error;           /*  MERGE_ERROR_ code of the last failure (MERGE_OK if there wasn't one)  */
+  char               error_message[512];
+} MERGE_CONTEXT;
+
+
+void merge_context_init (MERGE_CONTEXT *context);
+uint8_t merge_context_add_file (MERGE_CONTEXT *context, char *path);
+uint8_t merge_context_add_handle (MERGE_CONTEXT *context, char *path, int32_t handle, CHRTR2_HEADER *header);
+uint8_t merge_context_area (MERGE_CONTEXT *context, char *string);
+void merge_context_progress (MERGE_CONTEXT *context, MERGE_PROGRESS progress, void *data);
+uint8_t merge_context_output_file (MERGE_CONTEXT *context, char *output_file);
+int32_t merge_context_run (MERGE_CONTEXT *context, MERGE_GRID *grid, INPUT_CACHE *cache);
+void merge_context_free (MERGE_CONTEXT *context);
+
+
+#endif
@@ -0,0 +1,281 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifdef NVLinux
+#include <sys/mman.h>
+#endif
+
+#include "merge_grid.h"
+
+
+/*  Alignment of the tile slabs.  2MB is the x86_64 huge page size.  */
+
+#define         GRID_ALIGNMENT 2097152
+
+
+/*  Number of tiles in each slab (one huge page worth).  */
+
+#define         GRID_SLAB_TILES (GRID_ALIGNMENT / sizeof (GRID_TILE))
+
+
+/*  The tile that every empty part of every grid points at.  Nothing is ever stored in it.  */
+
+GRID_TILE merge_grid_null_tile;
+
+
+
+static void *aligned_alloc_zero (size_t size)
+{
+  void               *ptr;
+
+
+  size = (size + GRID_ALIGNMENT - 1) & ~((size_t) GRID_ALIGNMENT - 1);
+
+#ifdef NVWIN3X
+  ptr = _aligned_malloc (size, GRID_ALIGNMENT);
+  if (ptr == NULL) return (NULL);
+#else
+  if (posix_memalign (&ptr, GRID_ALIGNMENT, size)) return (NULL);
+#endif
+
+#ifdef MADV_HUGEPAGE
+  madvise (ptr, size, MADV_HUGEPAGE);
+#endif
+
+  memset (ptr, 0, size);
+
+  return (ptr);
+}
+
+
+
+static void aligned_free (void *ptr)
+{
+#ifdef NVWIN3X
+  _aligned_free (ptr);
+#else
+  free (ptr);
+#endif
+}
+
+
+
+/*  Set up an empty grid of rows full width rows of the output grid.  Only the tile table is allocated here.  */
+
+uint8_t merge_grid_alloc (MERGE_GRID *grid, int32_t width, int32_t rows)
+{
+  memset (grid, 0, sizeof (MERGE_GRID));
+
+  return (merge_grid_resize (grid, width, rows));
+}
+
+
+
+/*  Empty a grid that has already been used (or was zeroed) and set it up for rows full width rows of an output grid that is
+    width cells wide.  The tiles that the grid already has are kept for reuse so a batch of merges doesn't have to allocate
+    them again for every output file.  */
+
+uint8_t merge_grid_resize (MERGE_GRID *grid, int32_t width, int32_t rows)
+{
+  size_t             i, tiles;
+
+
+  if (grid->tile != NULL) merge_grid_reset (grid, 0, 0);
+
+  grid->failed = NVFalse;
+  grid->start_row = 0;
+  grid->rows = grid->allocated_rows = rows;
+  grid->width = width;
+  grid->tile_cols = (width + GRID_TILE_MASK) >> GRID_TILE_SHIFT;
+  grid->tile_rows = (rows + GRID_TILE_MASK) >> GRID_TILE_SHIFT;
+
+  tiles = (size_t) grid->tile_cols * (size_t) grid->tile_rows;
+
+  if (grid->extra != NULL) free (grid->extra);
+
+  grid->tile = (GRID_TILE **) realloc (grid->tile, MAX (tiles, 1) * sizeof (GRID_TILE *));
+  grid->extra = (GRID_EXTRA **) calloc (MAX (tiles, 1), sizeof (GRID_EXTRA *));
+  if (grid->tile == NULL || grid->extra == NULL) return (NVFalse);
+
+  for (i = 0 ; i < tiles ; i++) grid->tile[i] = &merge_grid_null_tile;
+
+  return (NVTrue);
+}
+
+
+
+/*  Replace the null tile at number in the tile table with an empty tile of our own (from the pool if there are any left
+    over from the last band).  Returns NULL (and sets grid->failed) if we couldn't allocate a new slab of tiles.  */
+
+GRID_TILE *merge_grid_new_tile (MERGE_GRID *grid, size_t number)
+{
+  int32_t            i;
+  uint8_t            *slab;
+  void               **slabs;
+  GRID_TILE          *tile, **pool;
+
+
+  if (!grid->pool_count)
+    {
+      /*  The pool has to have room for every tile in every slab so we grow it before we take on another slab.  */
+
+      pool = (GRID_TILE **) realloc (grid->pool, (grid->slab_count + 1) * GRID_SLAB_TILES * sizeof (GRID_TILE *));
+      if (pool == NULL)
+        {
+          grid->failed = NVTrue;
+          return (NULL);
+        }
+      grid->pool = pool;
+
+      slabs = (void **) realloc (grid->slab, (grid->slab_count + 1) * sizeof (void *));
+      if (slabs == NULL)
+        {
+          grid->failed = NVTrue;
+          return (NULL);
+        }
+      grid->slab = slabs;
+
+      if ((slab = (uint8_t *) aligned_alloc_zero (GRID_ALIGNMENT)) == NULL)
+        {
+          grid->failed = NVTrue;
+          return (NULL);
+        }
+
+      grid->slab[grid->slab_count++] = slab;
+
+      for (i = GRID_SLAB_TILES - 1 ; i >= 0 ; i--) grid->pool[grid->pool_count++] = (GRID_TILE *) (slab + i * sizeof (GRID_TILE));
+
+      tile = grid->pool[--grid->pool_count];
+    }
+  else
+    {
+      tile = grid->pool[--grid->pool_count];
+      memset (tile, 0, sizeof (GRID_TILE));
+    }
+
+  grid->tile[number] = tile;
+
+  grid->tiles_used++;
+  grid->peak_tiles = MAX (grid->peak_tiles, grid->tiles_used);
+
+  return (tile);
+}
+
+
+
+/*  Allocate the extra plane of tile number the first time we need it.  Returns NVFalse (and sets grid->failed) if we
+    couldn't.  */
+
+uint8_t merge_grid_alloc_extra (MERGE_GRID *grid, size_t number)
+{
+  grid->extra[number] = (GRID_EXTRA *) calloc (GRID_TILE_CELLS, sizeof (GRID_EXTRA));
+
+  if (grid->extra[number] == NULL)
+    {
+      grid->failed = NVTrue;
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Copy the Z values of grid row row (not output row) to z (0.0 where there's no data).  */
+
+void merge_grid_read_z (MERGE_GRID *grid, int32_t row, float *z)
+{
+  int32_t            j, cols;
+  GRID_TILE          *tile;
+
+
+  for (j = 0 ; j < grid->width ; j += GRID_TILE_SIZE)
+    {
+      cols = MIN (GRID_TILE_SIZE, grid->width - j);
+      tile = merge_grid_tile (grid, row, j);
+
+      if (tile == &merge_grid_null_tile)
+        {
+          memset (&z[j], 0, cols * sizeof (float));
+        }
+      else
+        {
+          memcpy (&z[j], &tile->z[merge_grid_offset (row, 0)], cols * sizeof (float));
+        }
+    }
+}
+
+
+
+/*  Clear the grid and point it at output rows start_row through start_row + rows - 1.  rows can't be more than the number
+    of rows the grid was allocated with.  The tiles that were in use go back in the pool.  */
+
+void merge_grid_reset (MERGE_GRID *grid, int32_t start_row, int32_t rows)
+{
+  size_t             i, tiles;
+
+
+  grid->start_row = start_row;
+  grid->rows = rows;
+
+  tiles = (size_t) grid->tile_cols * (size_t) grid->tile_rows;
+
+  for (i = 0 ; i < tiles && grid->tiles_used ; i++)
+    {
+      if (grid->tile[i] != &merge_grid_null_tile)
+        {
+          grid->pool[grid->pool_count++] = grid->tile[i];
+          grid->tile[i] = &merge_grid_null_tile;
+          grid->tiles_used--;
+        }
+
+      if (grid->extra[i] != NULL)
+        {
+          free (grid->extra[i]);
+          grid->extra[i] = NULL;
+        }
+    }
+}
+
+
+
+void merge_grid_free (MERGE_GRID *grid)
+{
+  int32_t            i;
+
+
+  merge_grid_reset (grid, 0, 0);
+
+  for (i = 0 ; i < grid->slab_count ; i++) aligned_free (grid->slab[i]);
+
+  if (grid->slab != NULL) free (grid->slab);
+  if (grid->tile != NULL) free (grid->tile);
+  if (grid->extra != NULL) free (grid->extra);
+  if (grid->pool != NULL) free (grid->pool);
+
+  grid->slab = NULL;
+  grid->tile = NULL;
+  grid->extra = NULL;
+  grid->pool = NULL;
+  grid->slab_count = 0;
+}
@@ -0,0 +1,218 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _MERGE_GRID_H_
+#define _MERGE_GRID_H_
+
+#include "chrtr2_merge.h"
+
+
+/*  Input file number (starting at 1) that a grid cell came from.  0 means the cell is empty.  */
+
+typedef uint16_t GRID_RANK;
+
+
+/*  The most input files that GRID_RANK can tell apart.  */
+
+#define         MAX_INPUT_FILES 65535
+
+
+/*  The parts of a CHRTR2 record that the merge never looks at.  These are only kept if some input actually has them.  */
+
+typedef struct
+{
+  uint32_t           number_of_points;
+  float              horizontal_uncertainty;
+  float              vertical_uncertainty;
+  float              uncertainty;
+} GRID_EXTRA;
+
+
+/*  The grid is stored as square tiles of GRID_TILE_SIZE by GRID_TILE_SIZE cells.  GRID_TILE_SIZE has to be a power of 2.  */
+
+#define         GRID_TILE_SHIFT 6
+#define         GRID_TILE_SIZE (1 << GRID_TILE_SHIFT)
+#define         GRID_TILE_MASK (GRID_TILE_SIZE - 1)
+#define         GRID_TILE_CELLS (GRID_TILE_SIZE * GRID_TILE_SIZE)
+
+
+/*  One tile of the grid.  The cells are stored as separate planes (row major, GRID_TILE_SIZE cells per row) so that the
+    loops that only look at the status or Z values don't have to drag the rest of the record through the cache.  A tile is
+    exactly 32KB so the tiles can be carved out of huge page aligned slabs with no waste.  */
+
+typedef struct
+{
+  float              z[GRID_TILE_CELLS];
+  uint16_t           status[GRID_TILE_CELLS];
+  GRID_RANK          rank[GRID_TILE_CELLS];
+} GRID_TILE;
+
+
+/*  The part of the output grid that is currently in memory.  This is the whole output grid unless we're tiling to stay
+    under a memory limit, in which case it is a band of full width rows.  When the inputs are far apart most of the output
+    MBR never gets any data so the grid is sparse.  A tile isn't allocated until a record is stored in it.  Until then its
+    entry in the tile table points at the shared (all zero) null tile so reads don't have to check for it, and the loops
+    over the grid skip it as a whole.  Tiles freed by merge_grid_reset are kept for reuse by the next band.  The extra plane
+    of a tile isn't allocated until a record with any of its fields set is stored in the tile.  */
+
+typedef struct
+{
+  int32_t            start_row;       /*  Output row of the first grid row  */
+  int32_t            rows;            /*  Number of output rows in the grid  */
+  int32_t            allocated_rows;  /*  Number of rows that the tile table was allocated with  */
+  int32_t            width;           /*  Width of the output grid  */
+  int32_t            tile_cols;       /*  Number of tiles across the grid  */
+  int32_t            tile_rows;       /*  Number of tiles down the grid (for allocated_rows)  */
+  GRID_TILE          **tile;          /*  tile_rows * tile_cols tiles (row major)  */
+  GRID_EXTRA         **extra;         /*  Extra plane for each tile (GRID_TILE_CELLS entries, NULL if not needed)  */
+  GRID_TILE          **pool;          /*  Allocated tiles that aren't in use  */
+  int32_t            pool_count;
+  void               **slab;          /*  The allocations that the tiles were carved out of  */
+  int32_t            slab_count;
+  int32_t            tiles_used;      /*  Number of tiles in the tile table that aren't the null tile  */
+  int32_t            peak_tiles;      /*  Most tiles ever used at once  */
+  uint8_t            failed;          /*  A tile or extra plane couldn't be allocated (the record wasn't stored)  */
+} MERGE_GRID;
+
+
+extern GRID_TILE merge_grid_null_tile;
+
+
+uint8_t merge_grid_alloc (MERGE_GRID *grid, int32_t width, int32_t rows);
+uint8_t merge_grid_resize (MERGE_GRID *grid, int32_t width, int32_t rows);
+void merge_grid_reset (MERGE_GRID *grid, int32_t start_row, int32_t rows);
+GRID_TILE *merge_grid_new_tile (MERGE_GRID *grid, size_t tile);
+uint8_t merge_grid_alloc_extra (MERGE_GRID *grid, size_t tile);
+void merge_grid_read_z (MERGE_GRID *grid, int32_t row, float *z);
+void merge_grid_free (MERGE_GRID *grid);
+
+
+/*  Number (in the tile table) of the tile that holds grid row row (not output row), column col.  */
+
+static inline size_t merge_grid_tile_number (MERGE_GRID *grid, int32_t row, int32_t col)
+{
+  return ((size_t) (row >> GRID_TILE_SHIFT) * (size_t) grid->tile_cols + (size_t) (col >> GRID_TILE_SHIFT));
+}
+
+
+
+/*  The tile that holds grid row row, column col.  This is the null tile if nothing has been stored in it.  */
+
+static inline GRID_TILE *merge_grid_tile (MERGE_GRID *grid, int32_t row, int32_t col)
+{
+  return (grid->tile[merge_grid_tile_number (grid, row, col)]);
+}
+
+
+
+/*  Index of grid row row, column col in the planes of its tile.  */
+
+static inline int32_t merge_grid_offset (int32_t row, int32_t col)
+{
+  return (((row & GRID_TILE_MASK) << GRID_TILE_SHIFT) | (col & GRID_TILE_MASK));
+}
+
+
+
+/*  Status of grid row row, column col.  */
+
+static inline uint16_t merge_grid_status (MERGE_GRID *grid, int32_t row, int32_t col)
+{
+  return (merge_grid_tile (grid, row, col)->status[merge_grid_offset (row, col)]);
+}
+
+
+
+/*  Store record in cell offset of tile number number (which has to have been allocated) with the given rank.  */
+
+static inline void merge_grid_store (MERGE_GRID *grid, size_t number, int32_t offset, CHRTR2_RECORD *record, GRID_RANK rank)
+{
+  GRID_TILE          *tile;
+  GRID_EXTRA         *extra;
+
+
+  tile = grid->tile[number];
+
+  tile->z[offset] = record->z;
+  tile->status[offset] = record->status;
+  tile->rank[offset] = rank;
+
+  if (grid->extra[number] == NULL)
+    {
+      if (!record->number_of_points && record->horizontal_uncertainty == 0.0 && record->vertical_uncertainty == 0.0 &&
+          record->uncertainty == 0.0) return;
+
+      if (!merge_grid_alloc_extra (grid, number)) return;
+    }
+
+  extra = &grid->extra[number][offset];
+  extra->number_of_points = record->number_of_points;
+  extra->horizontal_uncertainty = record->horizontal_uncertainty;
+  extra->vertical_uncertainty = record->vertical_uncertainty;
+  extra->uncertainty = record->uncertainty;
+}
+
+
+
+/*  Store record in grid row row, column col with the given rank.  */
+
+static inline void merge_grid_set (MERGE_GRID *grid, int32_t row, int32_t col, CHRTR2_RECORD *record, GRID_RANK rank)
+{
+  size_t             number;
+
+
+  number = merge_grid_tile_number (grid, row, col);
+
+  if (grid->tile[number] == &merge_grid_null_tile && merge_grid_new_tile (grid, number) == NULL) return;
+
+  merge_grid_store (grid, number, merge_grid_offset (row, col), record, rank);
+}
+
+
+
+/*  Rebuild the CHRTR2 record for cell offset of tile number number.  */
+
+static inline void merge_grid_get (MERGE_GRID *grid, size_t number, int32_t offset, CHRTR2_RECORD *record)
+{
+  GRID_TILE          *tile;
+  GRID_EXTRA         *extra;
+
+
+  memset (record, 0, sizeof (CHRTR2_RECORD));
+
+  tile = grid->tile[number];
+  record->z = tile->z[offset];
+  record->status = tile->status[offset];
+
+  if (grid->extra[number] != NULL)
+    {
+      extra = &grid->extra[number][offset];
+      record->number_of_points = extra->number_of_points;
+      record->horizontal_uncertainty = extra->horizontal_uncertainty;
+      record->vertical_uncertainty = extra->vertical_uncertainty;
+      record->uncertainty = extra->uncertainty;
+    }
+}
+
+
+#endif
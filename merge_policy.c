@@ -0,0 +1,76 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "merge_policy.h"
+
+
+/*  --policy names (indexed by policy).  */
+
+static char *policy_names[MERGE_POLICIES] = {"first", "exclude", "shoalest", "uncertainty", "newest", "status"};
+
+
+
+/*  Returns the policy for a --policy name or -1 if there's no such policy.  MERGE_POLICY_EXCLUDE is only set with -e.  */
+
+int32_t merge_policy_parse (char *name)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < MERGE_POLICIES ; i++)
+    {
+      if (i != MERGE_POLICY_EXCLUDE && !strcmp (name, policy_names[i])) return (i);
+    }
+
+  return (-1);
+}
+
+
+
+char *merge_policy_name (int32_t policy)
+{
+  return (policy_names[policy]);
+}
+
+
+
+/*  Status bits that make a cell covered (see coverage_map_alloc) under policy.  A covered cell can't be replaced by any
+    lower precedence file.  With shoalest, uncertainty, or newest any cell can be replaced so nothing is ever covered and
+    every input row has to be read.  */
+
+uint16_t merge_policy_coverage (int32_t policy)
+{
+  switch (policy)
+    {
+    case MERGE_POLICY_FIRST:
+      return (0xffff);
+
+    case MERGE_POLICY_EXCLUDE:
+      return (HARD_DATA);
+
+    case MERGE_POLICY_STATUS:
+      return (CHRTR2_REAL);
+    }
+
+  return (0);
+}
@@ -0,0 +1,110 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _MERGE_POLICY_H_
+#define _MERGE_POLICY_H_
+
+#include <float.h>
+
+#include "chrtr2_merge.h"
+#include "merge_grid.h"
+
+
+/*  How a record from an input file is resolved against a grid cell that another record has already been stored in
+    (--policy).  By default the first file (in precedence order) with data wins.  MERGE_POLICY_EXCLUDE is the default
+    policy with -e (only hard data outside of the exclude buffers of the higher precedence files is inserted) and is picked
+    by -e, not by --policy.  With the other policies an empty cell always takes the record and a record without data never
+    replaces one with data.  Otherwise the record only replaces the cell if it's strictly better so ties go to whichever got
+    there first (the higher precedence file).  */
+
+#define         MERGE_POLICY_FIRST       0    /*  First file with data wins  */
+#define         MERGE_POLICY_EXCLUDE     1    /*  -e  */
+#define         MERGE_POLICY_SHOALEST    2    /*  Smallest Z wins (Z is depth, positive down)  */
+#define         MERGE_POLICY_UNCERTAINTY 3    /*  Lowest uncertainty wins (0 is unknown and loses to any known value)  */
+#define         MERGE_POLICY_NEWEST      4    /*  Most recently modified input file wins  */
+#define         MERGE_POLICY_STATUS      5    /*  Real over digitized contour over land mask over anything else  */
+
+#define         MERGE_POLICIES           6
+
+
+int32_t merge_policy_parse (char *name);
+char *merge_policy_name (int32_t policy);
+uint16_t merge_policy_coverage (int32_t policy);
+
+
+
+/*  Rank of status for MERGE_POLICY_STATUS (higher wins, 0 is no data).  */
+
+static inline int32_t merge_policy_priority (uint16_t status)
+{
+  if (status & CHRTR2_REAL) return (4);
+  if (status & CHRTR2_DIGITIZED_CONTOUR) return (3);
+  if (status & CHRTR2_LAND_MASK) return (2);
+  if (status) return (1);
+
+  return (0);
+}
+
+
+
+/*  Uncertainty for MERGE_POLICY_UNCERTAINTY.  Unknown (0) uncertainty sorts after everything else.  */
+
+static inline float merge_policy_uncertainty (float uncertainty)
+{
+  return (uncertainty > 0.0 ? uncertainty : FLT_MAX);
+}
+
+
+
+/*  Returns NVTrue if record (from input file number rank, starting at 1) should replace a cell with Z value z, status
+    status, uncertainty uncertainty, and rank old_rank under policy (anything but MERGE_POLICY_EXCLUDE, which needs the
+    exclude map).  file_time is the modification time of each input file (only used by MERGE_POLICY_NEWEST).  This is
+    inlined into loops with a constant policy so the tests for the other policies drop out.  */
+
+static inline uint8_t merge_policy_replaces (int32_t policy, CHRTR2_RECORD *record, GRID_RANK rank, float z, uint16_t status,
+                                             float uncertainty, GRID_RANK old_rank, int64_t *file_time)
+{
+  if (!status) return (NVTrue);
+
+  if (policy == MERGE_POLICY_FIRST || !record->status) return (NVFalse);
+
+  switch (policy)
+    {
+    case MERGE_POLICY_SHOALEST:
+      return (record->z < z);
+
+    case MERGE_POLICY_UNCERTAINTY:
+      return (merge_policy_uncertainty (record->uncertainty) < merge_policy_uncertainty (uncertainty));
+
+    case MERGE_POLICY_NEWEST:
+      return (file_time[rank - 1] > file_time[old_rank - 1]);
+
+    case MERGE_POLICY_STATUS:
+      return (merge_policy_priority (record->status) > merge_policy_priority (status));
+    }
+
+  return (NVFalse);
+}
+
+
+#endif
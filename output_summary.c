@@ -0,0 +1,261 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "output_summary.h"
+#include "stats.h"
+#include "version.h"
+
+
+/*  Names of the CHRTR2 status bits.  Bits that aren't in the list are written as bit_N (only if any cells have them).  */
+
+#define         STATUS_NAMES 6
+
+static uint16_t status_bit[STATUS_NAMES] = {CHRTR2_REAL, CHRTR2_INTERPOLATED, CHRTR2_DIGITIZED_CONTOUR, CHRTR2_CHECKED,
+                                            CHRTR2_LAND_MASK, CHRTR2_USER_01};
+static char *status_name[STATUS_NAMES] = {"real", "interpolated", "digitized_contour", "checked", "land_mask", "user_01"};
+
+
+
+/*  Start an empty summary for a merge of file_count input files with Z histogram bins bin_size wide.  Returns NVFalse if
+    we couldn't allocate memory.  */
+
+uint8_t output_summary_init (OUTPUT_SUMMARY *summary, int32_t file_count, double bin_size)
+{
+  memset (summary, 0, sizeof (OUTPUT_SUMMARY));
+
+  summary->file_count = file_count;
+  summary->bin_size = bin_size;
+  summary->min_z = 9999999999.0;
+  summary->max_z = -9999999999.0;
+
+  summary->rank_count = (int64_t *) calloc (file_count + 1, sizeof (int64_t));
+  if (summary->rank_count == NULL) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+/*  Make the histogram cover bins first through last (with some room to spare so it doesn't have to grow for every row) if
+    it wouldn't be more than SUMMARY_MAX_BINS.  If it can't grow the cells that don't fit are counted in outside.  */
+
+static void grow_histogram (OUTPUT_SUMMARY *summary, int64_t first, int64_t last)
+{
+  int64_t            start, end, spare;
+  int64_t            *histogram;
+
+
+  if (summary->bin_count)
+    {
+      if (first >= summary->first_bin && last < summary->first_bin + summary->bin_count) return;
+
+      start = MIN (first, summary->first_bin);
+      end = MAX (last + 1, summary->first_bin + summary->bin_count);
+    }
+  else
+    {
+      start = first;
+      end = last + 1;
+    }
+
+  if (end - start > SUMMARY_MAX_BINS) return;
+
+  spare = MIN ((end - start) / 2 + 16, (SUMMARY_MAX_BINS - (end - start)) / 2);
+  start -= spare;
+  end += spare;
+
+  histogram = (int64_t *) calloc (end - start, sizeof (int64_t));
+  if (histogram == NULL) return;
+
+  if (summary->bin_count)
+    memcpy (&histogram[summary->first_bin - start], summary->histogram, summary->bin_count * sizeof (int64_t));
+
+  free (summary->histogram);
+
+  summary->histogram = histogram;
+  summary->first_bin = start;
+  summary->bin_count = (int32_t) (end - start);
+}
+
+
+
+/*  Add count records (with source ranks rank) to the summary.  min_z and max_z are the range of the records with data
+    (min_z is more than max_z if none of them have any).  */
+
+void output_summary_add (OUTPUT_SUMMARY *summary, CHRTR2_RECORD *records, GRID_RANK *rank, int32_t count, float min_z,
+                         float max_z)
+{
+  int32_t            k;
+  int64_t            bin, cells = 0, outside = 0;
+  double             scale;
+
+
+  if (min_z > max_z) return;
+
+  scale = 1.0 / summary->bin_size;
+
+  grow_histogram (summary, (int64_t) floor (min_z * scale), (int64_t) floor (max_z * scale));
+
+  for (k = 0 ; k < count ; k++)
+    {
+      if (!records[k].status) continue;
+
+      summary->status_low[records[k].status & 0xff]++;
+      summary->status_high[records[k].status >> 8]++;
+      summary->rank_count[rank[k]]++;
+
+      bin = (int64_t) floor (records[k].z * scale) - summary->first_bin;
+
+      if (bin >= 0 && bin < summary->bin_count)
+        {
+          summary->histogram[bin]++;
+        }
+      else
+        {
+          outside++;
+        }
+
+      cells++;
+    }
+
+  summary->cells += cells;
+  summary->outside += outside;
+  summary->min_z = MIN (summary->min_z, min_z);
+  summary->max_z = MAX (summary->max_z, max_z);
+}
+
+
+
+/*  Number of cells that have status bit bit set.  */
+
+static int64_t bit_count (OUTPUT_SUMMARY *summary, uint16_t bit)
+{
+  int32_t            i;
+  int64_t            count = 0;
+
+
+  for (i = 0 ; i < 256 ; i++)
+    {
+      if (i & bit) count += summary->status_low[i];
+      if (i & (bit >> 8)) count += summary->status_high[i];
+    }
+
+  return (count);
+}
+
+
+
+/*  Write the summary as JSON to path.  Returns NVFalse if the file couldn't be written.  */
+
+uint8_t output_summary_write_json (OUTPUT_SUMMARY *summary, char *path, INPUT_FILES *inputs, char *output_file,
+                                   CHRTR2_HEADER *output_header)
+{
+  FILE               *fp;
+  int32_t            i, k, first, last;
+  int64_t            count;
+
+
+  if ((fp = fopen (path, "w")) == NULL) return (NVFalse);
+
+  fprintf (fp, "{\n  \"version\": ");
+  stats_json_string (fp, VERSION);
+  fprintf (fp, ",\n  \"output\": {\"file\": ");
+  stats_json_string (fp, output_file);
+  fprintf (fp, ", \"width\": %d, \"height\": %d, \"cells\": %lld},\n", output_header->width, output_header->height,
+           (long long) output_header->width * (long long) output_header->height);
+
+  fprintf (fp, "  \"cells_with_data\": %lld,\n", (long long) summary->cells);
+
+  if (summary->cells)
+    {
+      fprintf (fp, "  \"min_z\": %.9g,\n  \"max_z\": %.9g,\n", summary->min_z, summary->max_z);
+    }
+  else
+    {
+      fprintf (fp, "  \"min_z\": null,\n  \"max_z\": null,\n");
+    }
+
+
+  /*  Cells with each status bit.  */
+
+  fprintf (fp, "  \"status\": {");
+
+  for (i = 0 ; i < STATUS_NAMES ; i++)
+    fprintf (fp, "%s\"%s\": %lld", i ? ", " : "", status_name[i], (long long) bit_count (summary, status_bit[i]));
+
+  for (k = 0 ; k < 16 ; k++)
+    {
+      for (i = 0 ; i < STATUS_NAMES && status_bit[i] != (1 << k) ; i++);
+
+      if (i == STATUS_NAMES && (count = bit_count (summary, 1 << k))) fprintf (fp, ", \"bit_%d\": %lld", k, (long long) count);
+    }
+
+  fprintf (fp, "},\n");
+
+
+  /*  The histogram without the empty bins at either end.  */
+
+  for (first = 0 ; first < summary->bin_count && !summary->histogram[first] ; first++);
+  for (last = summary->bin_count - 1 ; last >= first && !summary->histogram[last] ; last--);
+
+  fprintf (fp, "  \"histogram\": {\"bin_size\": %.9g, \"first_bin_z\": %.9g, \"outside\": %lld, \"counts\": [",
+           summary->bin_size, (first <= last) ? (double) (summary->first_bin + first) * summary->bin_size : 0.0,
+           (long long) summary->outside);
+
+  for (i = first ; i <= last ; i++)
+    {
+      fprintf (fp, "%s%s%lld", (i > first) ? "," : "", ((i - first) % 16) ? " " : "\n    ", (long long) summary->histogram[i]);
+    }
+
+  fprintf (fp, "%s]},\n", (first <= last) ? "\n  " : "");
+
+
+  /*  Cells that came from each input file.  */
+
+  fprintf (fp, "  \"filled_cells\": %lld,\n", (long long) summary->rank_count[0]);
+  fprintf (fp, "  \"inputs\": [\n");
+
+  for (i = 0 ; i < summary->file_count ; i++)
+    {
+      fprintf (fp, "    {\"file\": ");
+      stats_json_string (fp, inputs->path[i]);
+      fprintf (fp, ", \"cells\": %lld}%s\n", (long long) summary->rank_count[i + 1], (i < summary->file_count - 1) ? "," : "");
+    }
+
+  fprintf (fp, "  ]\n}\n");
+
+  if (fclose (fp)) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+void output_summary_free (OUTPUT_SUMMARY *summary)
+{
+  free (summary->histogram);
+  free (summary->rank_count);
+
+  summary->histogram = NULL;
+  summary->rank_count = NULL;
+}
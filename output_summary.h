@@ -0,0 +1,73 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _OUTPUT_SUMMARY_H_
+#define _OUTPUT_SUMMARY_H_
+
+#include "chrtr2_merge.h"
+#include "input_files.h"
+#include "merge_grid.h"
+
+
+/*  Default Z histogram bin size (in Z units).  */
+
+#define         SUMMARY_BIN_SIZE 1.0
+
+
+/*  Most bins that the Z histogram can grow to.  Cells whose Z is too far from the rest to fit are only counted in outside.  */
+
+#define         SUMMARY_MAX_BINS 1048576
+
+
+/*  QA summary of the output grid for --summary-json.  It's built by the output writer from the rows on their way to the
+    output file so the output never has to be read back to get it.  Only cells with data are counted.  The histogram bins
+    are bin_size wide and bin k starts at Z (first_bin + k) * bin_size.  It starts out empty and grows to cover the data as
+    it's written.  The status is counted by its low and high bytes so each cell only costs two counter bumps, and the
+    count of each status bit is worked out when the summary is written.  */
+
+typedef struct
+{
+  int32_t            file_count;
+  int64_t            cells;
+  float              min_z;
+  float              max_z;
+  double             bin_size;
+  int64_t            first_bin;
+  int32_t            bin_count;
+  int64_t            *histogram;
+  int64_t            outside;
+  int64_t            status_low[256];
+  int64_t            status_high[256];
+  int64_t            *rank_count;     /*  Cells from each input file (by rank, 0 is filled in by the regrid)  */
+} OUTPUT_SUMMARY;
+
+
+uint8_t output_summary_init (OUTPUT_SUMMARY *summary, int32_t file_count, double bin_size);
+void output_summary_add (OUTPUT_SUMMARY *summary, CHRTR2_RECORD *records, GRID_RANK *rank, int32_t count, float min_z,
+                         float max_z);
+uint8_t output_summary_write_json (OUTPUT_SUMMARY *summary, char *path, INPUT_FILES *inputs, char *output_file,
+                                   CHRTR2_HEADER *output_header);
+void output_summary_free (OUTPUT_SUMMARY *summary);
+
+
+#endif
@@ -0,0 +1,512 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "output_writer.h"
+#include "chrtr2_handles.h"
+
+
+/*  Add the cells with data in columns start through end - 1 of records (with source ranks rank) of merge grid row row to
+    the range of the data written (and of its band) and the summary.  This is done to each run on its way to the output
+    file while it's still in the cache.  The range loop has no branches in it (cells without data are replaced by the
+    current minimum or maximum) so it doesn't stall on the mix of empty and full cells.  */
+
+static void update_range (OUTPUT_WRITER *writer, int32_t row, CHRTR2_RECORD *records, GRID_RANK *rank, int32_t start, int32_t end)
+{
+  int32_t            k, band;
+  float              min_z, max_z, low, high;
+
+
+  min_z = 9999999999.0;
+  max_z = -9999999999.0;
+
+  for (k = start ; k < end ; k++)
+    {
+      low = records[k].status ? records[k].z : min_z;
+      high = records[k].status ? records[k].z : max_z;
+
+      min_z = MIN (low, min_z);
+      max_z = MAX (high, max_z);
+    }
+
+  writer->min_z = MIN (min_z, writer->min_z);
+  writer->max_z = MAX (max_z, writer->max_z);
+
+  if (writer->band_min_z != NULL)
+    {
+      band = row / writer->band_rows;
+      writer->band_min_z[band] = MIN (min_z, writer->band_min_z[band]);
+      writer->band_max_z[band] = MAX (max_z, writer->band_max_z[band]);
+    }
+
+  if (writer->summary != NULL) output_summary_add (writer->summary, &records[start], &rank[start], end - start, min_z, max_z);
+}
+
+
+
+/*  Write count records (with source ranks rank) to output row row starting at column col of the output file (or copy them
+    into the in-memory grid), the raster outputs, and the pyramid.  Returns nonzero if the write failed.  */
+
+static int32_t write_records (OUTPUT_WRITER *writer, int32_t row, int32_t col, int32_t count, CHRTR2_RECORD *records, GRID_RANK *rank)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < writer->raster_count ; i++) raster_output_cells (writer->raster[i], col, count, records, rank);
+
+  if (writer->pyramid != NULL) pyramid_cells (writer->pyramid, col, count, records);
+
+  if (writer->grid == NULL) return (chrtr2_write_record_row (writer->handle, row, col, count, records));
+
+  memcpy (&writer->grid[(size_t) row * (size_t) writer->grid_width + col], records, count * sizeof (CHRTR2_RECORD));
+
+  return (0);
+}
+
+
+
+/*  Write the part of merge grid row row that is in the area to the area's output file.  Returns the number of cells
+    written (or -1 if the write failed).  */
+
+static int64_t write_area_row (OUTPUT_WRITER *writer, WRITE_ROW *row)
+{
+  AREA               *area = writer->area;
+  int32_t            i, j, out_row, start, end, span_start, span_end, first, last;
+  int64_t            cells = 0;
+
+
+  out_row = row->row - area->y;
+  if (out_row < 0 || out_row >= area->header.height) return (0);
+
+  for (i = 0 ; i < row->run_count ; i++)
+    {
+      /*  Output file columns of the run.  Without a polygon the whole row is one span.  */
+
+      start = MAX (row->run[2 * i] - area->x, 0);
+      end = MIN (row->run[2 * i + 1] - area->x, area->header.width);
+
+      span_start = area->polygon_count ? area->row_span[out_row] : 0;
+      span_end = area->polygon_count ? area->row_span[out_row + 1] : 1;
+
+      for (j = span_start ; j < span_end ; j++)
+        {
+          first = area->polygon_count ? MAX (start, area->span[2 * j]) : start;
+          last = area->polygon_count ? MIN (end, area->span[2 * j + 1]) : end;
+          if (first >= last) continue;
+
+          update_range (writer, row->row, row->records, row->rank, first + area->x, last + area->x);
+
+          if (write_records (writer, out_row, first, last - first, &row->records[first + area->x], &row->rank[first + area->x]))
+            return (-1);
+
+          cells += last - first;
+        }
+    }
+
+  return (cells);
+}
+
+
+
+/*  Write the row that has been built in each raster output (and add it to the pyramid) as output row out_row.  Returns
+    NVFalse if a write failed.  */
+
+static uint8_t write_rasters (OUTPUT_WRITER *writer, int32_t out_row)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < writer->raster_count ; i++)
+    {
+      if (!raster_output_row (writer->raster[i], out_row))
+        {
+          writer->failed_row = out_row;
+          strcpy (writer->error, writer->raster[i]->error);
+          return (NVFalse);
+        }
+    }
+
+  if (writer->pyramid != NULL && !pyramid_row (writer->pyramid, out_row))
+    {
+      writer->failed_row = out_row;
+      strcpy (writer->error, writer->pyramid->error);
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Get everything that has been written so far onto the disk.  The library doesn't have a flush so we close the output
+    file (which flushes its buffers), sync it, and open it again.  This runs on the writer thread while decoder threads (and
+    the other merges in a batch) are opening and closing files so both go through chrtr2_handles.  Returns NVFalse if the
+    file couldn't be opened again.  */
+
+static uint8_t sync_output (OUTPUT_WRITER *writer)
+{
+  CHRTR2_HEADER      header;
+  int                fd;
+
+
+  chrtr2_handles_close (writer->handle);
+
+  if ((fd = open (writer->path, O_RDONLY)) >= 0)
+    {
+      fsync (fd);
+      close (fd);
+    }
+
+  writer->handle = chrtr2_handles_open (writer->path, &header, CHRTR2_UPDATE);
+
+  return (writer->handle >= 0);
+}
+
+
+
+static void *writer_thread (void *arg)
+{
+  OUTPUT_WRITER      *writer = (OUTPUT_WRITER *) arg;
+  WRITE_ROW          *row;
+  int32_t            i;
+  int64_t            cells;
+  STATS_TIMER        timer;
+
+
+  while (NVTrue)
+    {
+      pthread_mutex_lock (&writer->mutex);
+
+      while (!writer->count && !writer->done) pthread_cond_wait (&writer->cond, &writer->mutex);
+
+      if (!writer->count)
+        {
+          pthread_mutex_unlock (&writer->mutex);
+          break;
+        }
+
+      row = &writer->queue[writer->head];
+
+      pthread_mutex_unlock (&writer->mutex);
+
+
+      /*  Once a write has failed there's no point in writing anything else but we still have to drain the queue.  */
+
+      stats_start (writer->stats, &timer);
+
+      cells = 0;
+
+
+      /*  A checkpoint mark.  Everything queued before it has been written.  */
+
+      if (row->mark >= 0)
+        {
+          if (writer->failed_row < 0)
+            {
+              if (sync_output (writer))
+                {
+                  (*writer->checkpoint) (writer->checkpoint_data, row->mark, writer->min_z, writer->max_z);
+                }
+              else
+                {
+                  writer->failed_row = row->mark;
+                  strncpy (writer->error, chrtr2_strerror (), sizeof (writer->error) - 1);
+                }
+            }
+        }
+
+      else if (writer->area != NULL)
+        {
+          if (writer->failed_row < 0 && (cells = write_area_row (writer, row)) < 0)
+            {
+              writer->failed_row = row->row - writer->area->y;
+              strncpy (writer->error, chrtr2_strerror (), sizeof (writer->error) - 1);
+              cells = 0;
+            }
+
+          if (writer->failed_row < 0 && (writer->raster_count || writer->pyramid != NULL) && row->row >= writer->area->y &&
+              row->row < writer->area->y + writer->area->header.height) write_rasters (writer, row->row - writer->area->y);
+        }
+
+      else
+        {
+          for (i = 0 ; i < row->run_count && writer->failed_row < 0 ; i++)
+            {
+              cells += row->run[2 * i + 1] - row->run[2 * i];
+
+              update_range (writer, row->row, row->records, row->rank, row->run[2 * i], row->run[2 * i + 1]);
+
+              if (write_records (writer, row->row, row->run[2 * i], row->run[2 * i + 1] - row->run[2 * i], &row->records[row->run[2 * i]],
+                                 &row->rank[row->run[2 * i]]))
+                {
+                  writer->failed_row = row->row;
+                  strncpy (writer->error, chrtr2_strerror (), sizeof (writer->error) - 1);
+                }
+            }
+
+          if (writer->failed_row < 0 && (writer->raster_count || writer->pyramid != NULL)) write_rasters (writer, row->row);
+        }
+
+      stats_stop (writer->stats, &timer, STATS_WRITE, -1, cells, cells * sizeof (CHRTR2_RECORD));
+
+
+      pthread_mutex_lock (&writer->mutex);
+      writer->head = (writer->head + 1) % WRITE_QUEUE_ROWS;
+      writer->count--;
+      pthread_cond_broadcast (&writer->cond);
+      pthread_mutex_unlock (&writer->mutex);
+    }
+
+  return (NULL);
+}
+
+
+
+/*  Set up the queue and start the writer thread for an open CHRTR2 file that is width columns wide (or, if area isn't
+    NULL, for the area's output file from a merge grid that is width columns wide).  The write times go to stats if it
+    isn't NULL.  Returns NVFalse (with nothing left allocated) if we couldn't allocate the queue or start the thread.  */
+
+uint8_t output_writer_start (OUTPUT_WRITER *writer, int32_t handle, int32_t width, AREA *area, MERGE_STATS *stats)
+{
+  int32_t            i;
+
+
+  memset (writer, 0, sizeof (OUTPUT_WRITER));
+
+  writer->handle = handle;
+  writer->width = width;
+  writer->area = area;
+  writer->stats = stats;
+  writer->failed_row = -1;
+  writer->min_z = 9999999999.0;
+  writer->max_z = -9999999999.0;
+
+  for (i = 0 ; i < WRITE_QUEUE_ROWS ; i++)
+    {
+      writer->queue[i].records = (CHRTR2_RECORD *) calloc (width, sizeof (CHRTR2_RECORD));
+      writer->queue[i].rank = (GRID_RANK *) calloc (width, sizeof (GRID_RANK));
+      writer->queue[i].run = (int32_t *) malloc ((size_t) (width / 2 + 1) * 2 * sizeof (int32_t));
+      if (writer->queue[i].records == NULL || writer->queue[i].rank == NULL || writer->queue[i].run == NULL) break;
+    }
+
+  pthread_mutex_init (&writer->mutex, NULL);
+  pthread_cond_init (&writer->cond, NULL);
+
+  if (i < WRITE_QUEUE_ROWS || pthread_create (&writer->thread, NULL, writer_thread, writer))
+    {
+      pthread_mutex_destroy (&writer->mutex);
+      pthread_cond_destroy (&writer->cond);
+
+      for (i = 0 ; i < WRITE_QUEUE_ROWS ; i++)
+        {
+          free (writer->queue[i].records);
+          free (writer->queue[i].rank);
+          free (writer->queue[i].run);
+        }
+
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Return the width records of the next output row to be filled in, waiting for the writer to free one up if the queue is
+    full.  The row isn't written until its runs have been added with output_writer_run and it's been queued with
+    output_writer_queue.  */
+
+CHRTR2_RECORD *output_writer_next (OUTPUT_WRITER *writer)
+{
+  WRITE_ROW          *row;
+
+
+  pthread_mutex_lock (&writer->mutex);
+
+  while (writer->count == WRITE_QUEUE_ROWS) pthread_cond_wait (&writer->cond, &writer->mutex);
+
+  row = &writer->queue[writer->tail];
+
+  pthread_mutex_unlock (&writer->mutex);
+
+  row->run_count = 0;
+  row->mark = -1;
+
+  return (row->records);
+}
+
+
+
+/*  Return the source ranks of the row from output_writer_next (to be filled in with the records), or NULL if nothing
+    needs them.  */
+
+GRID_RANK *output_writer_rank (OUTPUT_WRITER *writer)
+{
+  if (!writer->raster_count && writer->summary == NULL) return (NULL);
+
+  return (writer->queue[writer->tail].rank);
+}
+
+
+
+/*  Write columns start_col through end_col - 1 of the row from output_writer_next.  Runs have to be added left to right
+    and can't overlap.  */
+
+void output_writer_run (OUTPUT_WRITER *writer, int32_t start_col, int32_t end_col)
+{
+  WRITE_ROW          *row = &writer->queue[writer->tail];
+
+
+  if (start_col >= end_col) return;
+
+  row->run[2 * row->run_count] = start_col;
+  row->run[2 * row->run_count + 1] = end_col;
+  row->run_count++;
+}
+
+
+
+/*  Hand the row from output_writer_next to the writer thread as output row row.  */
+
+void output_writer_queue (OUTPUT_WRITER *writer, int32_t row)
+{
+  pthread_mutex_lock (&writer->mutex);
+
+  writer->queue[writer->tail].row = row;
+  writer->tail = (writer->tail + 1) % WRITE_QUEUE_ROWS;
+  writer->count++;
+
+  pthread_cond_broadcast (&writer->cond);
+  pthread_mutex_unlock (&writer->mutex);
+}
+
+
+
+/*  Have the writer sync the output file to disk and call the checkpoint function with mark (and the range of the data
+    written so far) once everything that has been queued up to now is on the disk.  output_writer_checkpoints has to have
+    been called first.  */
+
+void output_writer_mark (OUTPUT_WRITER *writer, int32_t mark)
+{
+  output_writer_next (writer);
+
+  writer->queue[writer->tail].mark = mark;
+
+  output_writer_queue (writer, -1);
+}
+
+
+
+/*  Copy the output rows into grid (grid_width records per output row) instead of writing them to the output file.  This
+    has to be called before any rows are queued.  */
+
+void output_writer_memory (OUTPUT_WRITER *writer, CHRTR2_RECORD *grid, int32_t grid_width)
+{
+  writer->grid = grid;
+  writer->grid_width = grid_width;
+}
+
+
+
+/*  Also write the output rows to raster (which has to be open for the output file's grid).  This has to be called before
+    any rows are queued.  */
+
+void output_writer_raster (OUTPUT_WRITER *writer, RASTER_OUTPUT *raster)
+{
+  writer->raster[writer->raster_count++] = raster;
+}
+
+
+
+/*  Also build the overview pyramid (which has to be open for the output file's grid) from the output rows.  This has to
+    be called before any rows are queued.  */
+
+void output_writer_pyramid (OUTPUT_WRITER *writer, PYRAMID *pyramid)
+{
+  writer->pyramid = pyramid;
+}
+
+
+
+/*  Also add the output rows to summary.  This has to be called before any rows are queued.  */
+
+void output_writer_summary (OUTPUT_WRITER *writer, OUTPUT_SUMMARY *summary)
+{
+  writer->summary = summary;
+}
+
+
+
+/*  Also add the range of the data written in each band of band_rows merge grid rows to min_z and max_z (which have to have
+    room for all of the bands).  This has to be called before any rows are queued.  */
+
+void output_writer_bands (OUTPUT_WRITER *writer, int32_t band_rows, float *min_z, float *max_z)
+{
+  writer->band_rows = band_rows;
+  writer->band_min_z = min_z;
+  writer->band_max_z = max_z;
+}
+
+
+
+/*  Turn on checkpoint marks.  The writer opens the output file (path) again after each sync and calls checkpoint with data,
+    the mark, and the range of the data written so far.  */
+
+void output_writer_checkpoints (OUTPUT_WRITER *writer, char *path, WRITER_CHECKPOINT checkpoint, void *data)
+{
+  strcpy (writer->path, path);
+  writer->checkpoint = checkpoint;
+  writer->checkpoint_data = data;
+}
+
+
+
+/*  Wait for everything that has been queued to be written and free the queue.  Returns NVFalse if any row couldn't be
+    written (failed_row and error say why).  */
+
+uint8_t output_writer_finish (OUTPUT_WRITER *writer)
+{
+  int32_t            i;
+
+
+  pthread_mutex_lock (&writer->mutex);
+  writer->done = NVTrue;
+  pthread_cond_broadcast (&writer->cond);
+  pthread_mutex_unlock (&writer->mutex);
+
+  pthread_join (writer->thread, NULL);
+
+  pthread_mutex_destroy (&writer->mutex);
+  pthread_cond_destroy (&writer->cond);
+
+  for (i = 0 ; i < WRITE_QUEUE_ROWS ; i++)
+    {
+      free (writer->queue[i].records);
+      free (writer->queue[i].rank);
+      free (writer->queue[i].run);
+    }
+
+  return (writer->failed_row < 0);
+}
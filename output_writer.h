@@ -0,0 +1,124 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _OUTPUT_WRITER_H_
+#define _OUTPUT_WRITER_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "area.h"
+#include "merge_grid.h"
+#include "output_summary.h"
+#include "pyramid.h"
+#include "raster_output.h"
+#include "stats.h"
+
+
+/*  Number of output rows that can be waiting to be written before the merge has to wait for the writer to catch up.  */
+
+#define         WRITE_QUEUE_ROWS 8
+
+
+/*  Most raster outputs (--gtiff and --raw) that are written along with the output file.  */
+
+#define         MAX_RASTER_OUTPUTS 2
+
+
+/*  One queued output row.  Only the runs of columns run[2*i] through run[2*i+1] - 1 are written (the rest of the row is
+    left alone, the same as never writing those cells).  A row with a mark isn't written, it's a checkpoint.  */
+
+typedef struct
+{
+  int32_t            row;
+  int32_t            mark;            /*  Checkpoint mark (-1 for an output row)  */
+  int32_t            run_count;
+  int32_t            *run;            /*  Start and end column of each run  */
+  CHRTR2_RECORD      *records;        /*  width records indexed by column  */
+  GRID_RANK          *rank;           /*  Source rank of each record (only filled in for raster outputs and the summary)  */
+} WRITE_ROW;
+
+
+/*  Called by the writer thread when a checkpoint mark has been reached and the output file is on the disk.  */
+
+typedef void (*WRITER_CHECKPOINT) (void *data, int32_t mark, float min_z, float max_z);
+
+
+/*  Buffered writer for the output CHRTR2 file.  The merge fills rows of records and queues them and a separate thread
+    writes them with the library's row writer so that the disk writes overlap the merging and regridding.  Nothing else
+    may touch the output handle between output_writer_start and output_writer_finish.  With --area the rows are merge grid
+    rows and only the cells that are in the area are written (to the area's output file).  With checkpoints the writer
+    closes and opens the output file again so handle can change (it's only safe to use after output_writer_finish).  The
+    rows can go to an in-memory grid instead of the output file (see output_writer_memory) and the same rows can also be
+    written to raster outputs (see output_writer_raster) and an overview pyramid (see output_writer_pyramid).  The range of
+    the data (and, with output_writer_summary, the QA summary) is gathered from the rows as they're written.  */
+
+typedef struct
+{
+  int32_t            handle;          /*  CHRTR2 handle of the output file  */
+  int32_t            width;           /*  Number of columns in the rows  */
+  AREA               *area;           /*  NULL unless --area  */
+  float              min_z;           /*  Range of the data written (the caller can start it off after output_writer_start)  */
+  float              max_z;
+  int32_t            band_rows;       /*  Merge grid rows in each band (see output_writer_bands)  */
+  float              *band_min_z;     /*  Range of the data written in each band (NULL if not wanted)  */
+  float              *band_max_z;
+  char               path[1024];      /*  Output file name (only needed for checkpoints)  */
+  CHRTR2_RECORD      *grid;           /*  In-memory output grid (NULL to write to the output file)  */
+  int32_t            grid_width;
+  RASTER_OUTPUT      *raster[MAX_RASTER_OUTPUTS];
+  int32_t            raster_count;
+  PYRAMID            *pyramid;        /*  NULL unless --pyramid  */
+  OUTPUT_SUMMARY     *summary;        /*  NULL unless --summary-json  */
+  WRITER_CHECKPOINT  checkpoint;
+  void               *checkpoint_data;
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cond;
+  pthread_t          thread;
+  WRITE_ROW          queue[WRITE_QUEUE_ROWS];
+  int32_t            head;            /*  Next row to be written  */
+  int32_t            tail;            /*  Next free row  */
+  int32_t            count;           /*  Number of rows queued  */
+  uint8_t            done;            /*  No more rows are coming  */
+  MERGE_STATS        *stats;
+  int32_t            failed_row;      /*  First row that couldn't be written (-1 if none)  */
+  char               error[512];      /*  Library error message for failed_row  */
+} OUTPUT_WRITER;
+
+
+uint8_t output_writer_start (OUTPUT_WRITER *writer, int32_t handle, int32_t width, AREA *area, MERGE_STATS *stats);
+CHRTR2_RECORD *output_writer_next (OUTPUT_WRITER *writer);
+GRID_RANK *output_writer_rank (OUTPUT_WRITER *writer);
+void output_writer_run (OUTPUT_WRITER *writer, int32_t start_col, int32_t end_col);
+void output_writer_queue (OUTPUT_WRITER *writer, int32_t row);
+void output_writer_mark (OUTPUT_WRITER *writer, int32_t mark);
+void output_writer_memory (OUTPUT_WRITER *writer, CHRTR2_RECORD *grid, int32_t grid_width);
+void output_writer_raster (OUTPUT_WRITER *writer, RASTER_OUTPUT *raster);
+void output_writer_pyramid (OUTPUT_WRITER *writer, PYRAMID *pyramid);
+void output_writer_summary (OUTPUT_WRITER *writer, OUTPUT_SUMMARY *summary);
+void output_writer_bands (OUTPUT_WRITER *writer, int32_t band_rows, float *min_z, float *max_z);
+void output_writer_checkpoints (OUTPUT_WRITER *writer, char *path, WRITER_CHECKPOINT checkpoint, void *data);
+uint8_t output_writer_finish (OUTPUT_WRITER *writer);
+
+
+#endif
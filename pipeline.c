@@ -0,0 +1,326 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "pipeline.h"
+#include "regrid.h"
+#include "verify.h"
+
+
+/*  The two grids that the pipeline stages pass back and forth.  A grid is either waiting to be filled by the merge stage
+    (tile -1) or holding tile number tile for the regrid stage.  */
+
+typedef struct
+{
+  MERGE              *merge;
+  MERGE_GRID         *grid;           /*  Two grids  */
+  MERGE_TILE         *tile;
+  int32_t            tile_count;
+  int32_t            ready[2];        /*  Tile that each grid holds (-1 if the grid is free)  */
+  uint8_t            quiet;           /*  The caller's merge->quiet (the band messages are the pipeline's progress)  */
+  uint8_t            failed;          /*  Either stage failed (the error is in merge) so both of them stop  */
+  pthread_mutex_t    mutex;
+  pthread_cond_t     cond;
+} PIPELINE;
+
+
+
+/*  Start reading the input files for tile (plus halo rows above and below it) with thread_count decoder threads.  Returns
+    NVFalse (with the error in merge) if it failed.  */
+
+static uint8_t read_tile (MERGE *merge, MERGE_READ *read, MERGE_TILE *tile, int32_t halo, int32_t thread_count)
+{
+  int32_t            start;
+
+
+  start = MAX (tile->start_row - halo, 0);
+
+  return (merge_read_start (merge, read, start, MIN (tile->end_row + halo, merge->output_header.height) - start, thread_count));
+}
+
+
+
+/*  Merge tile (plus halo rows above and below it) into grid.  If read isn't NULL the reads of the tile were already started
+    with read_tile (and read is freed).  Returns NVFalse (with the error in merge) if it failed.  */
+
+static uint8_t merge_tile (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, int32_t halo, MERGE_READ *read)
+{
+  int32_t            start;
+
+
+  start = MAX (tile->start_row - halo, 0);
+  merge_grid_reset (grid, start, MIN (tile->end_row + halo, merge->output_header.height) - start);
+
+  if (!(read == NULL ? merge_insert (merge, grid) : merge_insert_read (merge, grid, read))) return (NVFalse);
+
+  if (merge->verify) return (merge_verify (merge, grid, tile->start_row, tile->end_row));
+
+  return (NVTrue);
+}
+
+
+
+/*  Regrid (or not) the rows of tile that are in grid and write them to the output file.  If whole is set the grid holds
+    the entire output file so we do the single MISP pass that we've always done.  Returns NVFalse (with the error in merge)
+    if the regrid failed.  */
+
+static uint8_t output_tile (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, uint8_t whole)
+{
+  if (merge->regrid)
+    {
+      if (merge->holes_only)
+        {
+          return (merge_regrid_holes (merge, grid, tile->start_row, tile->end_row, merge->regrid_workers));
+        }
+      else if (merge->regrid_workers > 1)
+        {
+          return (merge_regrid_parallel (merge, grid, tile->start_row, tile->end_row, merge->regrid_workers));
+        }
+      else if (!whole)
+        {
+          return (merge_regrid (merge, grid, MAX (tile->start_row - REGRID_HALO, 0),
+                                MIN (tile->end_row + REGRID_HALO, merge->output_header.height), tile->start_row, tile->end_row));
+        }
+      else
+        {
+          return (merge_regrid (merge, grid, 0, merge->output_header.height, 0, merge->output_header.height));
+        }
+    }
+
+  merge_write (merge, grid, tile->start_row, tile->end_row);
+
+  return (NVTrue);
+}
+
+
+
+/*  Everything in tile has been handed to the output writer.  Mark a checkpoint and tell the caller.  */
+
+static void tile_done (MERGE *merge, MERGE_TILE *tile)
+{
+  if (merge->checkpoint) output_writer_mark (&merge->writer, tile->end_row);
+
+  merge->done_rows += tile->end_row - tile->start_row;
+
+  if (merge->progress != NULL) (*merge->progress) (merge->progress_data, merge->done_rows, merge->total_rows);
+}
+
+
+
+/*  Merge and write the tiles one after the other using one grid.  Returns NVFalse (with the error in merge) if any of them
+    failed.  */
+
+uint8_t merge_tiles (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, int32_t tile_count, int32_t halo, uint8_t whole)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < tile_count ; i++)
+    {
+      if (tile_count > 1 && !merge->quiet)
+        {
+          fprintf (stderr, "Tile %d of %d (output rows %d to %d)\n\n", i + 1, tile_count, tile[i].start_row, tile[i].end_row - 1);
+          fflush (stderr);
+        }
+
+      if (!merge_tile (merge, grid, &tile[i], halo, NULL) || !output_tile (merge, grid, &tile[i], whole)) return (NVFalse);
+
+      tile_done (merge, &tile[i]);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  The regrid stage.  Regrids and writes the tiles in order as the merge stage hands them over.  Stops if either stage
+    fails.  */
+
+static void *regrid_thread (void *arg)
+{
+  PIPELINE           *pipeline = (PIPELINE *) arg;
+  int32_t            i, g;
+
+
+  for (i = 0 ; i < pipeline->tile_count ; i++)
+    {
+      g = i % 2;
+
+      pthread_mutex_lock (&pipeline->mutex);
+      while (pipeline->ready[g] != i && !pipeline->failed) pthread_cond_wait (&pipeline->cond, &pipeline->mutex);
+      pthread_mutex_unlock (&pipeline->mutex);
+
+      if (pipeline->failed) break;
+
+
+      if (!output_tile (pipeline->merge, &pipeline->grid[g], &pipeline->tile[i], NVFalse))
+        {
+          pthread_mutex_lock (&pipeline->mutex);
+          pipeline->failed = NVTrue;
+          pthread_cond_broadcast (&pipeline->cond);
+          pthread_mutex_unlock (&pipeline->mutex);
+          break;
+        }
+
+      tile_done (pipeline->merge, &pipeline->tile[i]);
+
+      if (!pipeline->quiet)
+        {
+          fprintf (stderr, "Band %d of %d (output rows %d to %d) written\n", i + 1, pipeline->tile_count, pipeline->tile[i].start_row,
+                   pipeline->tile[i].end_row - 1);
+          fflush (stderr);
+        }
+
+
+      pthread_mutex_lock (&pipeline->mutex);
+      pipeline->ready[g] = -1;
+      pthread_cond_broadcast (&pipeline->cond);
+      pthread_mutex_unlock (&pipeline->mutex);
+    }
+
+  return (NULL);
+}
+
+
+
+/*  Merge and write the tiles as a pipeline of bands with three stages.  While the regrid stage (its own thread) regrids
+    and writes band k - 1 from one grid the merge stage (the calling thread) composites band k into the other grid, and the
+    read stage (the input decoder threads of band k + 1, started as band k's compositing starts) reads ahead into its own
+    buffers.  The grids are the one band queues between the merge and regrid stages and the decoders never get more than
+    their thread count of files ahead, so everything held at once is bounded.  The output writer thread writes under all of
+    them.  Each band is merged and regridded with its full halo so the output is the same as merge_tiles on the same tiles.
+    grid has to be two grids that can each hold a tile plus its halo.  Returns NVFalse (with the error in merge) if any
+    stage failed.  */
+
+uint8_t merge_pipeline (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, int32_t tile_count, int32_t halo)
+{
+  PIPELINE           pipeline;
+  pthread_t          thread;
+  MERGE_READ         read[2];
+  int32_t            i, g, read_threads;
+
+
+  pipeline.merge = merge;
+  pipeline.grid = grid;
+  pipeline.tile = tile;
+  pipeline.tile_count = tile_count;
+  pipeline.ready[0] = pipeline.ready[1] = -1;
+  pipeline.quiet = merge->quiet;
+  pipeline.failed = NVFalse;
+
+  pthread_mutex_init (&pipeline.mutex, NULL);
+  pthread_cond_init (&pipeline.cond, NULL);
+
+
+  /*  The stages run at the same time so their progress meters would just step on each other.  */
+
+  merge->quiet = NVTrue;
+
+  if (pthread_create (&thread, NULL, regrid_thread, &pipeline))
+    {
+      merge_error (merge, MERGE_ERROR_THREAD, "Starting regrid stage in pipeline.c: %s", strerror (errno));
+
+      pthread_mutex_destroy (&pipeline.mutex);
+      pthread_cond_destroy (&pipeline.cond);
+
+      merge->quiet = pipeline.quiet;
+
+      return (NVFalse);
+    }
+
+
+  /*  The read stage always has at least one decoder thread so it can run ahead of the merge stage.  */
+
+  read_threads = MAX (merge->thread_count, 1);
+
+  read[0].list = read[1].list = NULL;
+
+  if (tile_count && !read_tile (merge, &read[0], &tile[0], halo, read_threads))
+    {
+      pthread_mutex_lock (&pipeline.mutex);
+      pipeline.failed = NVTrue;
+      pthread_cond_broadcast (&pipeline.cond);
+      pthread_mutex_unlock (&pipeline.mutex);
+    }
+
+  for (i = 0 ; i < tile_count && !pipeline.failed ; i++)
+    {
+      g = i % 2;
+
+
+      /*  Wait for the regrid stage to finish with the band that was in this grid.  */
+
+      pthread_mutex_lock (&pipeline.mutex);
+      while (pipeline.ready[g] >= 0 && !pipeline.failed) pthread_cond_wait (&pipeline.cond, &pipeline.mutex);
+      pthread_mutex_unlock (&pipeline.mutex);
+
+      if (pipeline.failed) break;
+
+
+      /*  Start reading the next band while this one is composited.  */
+
+      if ((i + 1 < tile_count && !read_tile (merge, &read[(i + 1) % 2], &tile[i + 1], halo, read_threads)) ||
+          !merge_tile (merge, &grid[g], &tile[i], halo, &read[g]))
+        {
+          pthread_mutex_lock (&pipeline.mutex);
+          pipeline.failed = NVTrue;
+          pthread_cond_broadcast (&pipeline.cond);
+          pthread_mutex_unlock (&pipeline.mutex);
+          break;
+        }
+
+      if (!pipeline.quiet)
+        {
+          fprintf (stderr, "Band %d of %d (output rows %d to %d) merged\n", i + 1, tile_count, tile[i].start_row, tile[i].end_row - 1);
+          fflush (stderr);
+        }
+
+
+      pthread_mutex_lock (&pipeline.mutex);
+      pipeline.ready[g] = i;
+      pthread_cond_broadcast (&pipeline.cond);
+      pthread_mutex_unlock (&pipeline.mutex);
+    }
+
+  pthread_join (thread, NULL);
+
+
+  /*  If a stage failed there may be reads that were started and never used.  */
+
+  merge_read_free (&read[0]);
+  merge_read_free (&read[1]);
+
+  pthread_mutex_destroy (&pipeline.mutex);
+  pthread_cond_destroy (&pipeline.cond);
+
+  merge->quiet = pipeline.quiet;
+
+  if (pipeline.failed) return (NVFalse);
+
+  if (!merge->quiet)
+    {
+      fprintf (stderr, "\n");
+      fflush (stderr);
+    }
+
+  return (NVTrue);
+}
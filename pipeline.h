@@ -0,0 +1,52 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "merge.h"
+#include "merge_grid.h"
+
+
+/*  Number of output rows in each band when --pipeline is used without a memory limit.  */
+
+#define         PIPELINE_BAND_ROWS 1024
+
+
+/*  Output rows start_row through end_row - 1 are merged and written as one tile.  */
+
+typedef struct
+{
+  int32_t            start_row;
+  int32_t            end_row;
+} MERGE_TILE;
+
+
+uint8_t merge_tiles (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, int32_t tile_count, int32_t halo, uint8_t whole);
+uint8_t merge_pipeline (MERGE *merge, MERGE_GRID *grid, MERGE_TILE *tile, int32_t tile_count, int32_t halo);
+
+
+#endif
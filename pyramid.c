@@ -0,0 +1,297 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "pyramid.h"
+
+
+/*  Add a cell with Z value z and status status to sum.  */
+
+static void add_cell (PYRAMID_SUM *sum, float z, uint16_t status)
+{
+  int32_t            k;
+
+
+  k = (status & HARD_DATA) ? 0 : 1;
+
+  if (!sum->count[k])
+    {
+      sum->min_z[k] = sum->max_z[k] = z;
+    }
+  else
+    {
+      sum->min_z[k] = MIN (sum->min_z[k], z);
+      sum->max_z[k] = MAX (sum->max_z[k], z);
+    }
+
+  sum->sum[k] += z;
+  sum->count[k]++;
+  sum->status |= status;
+}
+
+
+
+/*  Add the block in from (a cell of the level below) to sum.  Only the data that the cell shows (the hard data if it has
+    any) goes up a level.  */
+
+static void add_block (PYRAMID_SUM *sum, PYRAMID_SUM *from)
+{
+  int32_t            k;
+
+
+  sum->status |= from->status;
+
+  k = from->count[0] ? 0 : 1;
+  if (!from->count[k]) return;
+
+  if (!sum->count[k])
+    {
+      sum->min_z[k] = from->min_z[k];
+      sum->max_z[k] = from->max_z[k];
+    }
+  else
+    {
+      sum->min_z[k] = MIN (sum->min_z[k], from->min_z[k]);
+      sum->max_z[k] = MAX (sum->max_z[k], from->max_z[k]);
+    }
+
+  sum->sum[k] += from->sum[k];
+  sum->count[k] += from->count[k];
+}
+
+
+
+/*  Row row of level is complete.  Write it to the file (level 0 is the output grid so it isn't stored), add it to the
+    next level, and finish the row of the next level if this was the last row that goes into it.  If empty is set the row
+    never had any data (sum[level] may already be holding the next row) so only the next level is checked.  Returns
+    NVFalse if the write failed.  */
+
+static uint8_t finish_row (PYRAMID *pyramid, int32_t level, int32_t row, uint8_t empty)
+{
+  int32_t            j, k, width;
+  PYRAMID_SUM        *sum;
+  PYRAMID_CELL       *cell;
+
+
+  width = pyramid->level_width[level];
+  sum = pyramid->sum[level];
+
+  if (!empty)
+    {
+      if (level)
+        {
+          for (j = 0 ; j < width ; j++)
+            {
+              cell = &pyramid->cells[j];
+              memset (cell, 0, sizeof (PYRAMID_CELL));
+
+              cell->status = sum[j].status;
+
+              k = sum[j].count[0] ? 0 : 1;
+              if (!sum[j].count[k]) continue;
+
+              cell->min_z = sum[j].min_z[k];
+              cell->max_z = sum[j].max_z[k];
+              cell->mean_z = (float) (sum[j].sum[k] / (double) sum[j].count[k]);
+              cell->count = sum[j].count[k];
+            }
+
+          if (fseeko (pyramid->fp, (off_t) (pyramid->offset[level] + (int64_t) row * (int64_t) width * sizeof (PYRAMID_CELL)), SEEK_SET) ||
+              fwrite (pyramid->cells, sizeof (PYRAMID_CELL), width, pyramid->fp) != (size_t) width)
+            {
+              strcpy (pyramid->error, strerror (errno));
+              return (NVFalse);
+            }
+        }
+
+      if (level < pyramid->level_count)
+        {
+          for (j = 0 ; j < width ; j++) add_block (&pyramid->sum[level + 1][j / 2], &sum[j]);
+        }
+
+      memset (sum, 0, width * sizeof (PYRAMID_SUM));
+    }
+
+  if (level < pyramid->level_count && ((row & 1) || row == pyramid->level_height[level] - 1))
+    return (finish_row (pyramid, level + 1, row / 2, NVFalse));
+
+  return (NVTrue);
+}
+
+
+
+/*  pyramid_open failed.  Save why in error, close the file (if it was created), and free whatever was allocated.
+    Returns NVFalse.  */
+
+static uint8_t open_failed (PYRAMID *pyramid)
+{
+  int32_t            k;
+
+
+  strcpy (pyramid->error, strerror (errno));
+
+  if (pyramid->fp != NULL)
+    {
+      fclose (pyramid->fp);
+      pyramid->fp = NULL;
+    }
+
+  for (k = 0 ; k <= pyramid->level_count ; k++)
+    {
+      free (pyramid->sum[k]);
+      pyramid->sum[k] = NULL;
+    }
+
+  free (pyramid->cells);
+  pyramid->cells = NULL;
+
+  return (NVFalse);
+}
+
+
+
+/*  Create the pyramid file for output_file (OUTPUT_FILE.pyramid) for an output grid with header and write its header.
+    Returns NVFalse (error says why) if it couldn't be created.  */
+
+uint8_t pyramid_open (PYRAMID *pyramid, char *output_file, CHRTR2_HEADER *header)
+{
+  int32_t            k, n;
+  int64_t            offset;
+  char               text[PYRAMID_HEADER_BYTES];
+
+
+  memset (pyramid, 0, sizeof (PYRAMID));
+
+  sprintf (pyramid->path, "%s.pyramid", output_file);
+
+  pyramid->width = pyramid->level_width[0] = header->width;
+  pyramid->height = pyramid->level_height[0] = header->height;
+
+
+  /*  Halve the grid until it fits in PYRAMID_TOP_SIZE.  */
+
+  for (k = 0 ; k < PYRAMID_MAX_LEVELS && MAX (pyramid->level_width[k], pyramid->level_height[k]) > PYRAMID_TOP_SIZE ; k++)
+    {
+      pyramid->level_width[k + 1] = (pyramid->level_width[k] + 1) / 2;
+      pyramid->level_height[k + 1] = (pyramid->level_height[k] + 1) / 2;
+    }
+
+  pyramid->level_count = k;
+
+
+  memset (text, 0, sizeof (text));
+
+  n = sprintf (text, "CHRTR2_MERGE PYRAMID 1\nGRID %d %d %.11f %.11f %.11f %.11f %.11f %.11f\nCELL_BYTES %d\nLEVELS %d\n",
+               header->width, header->height, header->mbr.slat, header->mbr.wlon, header->mbr.nlat, header->mbr.elon,
+               header->lat_grid_size_degrees, header->lon_grid_size_degrees, (int32_t) sizeof (PYRAMID_CELL), pyramid->level_count);
+
+  offset = PYRAMID_HEADER_BYTES;
+
+  for (k = 1 ; k <= pyramid->level_count ; k++)
+    {
+      pyramid->offset[k] = offset;
+
+      n += sprintf (&text[n], "LEVEL %d %d %d %d %lld\n", k, 1 << k, pyramid->level_width[k], pyramid->level_height[k],
+                    (long long) offset);
+
+      offset += (int64_t) pyramid->level_width[k] * (int64_t) pyramid->level_height[k] * sizeof (PYRAMID_CELL);
+    }
+
+
+  for (k = 0 ; k <= pyramid->level_count ; k++)
+    {
+      if ((pyramid->sum[k] = (PYRAMID_SUM *) calloc (pyramid->level_width[k], sizeof (PYRAMID_SUM))) == NULL)
+        return (open_failed (pyramid));
+    }
+
+  if ((pyramid->cells = (PYRAMID_CELL *) malloc (MAX (pyramid->level_width[1], 1) * sizeof (PYRAMID_CELL))) == NULL)
+    return (open_failed (pyramid));
+
+
+  if ((pyramid->fp = fopen (pyramid->path, "wb")) == NULL) return (open_failed (pyramid));
+
+  if (fwrite (text, PYRAMID_HEADER_BYTES, 1, pyramid->fp) != 1) return (open_failed (pyramid));
+
+  return (NVTrue);
+}
+
+
+
+/*  Add count records to the output row being built starting at column col.  */
+
+void pyramid_cells (PYRAMID *pyramid, int32_t col, int32_t count, CHRTR2_RECORD *records)
+{
+  int32_t            j;
+
+
+  for (j = 0 ; j < count ; j++)
+    {
+      if (records[j].status) add_cell (&pyramid->sum[0][col + j], records[j].z, records[j].status);
+    }
+}
+
+
+
+/*  The output row being built is output row row.  Rows have to come in order.  Any rows that were skipped (they had no
+    data written to them) are empty.  Returns NVFalse if a write failed (error says why).  */
+
+uint8_t pyramid_row (PYRAMID *pyramid, int32_t row)
+{
+  if (row < pyramid->next_row)
+    {
+      sprintf (pyramid->error, "Output row %d is out of order", row);
+      return (NVFalse);
+    }
+
+  for ( ; pyramid->next_row < row ; pyramid->next_row++)
+    {
+      if (!finish_row (pyramid, 0, pyramid->next_row, NVTrue)) return (NVFalse);
+    }
+
+  pyramid->next_row = row + 1;
+
+  return (finish_row (pyramid, 0, row, NVFalse));
+}
+
+
+
+/*  Finish the rows that were never written, close the file, and free everything.  Returns NVFalse if a write failed.  */
+
+uint8_t pyramid_close (PYRAMID *pyramid)
+{
+  int32_t            k;
+  uint8_t            ok = NVTrue;
+
+
+  for ( ; pyramid->next_row < pyramid->height && ok ; pyramid->next_row++) ok = finish_row (pyramid, 0, pyramid->next_row, NVTrue);
+
+  if (fclose (pyramid->fp) && ok)
+    {
+      strcpy (pyramid->error, strerror (errno));
+      ok = NVFalse;
+    }
+
+  for (k = 0 ; k <= pyramid->level_count ; k++) free (pyramid->sum[k]);
+  free (pyramid->cells);
+
+  return (ok);
+}
@@ -0,0 +1,113 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _PYRAMID_H_
+#define _PYRAMID_H_
+
+#include "chrtr2_merge.h"
+
+
+/*  Size of the text header at the start of a pyramid file.  */
+
+#define         PYRAMID_HEADER_BYTES 4096
+
+
+/*  Levels are added until the last one is no more than this many cells on a side.  */
+
+#define         PYRAMID_TOP_SIZE 256
+
+
+/*  Most levels that a pyramid can have.  */
+
+#define         PYRAMID_MAX_LEVELS 32
+
+
+/*  One cell of an overview level.  It covers a factor by factor block of output cells.  If any of them are hard data
+    (HARD_DATA) the Z values are of the hard data only, otherwise they're of all of the cells with data.  status is all of
+    the status bits of the block ORed together.  count is the number of cells that the Z values came from (0 if the
+    block has no data, in which case the Z values are 0).  */
+
+typedef struct
+{
+  float              min_z;
+  float              max_z;
+  float              mean_z;
+  uint32_t           count;
+  uint16_t           status;
+  uint16_t           spare;
+} PYRAMID_CELL;
+
+
+/*  Running totals of the hard data and the rest of the data for one cell of the level being built.  */
+
+typedef struct
+{
+  double             sum[2];          /*  [0] is the hard data, [1] is everything else  */
+  float              min_z[2];
+  float              max_z[2];
+  uint32_t           count[2];
+  uint16_t           status;
+} PYRAMID_SUM;
+
+
+/*  Overview pyramid (OUTPUT_FILE.pyramid) of the output grid.  Level k is the grid reduced by 2 to the k in each direction
+    (level 0 is the output grid itself and isn't stored).  It's built from the output rows as they're written, which have
+    to come in order.  Each level keeps one row of sums and, when the two rows of the level below that go into a row are
+    done, the row is written to the file and added to the next level, so a display only has to read the level that fits
+    its screen.
+
+    The file starts with a PYRAMID_HEADER_BYTES text header (zero padded):
+
+        CHRTR2_MERGE PYRAMID 1
+        GRID width height slat wlon nlat elon lat_grid_size lon_grid_size
+        CELL_BYTES bytes
+        LEVELS level_count
+        LEVEL k factor width height offset        (one line per level, offset in bytes from the start of the file)
+
+    followed by the levels, each width by height PYRAMID_CELLs in the byte order of the machine that wrote them, row 0
+    (south) first.  */
+
+typedef struct
+{
+  FILE               *fp;
+  char               path[1024];
+  int32_t            width;           /*  Output grid  */
+  int32_t            height;
+  int32_t            level_count;     /*  Not counting level 0  */
+  int32_t            level_width[PYRAMID_MAX_LEVELS + 1];
+  int32_t            level_height[PYRAMID_MAX_LEVELS + 1];
+  int64_t            offset[PYRAMID_MAX_LEVELS + 1];
+  PYRAMID_SUM        *sum[PYRAMID_MAX_LEVELS + 1];  /*  Row of sums being built for each level (sum[0] is the output row)  */
+  PYRAMID_CELL       *cells;          /*  Finished row of the level being written  */
+  int32_t            next_row;        /*  Next output row expected  */
+  char               error[512];      /*  Why a write failed  */
+} PYRAMID;
+
+
+uint8_t pyramid_open (PYRAMID *pyramid, char *output_file, CHRTR2_HEADER *header);
+void pyramid_cells (PYRAMID *pyramid, int32_t col, int32_t count, CHRTR2_RECORD *records);
+uint8_t pyramid_row (PYRAMID *pyramid, int32_t row);
+uint8_t pyramid_close (PYRAMID *pyramid);
+
+
+#endif
@@ -0,0 +1,240 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include <pthread.h>
+
+#include "gdal.h"
+#include "cpl_string.h"
+#include "ogr_srs_api.h"
+
+#include "raster_output.h"
+
+
+/*  Size of the GeoTIFF tiles.  */
+
+#define         RASTER_TILE_SIZE 256
+
+
+static pthread_once_t gdal_once = PTHREAD_ONCE_INIT;
+
+static char *band_name[3] = {"z", "status", "rank"};
+
+
+
+static void register_drivers ()
+{
+  GDALAllRegister ();
+}
+
+
+
+/*  Set all of the cells of the row buffers to RASTER_NULL.  */
+
+static void clear_row (RASTER_OUTPUT *raster)
+{
+  int32_t            i, j;
+
+
+  for (i = 0 ; i < raster->band_count ; i++)
+    {
+      for (j = 0 ; j < raster->width ; j++) raster->band[i][j] = RASTER_NULL;
+    }
+}
+
+
+
+/*  Create the raster output file path of the given type for an output grid with header.  Returns NVFalse if it couldn't be
+    created (error says why).  */
+
+uint8_t raster_output_open (RASTER_OUTPUT *raster, char *path, int32_t type, CHRTR2_HEADER *header)
+{
+  int32_t            i;
+  double             transform[6];
+  char               **options = NULL, block[20];
+  GIntBig            cache;
+  GDALDriverH        driver;
+  GDALRasterBandH    band;
+
+
+  memset (raster, 0, sizeof (RASTER_OUTPUT));
+
+  strcpy (raster->path, path);
+  raster->type = type;
+  raster->width = header->width;
+  raster->height = header->height;
+  raster->band_count = (type == RASTER_GTIFF) ? 3 : 1;
+
+  pthread_once (&gdal_once, register_drivers);
+
+
+  if (type == RASTER_GTIFF)
+    {
+      driver = GDALGetDriverByName ("GTiff");
+
+      sprintf (block, "%d", RASTER_TILE_SIZE);
+
+      options = CSLSetNameValue (options, "TILED", "YES");
+      options = CSLSetNameValue (options, "BLOCKXSIZE", block);
+      options = CSLSetNameValue (options, "BLOCKYSIZE", block);
+      options = CSLSetNameValue (options, "COMPRESS", "DEFLATE");
+      options = CSLSetNameValue (options, "PREDICTOR", "3");
+      options = CSLSetNameValue (options, "BIGTIFF", "IF_SAFER");
+
+
+      /*  The rows are written one at a time so the block cache has to hold a whole row of tiles of every band (and the row
+          before it while it's being flushed) or the tiles would be compressed and written more than once.  */
+
+      cache = (GIntBig) ((raster->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE) * RASTER_TILE_SIZE * RASTER_TILE_SIZE *
+        sizeof (float) * raster->band_count * 2;
+      if (GDALGetCacheMax64 () < cache) GDALSetCacheMax64 (cache);
+    }
+  else
+    {
+      driver = GDALGetDriverByName ("EHdr");
+    }
+
+  if (driver == NULL)
+    {
+      sprintf (raster->error, "GDAL doesn't have the %s driver", (type == RASTER_GTIFF) ? "GTiff" : "EHdr");
+      CSLDestroy (options);
+      return (NVFalse);
+    }
+
+  raster->dataset = GDALCreate (driver, path, raster->width, raster->height, raster->band_count, GDT_Float32, options);
+
+  CSLDestroy (options);
+
+  if (raster->dataset == NULL)
+    {
+      strncpy (raster->error, CPLGetLastErrorMsg (), sizeof (raster->error) - 1);
+      return (NVFalse);
+    }
+
+
+  /*  CHRTR2 grids are grid registered (the MBR is on the cell centers) so the raster corners are half a cell out from the
+      MBR.  */
+
+  transform[0] = header->mbr.wlon - header->lon_grid_size_degrees * 0.5;
+  transform[1] = header->lon_grid_size_degrees;
+  transform[2] = 0.0;
+  transform[3] = header->mbr.slat + ((double) header->height - 0.5) * header->lat_grid_size_degrees;
+  transform[4] = 0.0;
+  transform[5] = -header->lat_grid_size_degrees;
+
+  GDALSetGeoTransform (raster->dataset, transform);
+  GDALSetProjection (raster->dataset, SRS_WKT_WGS84_LAT_LONG);
+
+  for (i = 0 ; i < raster->band_count ; i++)
+    {
+      band = GDALGetRasterBand (raster->dataset, i + 1);
+      GDALSetRasterNoDataValue (band, RASTER_NULL);
+      GDALSetDescription (band, band_name[i]);
+
+      if ((raster->band[i] = (float *) malloc (raster->width * sizeof (float))) == NULL) return (NVFalse);
+    }
+
+  if ((raster->written = (uint8_t *) calloc (raster->height, sizeof (uint8_t))) == NULL) return (NVFalse);
+
+  clear_row (raster);
+
+  return (NVTrue);
+}
+
+
+
+/*  Store count records (with their source ranks if rank isn't NULL) in columns col through col + count - 1 of the row
+    being built.  */
+
+void raster_output_cells (RASTER_OUTPUT *raster, int32_t col, int32_t count, CHRTR2_RECORD *records, GRID_RANK *rank)
+{
+  int32_t            j;
+
+
+  for (j = 0 ; j < count ; j++)
+    {
+      if (!records[j].status) continue;
+
+      raster->band[0][col + j] = records[j].z;
+
+      if (raster->band_count > 1)
+        {
+          raster->band[1][col + j] = (float) records[j].status;
+          raster->band[2][col + j] = (rank != NULL) ? (float) rank[j] : 0.0;
+        }
+    }
+}
+
+
+
+/*  Write the row that has been built as output row row and start a new (empty) one.  Returns NVFalse if the write failed
+    (error says why).  */
+
+uint8_t raster_output_row (RASTER_OUTPUT *raster, int32_t row)
+{
+  int32_t            i;
+
+
+  for (i = 0 ; i < raster->band_count ; i++)
+    {
+      if (GDALRasterIO (GDALGetRasterBand (raster->dataset, i + 1), GF_Write, 0, raster->height - 1 - row, raster->width, 1,
+                        raster->band[i], raster->width, 1, GDT_Float32, 0, 0) != CE_None)
+        {
+          strncpy (raster->error, CPLGetLastErrorMsg (), sizeof (raster->error) - 1);
+          return (NVFalse);
+        }
+    }
+
+  raster->written[row] = NVTrue;
+
+  clear_row (raster);
+
+  return (NVTrue);
+}
+
+
+
+/*  Fill in any rows that were never written (the same as cells that were never written to the CHRTR2 file), close the
+    raster, and free everything.  Returns NVFalse if a row couldn't be written.  */
+
+uint8_t raster_output_close (RASTER_OUTPUT *raster)
+{
+  int32_t            i;
+  uint8_t            ok = NVTrue;
+
+
+  if (raster->dataset == NULL) return (NVFalse);
+
+  clear_row (raster);
+
+  for (i = 0 ; i < raster->height && ok ; i++)
+    {
+      if (!raster->written[i]) ok = raster_output_row (raster, i);
+    }
+
+  GDALClose (raster->dataset);
+
+  for (i = 0 ; i < raster->band_count ; i++) free (raster->band[i]);
+  free (raster->written);
+
+  return (ok);
+}
@@ -0,0 +1,68 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _RASTER_OUTPUT_H_
+#define _RASTER_OUTPUT_H_
+
+#include "chrtr2_merge.h"
+#include "merge_grid.h"
+
+
+/*  Value of the cells that have no data in every band of a raster output.  */
+
+#define         RASTER_NULL -999999.0
+
+
+/*  Kinds of raster output.  A GeoTIFF (--gtiff) is tiled and compressed and has Z, status, and source rank (input file
+    number) bands.  A raw raster (--raw) is an ESRI BIL (.bil plus .hdr) with just the Z band.  */
+
+#define         RASTER_GTIFF 0
+#define         RASTER_RAW 1
+
+
+/*  An extra output raster of the merged grid that is written (through GDAL) from the same rows as the CHRTR2 output file.
+    The cells of an output row are stored with raster_output_cells as they're written and the row is written to the
+    raster with raster_output_row.  Raster rows run north to south so output row 0 is the last raster row.  All of the
+    bands are 32 bit floats.  */
+
+typedef struct
+{
+  void               *dataset;        /*  GDALDatasetH  */
+  char               path[512];
+  int32_t            type;            /*  RASTER_GTIFF or RASTER_RAW  */
+  int32_t            width;
+  int32_t            height;
+  int32_t            band_count;
+  float              *band[3];        /*  One row of each band  */
+  uint8_t            *written;        /*  NVTrue for each output row that has been written  */
+  char               error[512];      /*  GDAL error message if a write failed  */
+} RASTER_OUTPUT;
+
+
+uint8_t raster_output_open (RASTER_OUTPUT *raster, char *path, int32_t type, CHRTR2_HEADER *header);
+void raster_output_cells (RASTER_OUTPUT *raster, int32_t col, int32_t count, CHRTR2_RECORD *records, GRID_RANK *rank);
+uint8_t raster_output_row (RASTER_OUTPUT *raster, int32_t row);
+uint8_t raster_output_close (RASTER_OUTPUT *raster);
+
+
+#endif
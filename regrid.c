@@ -0,0 +1,787 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef NVWIN3X
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "regrid.h"
+
+
+/*  Where the rows of the interpolated surface go as MISP hands them back.  row is the output row, values[0] is output
+    column 0, and only the first cols values are valid.  */
+
+typedef void (*REGRID_SINK) (void *data, int32_t row, float *values, int32_t cols);
+
+
+typedef struct
+{
+  MERGE              *merge;
+  MERGE_GRID         *grid;
+} WRITE_SINK;
+
+
+/*  MISP keeps all of its state in globals.  When the merges in a batch run at the same time only one of them can be using
+    MISP in this process (or forking a worker that gets a copy of MISP's globals) at once.  */
+
+static pthread_mutex_t misp_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/*  Run MISP over output rows regrid_start through regrid_end - 1 (which have to be in the grid) and pass the interpolated
+    rows that fall in write_start through write_end - 1 to sink.  If holes isn't NULL only the cells within REGRID_HALO of a
+    hole are loaded as control points.  If verbose is NVFalse we don't print progress (for the regrid worker processes).
+    Returns NVFalse if we couldn't allocate the retrieval row (the caller reports it since the worker processes can't).  */
+
+static uint8_t regrid_tile (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *holes, int32_t regrid_start, int32_t regrid_end, int32_t write_start,
+                         int32_t write_end, REGRID_SINK sink, void *sink_data, uint8_t verbose)
+{
+  int32_t            i, j, row, offset, row_filter, col_filter, grid_rows, grid_cols, cols, input_count = 0, percent = 0, old_percent = -1;
+  CHRTR2_HEADER      *header;
+  GRID_TILE          *tile = NULL;
+  float              *array;
+  NV_F64_XYMBR       mbr, misp_mbr;
+  NV_F64_COORD3      xyz;
+  NV_F64_COORD2      xy;
+  NV_I32_COORD2      coord;
+  STATS_TIMER        timer;
+
+
+  header = &merge->output_header;
+
+
+  /*  Define the MBR for the new grid (adding the filter border).  */
+
+  mbr.min_x = header->mbr.wlon;
+  mbr.min_y = header->mbr.slat + (double) regrid_start * header->lat_grid_size_degrees;
+  mbr.max_x = header->mbr.elon;
+  mbr.max_y = (regrid_end == header->height) ? header->mbr.nlat : header->mbr.slat + (double) (regrid_end - 1) * header->lat_grid_size_degrees;
+
+
+  /*  Add the filter border to the MBR.  */
+
+  mbr.min_x -= ((double) FILTER * header->lon_grid_size_degrees);
+  mbr.min_y -= ((double) FILTER * header->lat_grid_size_degrees);
+  mbr.max_x += ((double) FILTER * header->lon_grid_size_degrees);
+  mbr.max_y += ((double) FILTER * header->lat_grid_size_degrees);
+
+
+  /*  Number of rows and columns in the area  */
+
+  grid_rows = NINT ((mbr.max_y - mbr.min_y) / header->lat_grid_size_degrees);
+  grid_cols = NINT ((mbr.max_x - mbr.min_x) / header->lon_grid_size_degrees);
+
+
+  row_filter = grid_rows - FILTER;
+  col_filter = grid_cols - FILTER;
+
+
+  /*  We're going to let MISP/SURF handle everything in zero based units of the bin size.  That is, we subtract off the
+      west lon from longitudes then divide by the grid size in the X direction.  We do the same with the latitude using
+      the south latitude.  This will give us values that range from 0.0 to grid5_cols in longitude and 0.0 to
+      grid5_rows in latitude.  */
+
+  misp_mbr.min_x = 0.0;
+  misp_mbr.min_y = 0.0;
+  misp_mbr.max_x = (double) grid_cols;
+  misp_mbr.max_y = (double) grid_rows;
+
+
+  misp_init (1.0, 1.0, 0.05, 4, (float) MISP_SEARCH_RADIUS, 20, 999999.0, -999999.0, -2, misp_mbr);
+
+  stats_start (merge->stats, &timer);
+
+  for (i = regrid_start ; i < regrid_end ; i++)
+    {
+      coord.y = i;
+      row = i - grid->start_row;
+
+      for (j = 0 ; j < header->width ; j++)
+        {
+          /*  Skip grid tiles that have never had any data.  */
+
+          if (!(j & GRID_TILE_MASK))
+            {
+              tile = merge_grid_tile (grid, row, j);
+
+              if (tile == &merge_grid_null_tile)
+                {
+                  j += GRID_TILE_SIZE - 1;
+                  continue;
+                }
+            }
+
+          coord.x = j;
+
+          offset = merge_grid_offset (row, j);
+
+
+          /*  No point in loading null values (or, for the hole only regrid, values that can't affect a hole).  */
+
+          if (tile->status[offset] && (holes == NULL || exclude_map_hole (holes, j, row, REGRID_HALO, REGRID_HALO)))
+            {
+              chrtr2_get_lat_lon (merge->output_handle, &xy.y, &xy.x, coord);
+
+
+              /*
+                Load the points.
+
+                IMPORTANT NOTE:  MISP and GMT (by default) grid using corner posts.  That is, the data in a bin is assigned to the 
+                lower left corner of the bin.  Normal gridding/binning systems use the center of the bin.  Because of this we need
+                to lie to MISP/GMT and tell them that the point is really half a bin lower and to the left.  This is extremely
+                confusing but it works ;-)
+              */
+
+              xyz.x = (xy.x - mbr.min_x) / header->lon_grid_size_degrees;
+              xyz.y = (xy.y - mbr.min_y) / header->lat_grid_size_degrees;
+              xyz.z = tile->z[offset];
+
+              input_count++;
+
+              misp_load (xyz);
+            }
+        }
+
+      if (verbose)
+        {
+          percent = NINT (((float) (i - regrid_start) / (float) (regrid_end - regrid_start)) * 100.0);
+          if (percent != old_percent)
+            {
+              fprintf (stderr, "Loading data for re-grid - %03d%% complete\r", percent);
+              fflush (stderr);
+              old_percent = percent;
+            }
+        }
+    }
+
+  stats_stop (merge->stats, &timer, STATS_MISP_LOAD, -1, input_count, 0);
+
+  if (verbose)
+    {
+      fprintf (stderr, "                                                                   \r");
+      fprintf (stderr, "\nData load complete, %d points loaded\n\n", input_count);
+
+
+      fprintf (stderr, "Processing grid\n");
+      fflush (stderr);
+    }
+
+
+  stats_start (merge->stats, &timer);
+
+  misp_proc ();
+
+  stats_stop (merge->stats, &timer, STATS_MISP_PROC, -1, (int64_t) grid_rows * (int64_t) grid_cols, 0);
+
+
+  if (verbose)
+    {
+      fprintf (stderr, "Processing grid complete\n");
+      fflush (stderr);
+    }
+
+
+  array = (float *) malloc ((grid_cols + 1) * sizeof (float));
+
+  if (array == NULL) return (NVFalse);
+
+
+  /*  Only use data that aren't in the filter border and make sure we're inside the CHRTR2 bounds.  */
+
+  cols = MIN (col_filter - FILTER, header->width);
+
+
+  /*  This is where we hand the new interpolated surface off to be stuffed into the new CHRTR2.  */
+
+  for (i = 0 ; i < grid_rows ; i++)
+    {
+      stats_start (merge->stats, &timer);
+
+      if (!misp_rtrv (array)) break;
+
+      stats_stop (merge->stats, &timer, STATS_MISP_RTRV, -1, grid_cols, 0);
+
+
+      /*  Only use data that aren't in the filter border  */
+
+      if (i >= FILTER && i < row_filter)
+        {
+          coord.y = regrid_start + i - FILTER;
+
+
+          /*  Only write the rows that belong to this tile.  */
+
+          if (coord.y >= write_start && coord.y < write_end && coord.y < header->height && cols > 0) (*sink) (sink_data, coord.y, &array[FILTER], cols);
+        }
+
+      if (verbose)
+        {
+          percent = NINT (((float) i / (float) grid_rows) * 100.0);
+          if (percent != old_percent)
+            {
+              fprintf (stderr, "Retrieving data for output file - %03d%% complete\r", percent);
+              fflush (stderr);
+              old_percent = percent;
+            }
+        }
+    }
+
+
+  if (verbose)
+    {
+      fprintf (stderr, "                                                                   \r");
+      fprintf (stderr, "\nFinal grid retrieval complete\n\n");
+      fflush (stderr);
+    }
+
+
+  free (array);
+
+  return (NVTrue);
+}
+
+
+
+/*  Combine a row of the interpolated surface with the grid and queue it to be written to the output file.  The grid itself
+    isn't changed (so the empty tiles stay empty).  */
+
+static void write_row (void *data, int32_t row, float *values, int32_t cols)
+{
+  WRITE_SINK         *sink = (WRITE_SINK *) data;
+  MERGE              *merge = sink->merge;
+  MERGE_GRID         *grid = sink->grid;
+  int32_t            j, grid_row;
+  CHRTR2_RECORD      *records;
+  GRID_RANK          *rank;
+
+
+  records = output_writer_next (&merge->writer);
+  rank = output_writer_rank (&merge->writer);
+
+  grid_row = row - grid->start_row;
+
+  for (j = 0 ; j < cols ; j++)
+    {
+      merge_grid_get (grid, merge_grid_tile_number (grid, grid_row, j), merge_grid_offset (grid_row, j), &records[j]);
+      if (rank != NULL) rank[j] = merge_grid_tile (grid, grid_row, j)->rank[merge_grid_offset (grid_row, j)];
+
+
+      /*  Don't replace real, hand-drawn/digitized, or land masked data.  */
+
+      if (!(records[j].status & HARD_DATA))
+        {
+          records[j].z = values[j];
+          records[j].status |= CHRTR2_INTERPOLATED;
+        }
+    }
+
+  output_writer_run (&merge->writer, 0, cols);
+  output_writer_queue (&merge->writer, row);
+}
+
+
+
+/*  Regrid output rows regrid_start through regrid_end - 1 (which have to be in the grid) in a single MISP pass and write the
+    interpolated surface for output rows write_start through write_end - 1 to the output file.  If we're regridding the
+    whole output grid at once this is exactly the same single MISP pass that we've always done.  Returns NVFalse (with the
+    error in merge) if the regrid failed.  */
+
+uint8_t merge_regrid (MERGE *merge, MERGE_GRID *grid, int32_t regrid_start, int32_t regrid_end, int32_t write_start, int32_t write_end)
+{
+  uint8_t            ok;
+  WRITE_SINK         sink;
+
+
+  sink.merge = merge;
+  sink.grid = grid;
+
+  pthread_mutex_lock (&misp_mutex);
+  ok = regrid_tile (merge, grid, NULL, regrid_start, regrid_end, write_start, write_end, write_row, &sink, !merge->quiet);
+  pthread_mutex_unlock (&misp_mutex);
+
+  if (!ok) merge_error (merge, MERGE_ERROR_MEMORY, "Allocating array in regrid.c: %s", strerror (ENOMEM));
+
+  return (ok);
+}
+
+
+
+#ifndef NVWIN3X
+
+/*  Write all of a buffer to a pipe.  */
+
+static uint8_t write_all (int fd, void *buffer, size_t size)
+{
+  uint8_t            *ptr = (uint8_t *) buffer;
+  ssize_t            count;
+
+
+  while (size)
+    {
+      count = write (fd, ptr, size);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return (NVFalse);
+      ptr += count;
+      size -= count;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Read all of a buffer from a pipe.  */
+
+static uint8_t read_all (int fd, void *buffer, size_t size)
+{
+  uint8_t            *ptr = (uint8_t *) buffer;
+  ssize_t            count;
+
+
+  while (size)
+    {
+      count = read (fd, ptr, size);
+      if (count < 0 && errno == EINTR) continue;
+      if (count <= 0) return (NVFalse);
+      ptr += count;
+      size -= count;
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Worker process side of the pipe.  Each row goes down the pipe as the row number, the column count, and the values.  */
+
+static void pipe_row (void *data, int32_t row, float *values, int32_t cols)
+{
+  int                fd = *((int *) data);
+
+
+  if (!write_all (fd, &row, sizeof (int32_t)) || !write_all (fd, &cols, sizeof (int32_t)) ||
+      !write_all (fd, values, cols * sizeof (float))) _exit (-1);
+}
+
+
+
+/*  One regrid worker process.  */
+
+typedef struct
+{
+  pid_t              pid;
+  int                fd;              /*  Read end of the pipe from the worker  */
+  int32_t            start_row;
+  int32_t            end_row;
+} REGRID_WORKER;
+
+
+
+/*  Fork a worker to regrid output rows start_row through end_row - 1 (plus the halo).  MISP keeps all of its state in
+    globals so we can't run it in more than one thread but we can run it in more than one process.  The worker gets a copy
+    on write snapshot of the grid and pipes the interpolated rows back to us.  Returns NVFalse (with the error in merge) if
+    we couldn't start it.  */
+
+static uint8_t start_worker (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *holes, REGRID_WORKER *worker, int32_t start_row, int32_t end_row)
+{
+  int                fd[2];
+  int32_t            end_marker = -1, regrid_start, regrid_end;
+  MERGE_STATS        stats;
+
+
+  worker->start_row = start_row;
+  worker->end_row = end_row;
+
+  if (pipe (fd))
+    {
+      merge_error (merge, MERGE_ERROR_THREAD, "Creating regrid pipe in regrid.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  fflush (stdout);
+  fflush (stderr);
+
+  pthread_mutex_lock (&misp_mutex);
+  worker->pid = fork ();
+  if (worker->pid) pthread_mutex_unlock (&misp_mutex);
+
+  if (worker->pid < 0)
+    {
+      merge_error (merge, MERGE_ERROR_THREAD, "Starting regrid worker in regrid.c: %s", strerror (errno));
+      close (fd[0]);
+      close (fd[1]);
+      return (NVFalse);
+    }
+
+  if (!worker->pid)
+    {
+      close (fd[0]);
+
+      regrid_start = MAX (start_row - REGRID_HALO, grid->start_row);
+      regrid_end = MIN (end_row + REGRID_HALO, grid->start_row + grid->rows);
+
+
+      /*  Our copy of the parent's stats may have been copied with its mutex locked so we keep our own and send the MISP
+          phases back after the end marker.  */
+
+      if (merge->stats != NULL)
+        {
+          if (!stats_init (&stats, 0)) _exit (-1);
+          merge->stats = &stats;
+        }
+
+      if (!regrid_tile (merge, grid, holes, regrid_start, regrid_end, start_row, end_row, pipe_row, &fd[1], NVFalse)) _exit (-1);
+
+      write_all (fd[1], &end_marker, sizeof (int32_t));
+
+      if (merge->stats != NULL && !write_all (fd[1], &stats.phase[STATS_MISP_LOAD], 3 * sizeof (STATS_PHASE))) _exit (-1);
+
+      close (fd[1]);
+
+      _exit (0);
+    }
+
+  close (fd[1]);
+  worker->fd = fd[0];
+
+  return (NVTrue);
+}
+
+
+
+/*  Read the rows from a worker, stuff them into the grid, and write them to the output file.  Returns NVFalse (with the
+    error in merge) if the worker failed.  */
+
+static uint8_t finish_worker (MERGE *merge, MERGE_GRID *grid, REGRID_WORKER *worker, float *values)
+{
+  int32_t            row, cols;
+  int                status;
+  WRITE_SINK         sink;
+  STATS_PHASE        phase[3];
+
+
+  sink.merge = merge;
+  sink.grid = grid;
+
+  while (NVTrue)
+    {
+      if (!read_all (worker->fd, &row, sizeof (int32_t))) break;
+      if (row < 0) break;
+
+      if (!read_all (worker->fd, &cols, sizeof (int32_t)) || cols > grid->width || !read_all (worker->fd, values, cols * sizeof (float)))
+        {
+          row = -2;
+          break;
+        }
+
+      write_row (&sink, row, values, cols);
+    }
+
+  if (row == -1 && merge->stats != NULL)
+    {
+      if (read_all (worker->fd, phase, sizeof (phase)))
+        {
+          stats_add_phases (merge->stats, STATS_MISP_LOAD, phase, 3);
+        }
+      else
+        {
+          row = -2;
+        }
+    }
+
+  close (worker->fd);
+  waitpid (worker->pid, &status, 0);
+
+  if (row != -1 || !WIFEXITED (status) || WEXITSTATUS (status))
+    {
+      merge_error (merge, MERGE_ERROR_THREAD, "Regrid worker for output rows %d to %d failed", worker->start_row, worker->end_row - 1);
+      return (NVFalse);
+    }
+
+  return (NVTrue);
+}
+
+#endif
+
+
+
+/*  Regrid output rows write_start through write_end - 1 in a single MISP pass (plus the REGRID_HALO rows on either side
+    that are in the grid) and write them to the output file.  */
+
+static uint8_t regrid_band (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *holes, int32_t write_start, int32_t write_end)
+{
+  uint8_t            ok;
+  WRITE_SINK         sink;
+
+
+  sink.merge = merge;
+  sink.grid = grid;
+
+  pthread_mutex_lock (&misp_mutex);
+  ok = regrid_tile (merge, grid, holes, MAX (write_start - REGRID_HALO, grid->start_row),
+                    MIN (write_end + REGRID_HALO, grid->start_row + grid->rows), write_start, write_end, write_row, &sink, !merge->quiet);
+  pthread_mutex_unlock (&misp_mutex);
+
+  if (!ok) merge_error (merge, MERGE_ERROR_MEMORY, "Allocating array in regrid.c: %s", strerror (ENOMEM));
+
+  return (ok);
+}
+
+
+
+/*  Regrid output rows write_start through write_end - 1 using up to workers MISP processes at once and write them to the
+    output file.  The rows are split into tiles that are regridded separately with REGRID_HALO rows of overlap (the filter
+    border plus the MISP search radius) and only the interior of each tile is kept.  The tiles are written in order so the
+    output file is laid out exactly the same as a single pass.  This isn't supported on Windows (no fork) so we just do a
+    single pass there.  Returns NVFalse (with the error in merge) if the regrid failed.  */
+
+static uint8_t regrid_bands (MERGE *merge, MERGE_GRID *grid, EXCLUDE_MAP *holes, int32_t write_start, int32_t write_end, int32_t workers)
+{
+#ifdef NVWIN3X
+
+  return (regrid_band (merge, grid, holes, write_start, write_end));
+
+#else
+
+  int32_t            i, tile_rows, tile_count, next, percent = 0, old_percent = -1;
+  int                status;
+  uint8_t            ok = NVTrue;
+  float              *values;
+  REGRID_WORKER      *worker;
+
+
+  tile_rows = MAX ((write_end - write_start + workers - 1) / workers, MIN_REGRID_TILE_ROWS);
+  tile_count = (write_end - write_start + tile_rows - 1) / tile_rows;
+
+
+  /*  Not worth splitting.  */
+
+  if (tile_count < 2) return (regrid_band (merge, grid, holes, write_start, write_end));
+
+
+  worker = (REGRID_WORKER *) calloc (tile_count, sizeof (REGRID_WORKER));
+  values = (float *) malloc (grid->width * sizeof (float));
+
+  if (worker == NULL || values == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating regrid workers in regrid.c: %s", strerror (errno));
+      free (values);
+      free (worker);
+      return (NVFalse);
+    }
+
+
+  if (!merge->quiet)
+    {
+      fprintf (stderr, "Regridding %d tiles using %d processes\n", tile_count, MIN (workers, tile_count));
+      fflush (stderr);
+    }
+
+
+  /*  Keep up to workers processes going and collect the results in tile order.  */
+
+  next = 0;
+  for (i = 0 ; i < tile_count ; i++)
+    {
+      for ( ; next < tile_count && next < i + workers ; next++)
+        if (!start_worker (merge, grid, holes, &worker[next], write_start + next * tile_rows,
+                           MIN (write_start + (next + 1) * tile_rows, write_end))) break;
+
+      if (next < MIN (i + workers, tile_count))
+        {
+          ok = NVFalse;
+          break;
+        }
+
+      if (!finish_worker (merge, grid, &worker[i], values))
+        {
+          ok = NVFalse;
+          i++;
+          break;
+        }
+
+      percent = NINT (((float) (i + 1) / (float) tile_count) * 100.0);
+      if (!merge->quiet && percent != old_percent)
+        {
+          fprintf (stderr, "Regridding tiles - %03d%% complete\r", percent);
+          fflush (stderr);
+          old_percent = percent;
+        }
+    }
+
+  /*  If something failed don't leave the workers that are still running behind (closing the pipe stops them).  */
+
+  for ( ; !ok && i < next ; i++)
+    {
+      close (worker[i].fd);
+      waitpid (worker[i].pid, &status, 0);
+    }
+
+  if (ok && !merge->quiet)
+    {
+      fprintf (stderr, "                                                                   \r");
+      fprintf (stderr, "\nFinal grid retrieval complete\n\n");
+      fflush (stderr);
+    }
+
+  free (values);
+  free (worker);
+
+  return (ok);
+
+#endif
+}
+
+
+
+/*  Regrid output rows write_start through write_end - 1 using up to workers MISP processes at once and write them to the
+    output file (see regrid_bands).  Since each tile's MISP surface only sees the control points within the halo the
+    interpolated values can differ from a single pass, the most in large holes whose nearest data is farther away than
+    the halo (bench/chrtr2_diff measures it).  Real, hand-drawn/digitized, and land masked data are never changed.
+    Returns NVFalse (with the error in merge) if the regrid failed.  */
+
+uint8_t merge_regrid_parallel (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end, int32_t workers)
+{
+  return (regrid_bands (merge, grid, NULL, write_start, write_end, workers));
+}
+
+
+
+/*  Write output rows start_row through end_row - 1 straight from the grid.  These rows don't have any holes so there's
+    nothing for MISP to change.  The MISP area runs from the first grid post to the last one so a regrid never writes the
+    last row or column of the output file.  We don't either so that the output is the same as a full regrid.  Returns NVFalse
+    (with the error in merge) if we couldn't allocate the row.  */
+
+static uint8_t copy_rows (MERGE *merge, MERGE_GRID *grid, int32_t start_row, int32_t end_row)
+{
+  int32_t            i, rows, cols;
+  float              *z;
+  CHRTR2_HEADER      *header;
+  WRITE_SINK         sink;
+
+
+  header = &merge->output_header;
+
+  rows = MIN (NINT ((header->mbr.nlat - header->mbr.slat) / header->lat_grid_size_degrees), header->height);
+  cols = MIN (NINT ((header->mbr.elon - header->mbr.wlon) / header->lon_grid_size_degrees), header->width);
+
+  sink.merge = merge;
+  sink.grid = grid;
+
+  z = (float *) malloc (grid->width * sizeof (float));
+  if (z == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating row in regrid.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  for (i = start_row ; i < MIN (end_row, rows) ; i++)
+    {
+      merge_grid_read_z (grid, i - grid->start_row, z);
+      write_row (&sink, i, z, cols);
+    }
+
+  free (z);
+
+  return (NVTrue);
+}
+
+
+
+/*  Regrid only the parts of output rows write_start through write_end - 1 that have holes in them (cells that aren't real,
+    hand-drawn/digitized, or land masked) and write them to the output file.  The rows are checked in bands of
+    HOLE_BAND_ROWS.  Bands with no holes are copied straight to the output file.  Bands with holes are grouped into runs
+    (bands that are close enough that their halos would overlap go in the same run) and each run is regridded, using up to
+    workers MISP processes, with only the control points within REGRID_HALO cells of a hole.  Those are the only points that
+    the MISP search radius can reach from a hole so, where the data is dense, the holes get about the same values they
+    would from a full regrid (within the MISP convergence delta) for a fraction of the work.  Returns NVFalse (with the error
+    in merge) if the regrid failed.  */
+
+uint8_t merge_regrid_holes (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end, int32_t workers)
+{
+  int32_t            band_start, band_end, run_start = -1, run_end = -1, done, regrid_rows = 0;
+  uint8_t            ok = NVTrue;
+  EXCLUDE_MAP        holes;
+
+
+  /*  The hard data mask for the whole grid (halo included).  */
+
+  if (!exclude_map_alloc (&holes, grid->width, grid->rows))
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating hole map in regrid.c: %s", strerror (errno));
+      return (NVFalse);
+    }
+
+  exclude_map_build (&holes, grid, 0, 0, grid->width, grid->rows);
+
+
+  done = write_start;
+
+  for (band_start = write_start ; band_start < write_end && ok ; band_start += HOLE_BAND_ROWS)
+    {
+      band_end = MIN (band_start + HOLE_BAND_ROWS, write_end);
+
+
+      /*  Skip the band if every cell in it is hard data.  */
+
+      if (exclude_map_count (&holes, 0, band_start - grid->start_row, grid->width, band_end - grid->start_row) ==
+          (uint32_t) (grid->width * (band_end - band_start))) continue;
+
+
+      /*  If this band is too far from the current run, finish the run and start a new one.  */
+
+      if (run_start >= 0 && band_start - run_end > 2 * REGRID_HALO)
+        {
+          ok = (copy_rows (merge, grid, done, run_start) && regrid_bands (merge, grid, &holes, run_start, run_end, workers));
+          regrid_rows += run_end - run_start;
+          done = run_end;
+          run_start = -1;
+        }
+
+      if (run_start < 0) run_start = band_start;
+      run_end = band_end;
+    }
+
+  if (ok && run_start >= 0)
+    {
+      ok = (copy_rows (merge, grid, done, run_start) && regrid_bands (merge, grid, &holes, run_start, run_end, workers));
+      regrid_rows += run_end - run_start;
+      done = run_end;
+    }
+
+  if (ok) ok = copy_rows (merge, grid, done, write_end);
+
+
+  if (ok && !merge->quiet)
+    {
+      fprintf (stderr, "Regridded %d of %d rows, the rest had no holes\n\n", regrid_rows, write_end - write_start);
+      fflush (stderr);
+    }
+
+
+  exclude_map_free (&holes);
+
+  return (ok);
+}
@@ -0,0 +1,46 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _REGRID_H_
+#define _REGRID_H_
+
+#include "merge.h"
+
+
+/*  Minimum number of output rows in each parallel regrid tile.  Each tile also regrids REGRID_HALO rows above and below
+    itself so there's no point in making the tiles much thinner than the halo.  */
+
+#define         MIN_REGRID_TILE_ROWS (4 * REGRID_HALO)
+
+
+/*  Number of output rows that the hole only regrid checks for holes at a time.  */
+
+#define         HOLE_BAND_ROWS REGRID_HALO
+
+
+uint8_t merge_regrid (MERGE *merge, MERGE_GRID *grid, int32_t regrid_start, int32_t regrid_end, int32_t write_start, int32_t write_end);
+uint8_t merge_regrid_parallel (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end, int32_t workers);
+uint8_t merge_regrid_holes (MERGE *merge, MERGE_GRID *grid, int32_t write_start, int32_t write_end, int32_t workers);
+
+
+#endif
@@ -0,0 +1,399 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef NVWIN3X
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include "stats.h"
+#include "version.h"
+
+
+/*  Don't read the resident set size more often than this (seconds).  The read and insert phases are timed a row at a
+    time.  */
+
+#define         RSS_INTERVAL 0.1
+
+
+static char *phase_name[STATS_PHASES] = {"open", "read", "exclude_map", "insert", "misp_load", "misp_proc", "misp_rtrv", "write"};
+
+
+
+static double wall_time ()
+{
+  struct timespec    ts;
+
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return ((double) ts.tv_sec + (double) ts.tv_nsec / 1.0e9);
+}
+
+
+
+/*  CPU time of the calling thread.  */
+
+static double cpu_time ()
+{
+#ifdef NVWIN3X
+
+  return ((double) clock () / (double) CLOCKS_PER_SEC);
+
+#else
+
+  struct timespec    ts;
+
+
+  clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts);
+
+  return ((double) ts.tv_sec + (double) ts.tv_nsec / 1.0e9);
+
+#endif
+}
+
+
+
+/*  Peak resident set size of this process in KB (0 if we can't tell).  This is the high water mark for the life of the
+    process (all of the jobs in a batch) so it's only reported for the whole run.  */
+
+static int64_t peak_rss ()
+{
+#ifdef NVWIN3X
+
+  return (0);
+
+#else
+
+  struct rusage      usage;
+
+
+  if (getrusage (RUSAGE_SELF, &usage)) return (0);
+
+  return ((int64_t) usage.ru_maxrss);
+
+#endif
+}
+
+
+
+/*  Resident set size of this process right now in KB (0 if we can't tell).  */
+
+static int64_t current_rss ()
+{
+#ifdef NVWIN3X
+
+  return (0);
+
+#else
+
+  FILE               *fp;
+  long long          size, resident;
+
+
+  if ((fp = fopen ("/proc/self/statm", "r")) == NULL) return (0);
+
+  if (fscanf (fp, "%lld %lld", &size, &resident) != 2) resident = 0;
+
+  fclose (fp);
+
+  return ((int64_t) resident * (int64_t) (sysconf (_SC_PAGESIZE) / 1024));
+
+#endif
+}
+
+
+
+/*  Returns the current resident set size, only reading it again if the last read was more than RSS_INTERVAL ago.  The
+    stats mutex has to be locked.  */
+
+static int64_t sample_rss (MERGE_STATS *stats, double wall)
+{
+  if (wall - stats->rss_time >= RSS_INTERVAL || !stats->rss)
+    {
+      stats->rss = current_rss ();
+      stats->rss_time = wall;
+    }
+
+  return (stats->rss);
+}
+
+
+
+/*  Set up stats for file_count input files and start the clock.  */
+
+uint8_t stats_init (MERGE_STATS *stats, int32_t file_count)
+{
+  memset (stats, 0, sizeof (MERGE_STATS));
+
+  stats->file_count = file_count;
+  stats->start = wall_time ();
+
+  if (file_count && (stats->file = (STATS_FILE *) calloc (file_count, sizeof (STATS_FILE))) == NULL) return (NVFalse);
+
+  pthread_mutex_init (&stats->mutex, NULL);
+
+  return (NVTrue);
+}
+
+
+
+void stats_start (MERGE_STATS *stats, STATS_TIMER *timer)
+{
+  if (stats == NULL) return;
+
+  timer->wall = wall_time ();
+  timer->cpu = cpu_time ();
+
+  pthread_mutex_lock (&stats->mutex);
+  timer->rss = sample_rss (stats, timer->wall);
+  pthread_mutex_unlock (&stats->mutex);
+}
+
+
+
+/*  Add the time since stats_start (in the same thread) to phase and, if file isn't -1, to input file number file.  */
+
+void stats_stop (MERGE_STATS *stats, STATS_TIMER *timer, int32_t phase, int32_t file, int64_t cells, int64_t bytes)
+{
+  double             wall, cpu;
+  STATS_PHASE        *p;
+
+
+  if (stats == NULL) return;
+
+  wall = wall_time ();
+  cpu = cpu_time () - timer->cpu;
+
+  p = &stats->phase[phase];
+
+  pthread_mutex_lock (&stats->mutex);
+
+  p->wall += wall - timer->wall;
+  p->cpu += cpu;
+  p->calls++;
+  p->cells += cells;
+  p->bytes += bytes;
+
+  p->peak_rss = MAX (p->peak_rss, MAX (timer->rss, sample_rss (stats, wall)));
+
+  if (file >= 0)
+    {
+      stats->file[file].wall += wall - timer->wall;
+      stats->file[file].cells += cells;
+      stats->file[file].bytes += bytes;
+    }
+
+  pthread_mutex_unlock (&stats->mutex);
+}
+
+
+
+/*  Add count phases that were timed somewhere else (a regrid worker process) to the phases starting at phase.  */
+
+void stats_add_phases (MERGE_STATS *stats, int32_t phase, STATS_PHASE *add, int32_t count)
+{
+  int32_t            i;
+  STATS_PHASE        *p;
+
+
+  if (stats == NULL) return;
+
+  pthread_mutex_lock (&stats->mutex);
+
+  for (i = 0 ; i < count ; i++)
+    {
+      p = &stats->phase[phase + i];
+
+      p->wall += add[i].wall;
+      p->cpu += add[i].cpu;
+      p->calls += add[i].calls;
+      p->cells += add[i].cells;
+      p->bytes += add[i].bytes;
+      p->peak_rss = MAX (p->peak_rss, add[i].peak_rss);
+    }
+
+  pthread_mutex_unlock (&stats->mutex);
+}
+
+
+
+/*  Write string as a quoted JSON string.  */
+
+void stats_json_string (FILE *fp, char *string)
+{
+  char               *ptr;
+
+
+  fputc ('"', fp);
+
+  for (ptr = string ; *ptr ; ptr++)
+    {
+      if (*ptr == '"' || *ptr == '\\')
+        {
+          fprintf (fp, "\\%c", *ptr);
+        }
+      else if ((unsigned char) *ptr < 0x20)
+        {
+          fprintf (fp, "\\u%04x", (unsigned char) *ptr);
+        }
+      else
+        {
+          fputc (*ptr, fp);
+        }
+    }
+
+  fputc ('"', fp);
+}
+
+
+
+/*  Cells per second or 0 if there was no time.  */
+
+static double rate (int64_t cells, double seconds)
+{
+  if (seconds <= 0.0) return (0.0);
+
+  return ((double) cells / seconds);
+}
+
+
+
+/*  Read one of the counters from /proc/self/io.  Returns -1 if we can't.  */
+
+static int64_t proc_io (char *name)
+{
+  FILE               *fp;
+  char               string[128];
+  long long          value;
+  int64_t            ret = -1;
+  size_t             len = strlen (name);
+
+
+  if ((fp = fopen ("/proc/self/io", "r")) == NULL) return (-1);
+
+  while (fgets (string, sizeof (string), fp) != NULL)
+    {
+      if (!strncmp (string, name, len) && string[len] == ':' && sscanf (&string[len + 1], "%lld", &value) == 1)
+        {
+          ret = (int64_t) value;
+          break;
+        }
+    }
+
+  fclose (fp);
+
+  return (ret);
+}
+
+
+
+/*  Write the stats to path as JSON.  Returns NVFalse if the file couldn't be written.  */
+
+uint8_t stats_write_json (MERGE_STATS *stats, char *path, INPUT_FILES *inputs, char *output_file, CHRTR2_HEADER *output_header)
+{
+  FILE               *fp;
+  int32_t            i;
+  double             user = 0.0, system = 0.0, child_user = 0.0, child_system = 0.0;
+  STATS_PHASE        *p;
+
+
+#ifndef NVWIN3X
+  struct rusage      usage;
+
+  if (!getrusage (RUSAGE_SELF, &usage))
+    {
+      user = (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1.0e6;
+      system = (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1.0e6;
+    }
+
+  if (!getrusage (RUSAGE_CHILDREN, &usage))
+    {
+      child_user = (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1.0e6;
+      child_system = (double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1.0e6;
+    }
+#endif
+
+
+  if ((fp = fopen (path, "w")) == NULL) return (NVFalse);
+
+  fprintf (fp, "{\n  \"version\": ");
+  stats_json_string (fp, VERSION);
+  fprintf (fp, ",\n  \"output\": {\"file\": ");
+  stats_json_string (fp, output_file);
+  fprintf (fp, ", \"width\": %d, \"height\": %d, \"cells\": %lld},\n", output_header->width, output_header->height,
+           (long long) output_header->width * (long long) output_header->height);
+
+  fprintf (fp, "  \"wall_seconds\": %.6f,\n", wall_time () - stats->start);
+  fprintf (fp, "  \"user_cpu_seconds\": %.6f,\n  \"system_cpu_seconds\": %.6f,\n", user, system);
+  fprintf (fp, "  \"children_user_cpu_seconds\": %.6f,\n  \"children_system_cpu_seconds\": %.6f,\n", child_user, child_system);
+  fprintf (fp, "  \"peak_rss_kb\": %lld,\n", (long long) peak_rss ());
+  fprintf (fp, "  \"io\": {\"rchar\": %lld, \"wchar\": %lld, \"read_bytes\": %lld, \"write_bytes\": %lld},\n",
+           (long long) proc_io ("rchar"), (long long) proc_io ("wchar"), (long long) proc_io ("read_bytes"),
+           (long long) proc_io ("write_bytes"));
+
+
+  fprintf (fp, "  \"phases\": {\n");
+
+  for (i = 0 ; i < STATS_PHASES ; i++)
+    {
+      p = &stats->phase[i];
+
+      fprintf (fp, "    \"%s\": {\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f, \"calls\": %lld, \"cells\": %lld, "
+               "\"cells_per_second\": %.1f, \"bytes\": %lld, \"peak_rss_kb\": %lld}%s\n", phase_name[i], p->wall, p->cpu,
+               (long long) p->calls, (long long) p->cells, rate (p->cells, p->wall), (long long) p->bytes,
+               (long long) p->peak_rss, (i < STATS_PHASES - 1) ? "," : "");
+    }
+
+  fprintf (fp, "  },\n");
+
+
+  fprintf (fp, "  \"inputs\": [\n");
+
+  for (i = 0 ; i < stats->file_count ; i++)
+    {
+      fprintf (fp, "    {\"file\": ");
+      stats_json_string (fp, inputs->path[i]);
+      fprintf (fp, ", \"rows_read\": %lld, \"rows_skipped\": %lld, \"cells\": %lld, \"bytes\": %lld, \"read_seconds\": %.6f, "
+               "\"cells_per_second\": %.1f}%s\n", (long long) inputs->rows_read[i], (long long) inputs->rows_skipped[i],
+               (long long) stats->file[i].cells, (long long) stats->file[i].bytes, stats->file[i].wall,
+               rate (stats->file[i].cells, stats->file[i].wall), (i < stats->file_count - 1) ? "," : "");
+    }
+
+  fprintf (fp, "  ]\n}\n");
+
+  if (fclose (fp)) return (NVFalse);
+
+  return (NVTrue);
+}
+
+
+
+void stats_free (MERGE_STATS *stats)
+{
+  if (stats->file != NULL) free (stats->file);
+  stats->file = NULL;
+
+  pthread_mutex_destroy (&stats->mutex);
+}
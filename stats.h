@@ -0,0 +1,103 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <pthread.h>
+
+#include "chrtr2_merge.h"
+#include "input_files.h"
+
+
+/*  The phases that we keep times for.  The three MISP phases have to stay together and in this order (the regrid worker
+    processes send them back as a block).  */
+
+#define         STATS_OPEN 0          /*  Opening the files, reading the headers, and building the input maps  */
+#define         STATS_READ 1          /*  Reading input rows  */
+#define         STATS_EXCLUDE 2       /*  Building the exclude maps  */
+#define         STATS_INSERT 3        /*  Inserting input rows into the grid (including the exclude buffer tests)  */
+#define         STATS_MISP_LOAD 4
+#define         STATS_MISP_PROC 5
+#define         STATS_MISP_RTRV 6
+#define         STATS_WRITE 7         /*  Writing output rows (in the writer thread)  */
+#define         STATS_PHASES 8
+
+
+/*  Totals for one phase.  Phases that run in more than one thread or process at once add up the time spent in each of
+    them so the wall time can be more than the elapsed time.  */
+
+typedef struct
+{
+  double             wall;            /*  Seconds  */
+  double             cpu;             /*  CPU seconds of the thread(s) that ran the phase  */
+  int64_t            calls;
+  int64_t            cells;
+  int64_t            bytes;           /*  CHRTR2_RECORD bytes read or written  */
+  int64_t            peak_rss;        /*  Largest resident set size (KB) seen at the start or end of the phase  */
+} STATS_PHASE;
+
+
+/*  Totals for one input file.  */
+
+typedef struct
+{
+  double             wall;            /*  Seconds spent reading it  */
+  int64_t            cells;
+  int64_t            bytes;
+} STATS_FILE;
+
+
+typedef struct
+{
+  double             wall;
+  double             cpu;
+  int64_t            rss;             /*  Resident set size (KB) when the timer was started  */
+} STATS_TIMER;
+
+
+/*  Instrumentation for --stats-json.  Everything that records stats does nothing if its stats pointer is NULL so the
+    timers cost nothing unless they were asked for.  */
+
+typedef struct
+{
+  pthread_mutex_t    mutex;
+  double             start;           /*  Wall clock time that the stats were started  */
+  int64_t            rss;             /*  Last resident set size (KB) that we read  */
+  double             rss_time;        /*  Wall clock time that rss was read  */
+  STATS_PHASE        phase[STATS_PHASES];
+  int32_t            file_count;
+  STATS_FILE         *file;
+} MERGE_STATS;
+
+
+uint8_t stats_init (MERGE_STATS *stats, int32_t file_count);
+void stats_start (MERGE_STATS *stats, STATS_TIMER *timer);
+void stats_stop (MERGE_STATS *stats, STATS_TIMER *timer, int32_t phase, int32_t file, int64_t cells, int64_t bytes);
+void stats_add_phases (MERGE_STATS *stats, int32_t phase, STATS_PHASE *add, int32_t count);
+void stats_json_string (FILE *fp, char *string);
+uint8_t stats_write_json (MERGE_STATS *stats, char *path, INPUT_FILES *inputs, char *output_file, CHRTR2_HEADER *output_header);
+void stats_free (MERGE_STATS *stats);
+
+
+#endif
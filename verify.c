@@ -0,0 +1,273 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+
+*********************************************************************************************/
+
+#include "verify.h"
+
+
+/*  The reference merge for one window of output rows.  This is the original cell at a time merge (one chrtr2_read_record
+    and one chrtr2_get_coord per input cell, exclude buffers checked cell by cell) restricted to the output rows from
+    start_row up to end_row (with the merge's policy tested cell by cell).  None of the input maps, row readers, exclude maps,
+    or coverage maps are used.  */
+
+typedef struct
+{
+  int32_t            start_row;
+  int32_t            rows;
+  int32_t            width;
+  float              *z;
+  uint16_t           *status;
+  GRID_RANK          *rank;
+  float              *uncertainty;
+} VERIFY_GRID;
+
+
+
+static void verify_set (VERIFY_GRID *ref, size_t index, CHRTR2_RECORD *record, int32_t rank)
+{
+  ref->z[index] = record->z;
+  ref->status[index] = record->status;
+  ref->rank[index] = (GRID_RANK) rank;
+  ref->uncertainty[index] = record->uncertainty;
+}
+
+
+
+static uint8_t verify_merge (MERGE *merge, VERIFY_GRID *ref)
+{
+  int32_t            i, j, k, m, n, handle, start_x, end_x, start_y, end_y, end_row;
+  uint8_t            hit;
+  size_t             index, cell;
+  double             lat, lon;
+  CHRTR2_RECORD      chrtr2_record;
+  CHRTR2_HEADER      *header;
+  NV_I32_COORD2      coord, coord2;
+
+
+  end_row = ref->start_row + ref->rows;
+
+  for (i = 0 ; i < merge->file_count ; i++)
+    {
+      if ((handle = input_files_open (&merge->inputs, i)) < 0)
+        {
+          merge_error (merge, MERGE_ERROR_OPEN, "Error opening %s.\nThe error message returned was:%s", merge->inputs.path[i],
+                       chrtr2_strerror ());
+          return (NVFalse);
+        }
+
+      header = &merge->inputs.header[i];
+
+
+      for (j = 0 ; j < header->height ; j++)
+        {
+          /*  Every cell in an input row has the same latitude so if the first one lands outside the window they all do.  */
+
+          coord.y = j;
+          coord.x = 0;
+
+          chrtr2_get_lat_lon (handle, &lat, &lon, coord);
+
+          lat = lat + EPS;
+          lon = lon + EPS;
+
+          if (merge->dateline && lon < 0.0) lon += 360.0;
+
+          if (!chrtr2_get_coord (merge->output_handle, lat, lon, &coord2) && (coord2.y < ref->start_row || coord2.y >= end_row)) continue;
+
+
+          for (k = 0 ; k < header->width ; k++)
+            {
+              coord.x = k;
+
+              chrtr2_read_record (handle, coord, &chrtr2_record);
+
+              chrtr2_get_lat_lon (handle, &lat, &lon, coord);
+
+              lat = lat + EPS;
+              lon = lon + EPS;
+
+              if (merge->dateline && lon < 0.0) lon += 360.0;
+
+              if (chrtr2_get_coord (merge->output_handle, lat, lon, &coord2)) continue;
+
+              if (coord2.y < ref->start_row || coord2.y >= end_row) continue;
+
+              index = (size_t) (coord2.y - ref->start_row) * (size_t) ref->width + (size_t) coord2.x;
+
+
+              if (!i && (merge->policy == MERGE_POLICY_FIRST || merge->policy == MERGE_POLICY_EXCLUDE))
+                {
+                  verify_set (ref, index, &chrtr2_record, i + 1);
+                }
+              else if (merge->exclude)
+                {
+                  if (chrtr2_record.status & HARD_DATA)
+                    {
+                      start_x = MAX (coord2.x - merge->buffer_x[i], 0);
+                      end_x = MIN (coord2.x + merge->buffer_x[i], ref->width - 1);
+                      start_y = MAX (coord2.y - merge->buffer_y[i], ref->start_row);
+                      end_y = MIN (coord2.y + merge->buffer_y[i], end_row - 1);
+
+                      hit = NVFalse;
+                      for (m = start_y ; m <= end_y && !hit ; m++)
+                        {
+                          for (n = start_x ; n <= end_x ; n++)
+                            {
+                              cell = (size_t) (m - ref->start_row) * (size_t) ref->width + (size_t) n;
+
+                              if (ref->rank[cell] != i + 1 && (ref->status[cell] & HARD_DATA))
+                                {
+                                  hit = NVTrue;
+                                  break;
+                                }
+                            }
+                        }
+
+                      if (!hit) verify_set (ref, index, &chrtr2_record, i + 1);
+                    }
+                }
+              else
+                {
+                  if (merge_policy_replaces (merge->policy, &chrtr2_record, i + 1, ref->z[index], ref->status[index],
+                                             ref->uncertainty[index], ref->rank[index], merge->file_time))
+                    verify_set (ref, index, &chrtr2_record, i + 1);
+                }
+            }
+        }
+
+      input_files_release (&merge->inputs, i);
+    }
+
+  return (NVTrue);
+}
+
+
+
+/*  Check the output rows from start_row up to end_row of grid (after the merge and before the regrid) against the reference
+    merge.  The rows are checked in bands of VERIFY_BAND_ROWS.  Only every merge->verify'th band (counting from the top of
+    the output file) is checked so that big jobs can be spot checked.  Each band is merged again from scratch with the
+    exclude halo above and below it so the cells in the band see every input cell that can affect them.  Returns NVFalse
+    (with the error in merge) if the check itself failed (the differences are just counted).  */
+
+uint8_t merge_verify (MERGE *merge, MERGE_GRID *grid, int32_t start_row, int32_t end_row)
+{
+  int32_t            band, band_start, band_end, row, col, height, offset;
+  uint8_t            ok = NVTrue;
+  size_t             number, cell, plane;
+  GRID_TILE          *tile;
+  double             lat, lon;
+  VERIFY_GRID        ref;
+  NV_I32_COORD2      coord;
+
+
+  height = merge->output_header.height;
+  ref.width = merge->output_header.width;
+
+  plane = (size_t) (VERIFY_BAND_ROWS + 2 * merge->halo) * (size_t) ref.width;
+
+  ref.z = (float *) malloc (plane * sizeof (float));
+  ref.status = (uint16_t *) malloc (plane * sizeof (uint16_t));
+  ref.rank = (GRID_RANK *) malloc (plane * sizeof (GRID_RANK));
+  ref.uncertainty = (float *) malloc (plane * sizeof (float));
+
+  if (ref.z == NULL || ref.status == NULL || ref.rank == NULL || ref.uncertainty == NULL)
+    {
+      merge_error (merge, MERGE_ERROR_MEMORY, "Allocating reference grid in verify.c: %s", strerror (errno));
+      ok = NVFalse;
+    }
+
+
+  for (band = start_row / VERIFY_BAND_ROWS ; ok && band * VERIFY_BAND_ROWS < end_row ; band++)
+    {
+      if (band % merge->verify) continue;
+
+      band_start = MAX (band * VERIFY_BAND_ROWS, start_row);
+      band_end = MIN ((band + 1) * VERIFY_BAND_ROWS, end_row);
+
+      ref.start_row = MAX (band_start - merge->halo, 0);
+      ref.rows = MIN (band_end + merge->halo, height) - ref.start_row;
+
+      memset (ref.z, 0, (size_t) ref.rows * (size_t) ref.width * sizeof (float));
+      memset (ref.status, 0, (size_t) ref.rows * (size_t) ref.width * sizeof (uint16_t));
+      memset (ref.rank, 0, (size_t) ref.rows * (size_t) ref.width * sizeof (GRID_RANK));
+      memset (ref.uncertainty, 0, (size_t) ref.rows * (size_t) ref.width * sizeof (float));
+
+      if (!(ok = verify_merge (merge, &ref))) break;
+
+
+      for (row = band_start ; row < band_end ; row++)
+        {
+          for (col = 0 ; col < ref.width ; col++)
+            {
+              cell = (size_t) (row - ref.start_row) * (size_t) ref.width + (size_t) col;
+              number = merge_grid_tile_number (grid, row - grid->start_row, col);
+              offset = merge_grid_offset (row - grid->start_row, col);
+              tile = grid->tile[number];
+
+              /*  The Z and source of a cell with no data don't mean anything (the merge doesn't store empty input cells in
+                  empty grid tiles).  */
+
+              if (tile->status[offset] != ref.status[cell] ||
+                  (ref.status[cell] && (tile->z[offset] != ref.z[cell] || tile->rank[offset] != ref.rank[cell])))
+                {
+                  if (merge->verify_diffs < VERIFY_MAX_REPORT)
+                    {
+                      coord.x = col;
+                      coord.y = row;
+                      chrtr2_get_lat_lon (merge->output_handle, &lat, &lon, coord);
+
+                      fprintf (stderr, "Verify: row %d, column %d (%.9f, %.9f) z %f status 0x%04x rank %d, reference z %f status 0x%04x rank %d\n",
+                               row, col, lat, lon, tile->z[offset], tile->status[offset], tile->rank[offset], ref.z[cell],
+                               ref.status[cell], ref.rank[cell]);
+                    }
+
+                  merge->verify_diffs++;
+                }
+            }
+        }
+
+      merge->verify_cells += (int64_t) (band_end - band_start) * (int64_t) ref.width;
+      merge->verify_bands++;
+    }
+
+  free (ref.z);
+  free (ref.status);
+  free (ref.rank);
+  free (ref.uncertainty);
+
+  return (ok);
+}
+
+
+
+/*  Print the totals.  Returns NVFalse if any cell didn't match.  */
+
+uint8_t merge_verify_report (MERGE *merge)
+{
+  fprintf (stderr, "\nVerified %lld cells in %d bands against the reference merge, %lld differences\n\n",
+           (long long) merge->verify_cells, merge->verify_bands, (long long) merge->verify_diffs);
+  fflush (stderr);
+
+  if (merge->verify_diffs) return (NVFalse);
+
+  return (NVTrue);
+}
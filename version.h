@@ -38,7 +38,7 @@
 
 #ifndef VERSION
 
-#define     VERSION     "PFM Software - chrtr2_merge V2.02 - 07/23/14"
+#define     VERSION     "PFM Software - chrtr2_merge V2.27 - 10/16/26"
 
 #endif
 
@@ -86,4 +86,259 @@
     - Switched from using the old NV_INT64 and NV_U_INT32 type definitions to the C99 standard stdint.h and
       inttypes.h sized data types (e.g. int64_t and uint32_t).
 
+
+    Version 2.03
+    PFM Software
+    10/16/26
+
+    - Replaced the cell by cell exclude buffer search with a summed-area table of the hard data that is
+      rebuilt once per input file.  The exclude test now costs the same no matter how big the buffer is.
+    - The -b option now accepts buffer sizes in meters (e.g. -b 250m) and a comma separated list of per file
+      buffer sizes.
+    - Fixed the first input file being inserted using the previous cell's output coordinates.
+
+
+    Version 2.04
+    PFM Software
+    10/16/26
+
+    - Input files are now read a block of rows at a time using chrtr2_read_record_row instead of one
+      chrtr2_read_record call per cell.
+
+
+    Version 2.05
+    PFM Software
+    10/16/26
+
+    - The input to output grid mapping is now computed once per input file (one lookup per row and one per
+      column) instead of once per cell.  Inputs that share the output grid spacing are detected and inserted
+      as whole row spans at a constant offset.
+
+
+    Version 2.06
+    PFM Software
+    10/16/26
+
+    - Added the --threads option.  With more than one thread the input files are read and mapped in parallel
+      by worker threads and then inserted into the grid one at a time in precedence order so the output is
+      identical to the single threaded result.
+
+
+    Version 2.07
+    PFM Software
+    10/16/26
+
+    - Added the --mem-limit option.  The output grid is processed in bands of full width rows that fit in the
+      memory limit.  Each band only reads the input rows that land in it (plus the exclude buffer and regrid
+      halos) and is written to the output file as soon as it is finished.
+    - Moved the merge, regrid, and write code out of main into merge.c.
+
+
+    Version 2.08
+    PFM Software
+    10/16/26
+
+    - The in-memory grid is now stored as separate Z, status, and rank planes in one huge page aligned
+      allocation instead of an array of full CHRTR2 records.  The number of points and uncertainty fields are
+      only kept if an input file actually has them.
+
+
+    Version 2.09
+    PFM Software
+    10/16/26
+
+    - Added --regrid-workers.  With more than one worker the regrid is split into bands of rows that are run
+      in separate MISP processes.  Each band is regridded with 29 rows of overlap (the filter border plus the
+      MISP search radius) and only the interior is kept.  Bands are written in order so the output layout
+      doesn't change.  The default is one worker (a single pass) and --threads never splits the regrid.
+    - A band's MISP surface only sees the data in its overlap so interpolated values can differ from a single
+      pass.  The difference depends on the data (it's largest in holes wider than the overlap) so no bound is
+      claimed.  bench/chrtr2_diff reports the largest and RMS difference between a banded and a single pass
+      output.  Real, digitized, and land masked data are never changed and -n output is unaffected.
+    - Moved the regrid code out of merge.c into regrid.c.
+
+
+    Version 2.10
+    PFM Software
+    10/16/26
+
+    - Added --holes-only.  It regrids only the bands of rows that have holes in them (cells that aren't real,
+      digitized, or land masked data).  Only the data within the regrid halo of a hole is loaded into MISP.
+      Rows with no holes are copied straight to the output file.
+
+
+    Version 2.11
+    PFM Software
+    10/16/26
+
+    - Added --incremental.  A manifest (OUTPUT_FILE.manifest) with the size, modification time, and per band
+      checksums of each input file (and the Z range of each band of the output) is kept next to the output
+      file.  If the options and input files match the last run only the bands of output rows that the changed
+      input data can reach (plus the exclude and regrid halos) are merged again and the output file is updated
+      in place.  The header's Z range is rebuilt from the bands that were kept and the ones that were redone.
+    - Input files whose size and modification time haven't changed aren't reread to compute the checksums.
+
+
+    Version 2.12
+    PFM Software
+    10/16/26
+
+    - Removed the 16 file limit.  Input files can also be read from a list file with --list.  Input files are
+      opened when they're needed and no more than MAX_OPEN_INPUTS are kept open at once (least recently used
+      files are closed first).
+    - The input files are indexed by the output rows that they land in so each tile only reads the files that
+      overlap it.
+    - The rank plane of the merge grid is now 16 bits so up to 65535 files can be merged.
+
+
+    Version 2.13
+    PFM Software
+    10/16/26
+
+    - Input rows that land on output that the higher precedence files have already completely covered are no
+      longer read.  Input files that are completely covered are never even opened and are reported at the end
+      of the run.
+
+
+    Version 2.14
+    PFM Software
+    10/16/26
+
+    - The output file is now written a row at a time with the library's row writer by a separate thread so
+      that the disk writes overlap the merging and regridding.  In no-regrid mode only the runs of cells that
+      have data are written.
+
+
+    Version 2.15
+    PFM Software
+    10/16/26
+
+    - Added the --pipeline option.  The output is processed in bands of rows and three stages run at once:
+      the input files for the next band are read while the current band is merged and the last one is
+      regridded and written.
+
+
+    Version 2.16
+    PFM Software
+    10/16/26
+
+    - Added the --stats-json option that writes the wall and CPU time, cells per second, bytes read and
+      written, and memory use of each phase of the merge (and the read times of each input file) to a JSON
+      file.  A phase's memory is the largest resident set size read at the start or end of the phase (the
+      process's peak resident set size is for its whole life so it's only reported for the whole run).
+
+
+    Version 2.17
+    PFM Software
+    10/16/26
+
+    - The build no longer picks up source files in subdirectories (qmake -project -norecursive) so that the
+      benchmark generator in bench/chrtr2_gen can live in the same tree.
+
+
+    Version 2.18
+    PFM Software
+    10/16/26
+
+    - Added --verify.  The merged grid (before the regrid) is checked against the original cell at a time
+      merge in bands of VERIFY_BAND_ROWS rows and any cells whose Z, status, or rank differ are reported with
+      their position.  --verify=N only checks every Nth band.
+
+
+    Version 2.19
+    PFM Software
+    10/16/26
+
+    - The in-memory grid is now a table of 64 by 64 cell tiles that are only allocated when data is stored in
+      them.  Empty parts of the grid share a single null tile and are skipped as a whole by the coverage,
+      exclude, MISP loading, and output loops, so merging inputs that are far apart no longer needs memory for
+      the whole output MBR.  Regridded rows are no longer written back into the grid.
+
+
+    Version 2.20
+    PFM Software
+    10/16/26
+
+    - Added --batch FILE.  Each line of the file is a separate merge (the same arguments as the command line)
+      and the merges are run by --jobs worker threads that share the --threads, --regrid-workers, and
+      --mem-limit budgets.  Input files are opened once for the whole batch and decoded blocks of input rows
+      (up to --cache bytes) are shared between the merges that read them.
+
+
+    Version 2.21
+    PFM Software
+    10/16/26
+
+    - Added --area.  The output file only covers the area (an MBR or a polygon from an area file) instead of
+      the MBR of all of the input files.  The merge grid is the area plus the exclude buffers and the regrid
+      halo on every side so the cells in the area are the same as the ones from a merge of the whole MBR, and
+      only the input data that lands in that grid is read.  Cells outside of a polygon are left empty.
+
+
+    Version 2.22
+    PFM Software
+    10/16/26
+
+    - Added --checkpoint and --resume.  With --checkpoint the output is merged in tiles of no more than
+      CHECKPOINT_BAND_ROWS rows and, each time a tile has been written and synced to the disk, the progress
+      (and the options and input file names, sizes, and times) is saved in OUTPUT_FILE.checkpoint.  --resume
+      picks up after the last saved tile if the checkpoint matches the merge.  The range of the data for the
+      header is now kept by the output writer.
+
+
+    Version 2.23
+    PFM Software
+    10/16/26
+
+    - The merge engine (reading the input headers, the output grid, compositing, regridding, and writing)
+      has been moved out of main into merge_context.c so it can be built as a library (libchrtr2_merge.a) and
+      run in process by other programs.  A merge is set up in a MERGE_CONTEXT with input file names or CHRTR2
+      handles that the caller already has open, the output can be returned as an in-memory grid instead of a
+      file, and a progress callback is called as each tile of output rows is finished.  The command line is
+      now a thin wrapper around it.
+
+
+    Version 2.24
+    PFM Software
+    10/16/26
+
+    - Added --gtiff and --raw.  The output rows are also written (through GDAL) to a tiled, DEFLATE
+      compressed GeoTIFF with Z, status, and source file number bands and/or a raw 32 bit float Z raster with
+      an ESRI header as they're written to the output file, so the output file doesn't have to be read again
+      to convert it.
+
+
+    Version 2.25
+    PFM Software
+    10/16/26
+
+    - Added --pyramid.  Overview levels of the output grid reduced by 2, 4, 8, ... (until they fit in
+      PYRAMID_TOP_SIZE cells on a side) are built from the output rows as they're written and stored in
+      OUTPUT_FILE.pyramid.  Each overview cell has the minimum, maximum, and mean Z, the number of cells, and
+      the ORed status of its block.  Blocks that have any real, digitized, or land masked data only use that
+      data.
+
+
+    Version 2.26
+    PFM Software
+    10/16/26
+
+    - Added --policy.  Besides the default first file wins (and -e) a cell can go to the shoalest Z, the
+      lowest uncertainty, the most recently modified input file, or the best status (real over digitized over
+      land masked over interpolated).  The policy is picked once per input row and each policy has its own
+      insert loop, compiled with the policy as a constant, that runs over the row a grid tile at a time.
+      Input rows are only skipped as covered when the policy says the cells they land on can't be replaced.
+
+
+    Version 2.27
+    PFM Software
+    10/16/26
+
+    - Added --summary-json.  The Z range, a Z histogram, the number of cells with each status bit, and the
+      number of cells from each input file are gathered by the output writer from each run of cells as it's
+      written (the same pass that keeps the range for the header) and written to a JSON file, so QA doesn't
+      have to read the output file again.  The range loop no longer branches on empty cells.
+    - Fixed the observed Z range never getting into the output file's header (the header was updated after
+      the output file had been closed).
+
 */